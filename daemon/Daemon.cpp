@@ -183,6 +183,8 @@ namespace util
 		if (isFloodfill && i2p::config::IsDefault ("limits.transittunnels"))
 			transitTunnels *= 2; // double default number of transit tunnels for floodfill
 		i2p::tunnel::tunnels.SetMaxNumTransitTunnels (transitTunnels);
+		uint16_t transitThreads; i2p::config::GetOption("limits.transitthreads", transitThreads);
+		i2p::tunnel::tunnels.SetNumTransitTunnelsThreads (transitThreads);
 
 		/* this section also honors 'floodfill' flag, if set above */
 		std::string bandwidth; i2p::config::GetOption("bandwidth", bandwidth);
@@ -341,6 +343,13 @@ namespace util
 		LogPrint(eLogInfo, "Daemon: Starting Router context");
 		i2p::context.Start();
 
+		uint16_t garlicThreads; i2p::config::GetOption("limits.garlicthreads", garlicThreads);
+		if (garlicThreads)
+		{
+			LogPrint(eLogInfo, "Daemon: Starting ", garlicThreads, " garlic worker threads");
+			i2p::garlic::workers.Start (garlicThreads);
+		}
+
 		LogPrint(eLogInfo, "Daemon: Starting Client");
 		i2p::client::context.Start ();
 
@@ -369,6 +378,8 @@ namespace util
 		LogPrint(eLogInfo, "Daemon: Shutting down");
 		LogPrint(eLogInfo, "Daemon: Stopping Client");
 		i2p::client::context.Stop();
+		LogPrint(eLogInfo, "Daemon: Stopping garlic workers");
+		i2p::garlic::workers.Stop ();
 		LogPrint(eLogInfo, "Daemon: Stopping Router context");
 		i2p::context.Stop();
 		LogPrint(eLogInfo, "Daemon: Stopping Tunnels");
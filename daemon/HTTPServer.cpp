@@ -10,6 +10,7 @@
 #include <sstream>
 #include <thread>
 #include <memory>
+#include <functional>
 
 #include <boost/asio.hpp>
 #include <boost/algorithm/string.hpp>
@@ -74,6 +75,8 @@ namespace http {
 	const char HTTP_PAGE_I2P_TUNNELS[] = "i2p_tunnels";
 	const char HTTP_PAGE_COMMANDS[] = "commands";
 	const char HTTP_PAGE_LEASESETS[] = "leasesets";
+	const char HTTP_PAGE_MEMORY_POOLS[] = "memory_pools";
+	const char HTTP_PAGE_NETDB_STATS[] = "netdb_stats";
 	const char HTTP_COMMAND_ENABLE_TRANSIT[] = "enable_transit";
 	const char HTTP_COMMAND_DISABLE_TRANSIT[] = "disable_transit";
 	const char HTTP_COMMAND_SHUTDOWN_START[] = "shutdown_start";
@@ -197,7 +200,9 @@ namespace http {
 			s << "  <a href=\"" << webroot << "?page=" << HTTP_PAGE_TRANSIT_TUNNELS << "\">" << tr("Transit Tunnels") << "</a><br>\r\n";
 		s <<
 			"  <a href=\"" << webroot << "?page=" << HTTP_PAGE_TRANSPORTS << "\">" << tr("Transports") << "</a><br>\r\n"
-			"  <a href=\"" << webroot << "?page=" << HTTP_PAGE_I2P_TUNNELS << "\">" << tr("I2P tunnels") << "</a><br>\r\n";
+			"  <a href=\"" << webroot << "?page=" << HTTP_PAGE_I2P_TUNNELS << "\">" << tr("I2P tunnels") << "</a><br>\r\n"
+			"  <a href=\"" << webroot << "?page=" << HTTP_PAGE_MEMORY_POOLS << "\">" << tr("Memory pools") << "</a><br>\r\n"
+			"  <a href=\"" << webroot << "?page=" << HTTP_PAGE_NETDB_STATS << "\">" << tr("NetDb stats") << "</a><br>\r\n";
 		if (i2p::client::context.GetSAMBridge ())
 			s << "  <a href=\"" << webroot << "?page=" << HTTP_PAGE_SAM_SESSIONS << "\">" << tr("SAM sessions") << "</a><br>\r\n";
 		s <<
@@ -687,7 +692,8 @@ namespace http {
 	void ShowTunnels (std::stringstream& s)
 	{
 		s << "<b>" << tr("Tunnels") << ":</b><br>\r\n";
-		s << "<b>" << tr("Queue size") << ":</b> " << i2p::tunnel::tunnels.GetQueueSize () << "<br>\r\n<br>\r\n";
+		s << "<b>" << tr("Queue size") << ":</b> " << i2p::tunnel::tunnels.GetQueueSize () << "<br>\r\n";
+		s << "<b>" << tr("Max queue size") << ":</b> " << i2p::tunnel::tunnels.GetQueueMaxSize () << "<br>\r\n<br>\r\n";
 
 		auto ExplPool = i2p::tunnel::tunnels.GetExploratoryPool ();
 
@@ -828,8 +834,62 @@ namespace http {
 		}
 	}
 
+	void ShowMemoryPools (std::stringstream& s)
+	{
+		s << "<b>" << tr("Memory pools") << ":</b><br>\r\n";
+		s << "<table><thead><th>" << tr("Name") << "</th><th>" << tr("In use") << "</th><th>" << tr("Cached") << "</th><th>"
+			<< tr("Hits") << "</th><th>" << tr("Misses") << "</th><th>" << tr("Memory") << "</th></thead><tbody class=\"tableitem\">";
+		i2p::util::VisitMemoryPools ([&s](const std::string& name, const i2p::util::MemoryPoolStats& stats)
+			{
+				s << "<tr><td>" << name << "</td><td>" << stats.numLive << "</td><td>" << stats.numCached << "</td><td>"
+					<< stats.numHits << "</td><td>" << stats.numMisses << "</td><td>";
+				ShowTraffic (s, (stats.numLive + stats.numCached)*stats.objectSize);
+				s << "</td></tr>\r\n";
+			});
+		s << "</tbody></table>\r\n";
+	}
+
+	void ShowNetDbStats (std::stringstream& s)
+	{
+		s << "<b>" << tr("Signature verification") << ":</b> " << i2p::data::netdb.GetNumWorkerThreads () << " "
+			<< tr("worker threads") << "<br>\r\n";
+		s << "<table><thead><th>" << tr("Type") << "</th><th>" << tr("Verified") << "</th><th>" << tr("Failed") << "</th><th>"
+			<< tr("Average") << "</th>";
+		uint64_t limit = i2p::data::NETDB_VERIFICATION_LATENCY_FIRST_BUCKET;
+		for (int i = 0; i < i2p::data::NETDB_VERIFICATION_LATENCY_NUM_BUCKETS - 1; i++, limit <<= 1)
+			s << "<th>&lt;" << limit << tr(/* tr: Microseconds */ "us") << "</th>";
+		s << "<th>&ge;" << (limit >> 1) << tr("us") << "</th></thead><tbody class=\"tableitem\">";
+		const char * types[] = { "RouterInfo", "LeaseSet", "LeaseSet2" };
+		for (int i = 0; i < i2p::data::eNumNetDbVerificationTypes; i++)
+		{
+			auto& stats = i2p::data::netdb.GetVerificationStats ((i2p::data::NetDbVerificationType)i);
+			uint64_t num = stats.numVerified + stats.numFailed;
+			s << "<tr><td>" << types[i] << "</td><td>" << stats.numVerified << "</td><td>" << stats.numFailed << "</td><td>"
+				<< (num ? stats.totalTime/num : 0) << tr("us") << "</td>";
+			for (int j = 0; j < i2p::data::NETDB_VERIFICATION_LATENCY_NUM_BUCKETS; j++)
+				s << "<td>" << stats.latencies[j] << "</td>";
+			s << "</tr>\r\n";
+		}
+		s << "</tbody></table>\r\n";
+	}
+
+	static void ShowSSU2SessionStats (std::stringstream& s, const i2p::transport::SSU2Session& session)
+	{
+		// snapshot made in SSU2 thread
+		const auto& stats = session.GetStats ();
+		s << " [" << session.GetCongestionControlName () << " cwnd:" << stats.windowSize
+		  << " inflight:" << stats.numSentPackets;
+		int rtt = stats.rtt;
+		if (rtt >= 0) s << " rtt:" << rtt;
+		s << " rto:" << stats.rto;
+		uint64_t numLostPackets = stats.numLostPackets;
+		if (numLostPackets > 0) s << " lost:" << numLostPackets;
+		s << "]";
+	}
+
 	template<typename Sessions>
-	static void ShowTransportSessions (std::stringstream& s, const Sessions& sessions, const std::string name)
+	static void ShowTransportSessions (std::stringstream& s, const Sessions& sessions, const std::string name,
+		std::function<void (std::stringstream&, const typename Sessions::mapped_type::element_type&)> showStats = nullptr)
 	{
 		auto comp = [](typename Sessions::mapped_type a, typename Sessions::mapped_type b)
 			{ return a->GetRemoteEndpoint() < b->GetRemoteEndpoint(); };
@@ -856,6 +916,7 @@ namespace http {
 					tmp_s << " [itag:" << it->GetRelayTag () << "]";
 				if (it->GetSendQueueSize () > 0)
 					tmp_s << " [queue:" << it->GetSendQueueSize () << "]";
+				if (showStats) showStats (tmp_s, *it);
 				if (it->IsSlow ()) tmp_s << " [slow]";
 				tmp_s << "</div>\r\n" << std::endl;
 				cnt++;
@@ -872,6 +933,7 @@ namespace http {
 					tmp_s6 << " [itag:" << it->GetRelayTag () << "]";
 				if (it->GetSendQueueSize () > 0)
 					tmp_s6 << " [queue:" << it->GetSendQueueSize () << "]";
+				if (showStats) showStats (tmp_s6, *it);
 				tmp_s6 << "</div>\r\n" << std::endl;
 				cnt6++;
 			}
@@ -905,8 +967,31 @@ namespace http {
 		{
 			auto sessions = ssu2Server->GetSSU2Sessions ();
 			if (!sessions.empty ())
-				ShowTransportSessions (s, sessions, "SSU2");
+				ShowTransportSessions (s, sessions, "SSU2", ShowSSU2SessionStats);
 		}
+		s << "<br>\r\n<b>" << tr("Send queue delays") << ":</b><br>\r\n";
+		s << "<table><thead><th>" << tr("Delay") << "</th><th>" << tr("Control") << "</th><th>"
+		  << tr("Local") << "</th><th>" << tr("Transit") << "</th></thead><tbody class=\"tableitem\">";
+		for (int i = 0; i < i2p::transport::QUEUE_DELAY_HISTOGRAM_NUM_BUCKETS; i++)
+		{
+			s << "<tr><td>";
+			if (i < i2p::transport::QUEUE_DELAY_HISTOGRAM_NUM_BUCKETS - 1)
+				s << "&lt; " << i2p::transport::QueueDelayHistogram::GetBucketUpperBound (i);
+			else
+				s << "&ge; " << i2p::transport::QueueDelayHistogram::GetBucketUpperBound (i - 1);
+			s << " " << tr(/* tr: Milliseconds */ "ms") << "</td>";
+			for (int j = 0; j < i2p::transport::eNumTransportPriorities; j++)
+				s << "<td>" << i2p::transport::transports.GetQueueDelayHistogram ((i2p::transport::TransportPriority)j).GetCount (i) << "</td>";
+			s << "</tr>\r\n";
+		}
+		s << "<tr><td>" << tr("Dropped") << "</td>";
+		for (int j = 0; j < i2p::transport::eNumTransportPriorities; j++)
+			s << "<td>" << i2p::transport::transports.GetQueueDelayHistogram ((i2p::transport::TransportPriority)j).GetNumDropped () << "</td>";
+		s << "</tr>\r\n</tbody></table>\r\n";
+		auto& ephemeralKeys = i2p::transport::transports.GetX25519KeysPairSupplier ();
+		s << "<br>\r\n<b>" << tr("Ephemeral keys") << ":</b> " << ephemeralKeys.GetNumAcquired () << " "
+		  << tr("acquired") << ", " << ephemeralKeys.GetNumStarved () << " " << tr("generated on demand") << ", "
+		  << tr("queue size") << " " << ephemeralKeys.GetQueueSize () << "<br>\r\n";
 	}
 
 	void ShowSAMSessions (std::stringstream& s)
@@ -1242,6 +1327,10 @@ namespace http {
 			ShowI2PTunnels (s);
 		else if (page == HTTP_PAGE_LEASESETS)
 			ShowLeasesSets(s);
+		else if (page == HTTP_PAGE_MEMORY_POOLS)
+			ShowMemoryPools (s);
+		else if (page == HTTP_PAGE_NETDB_STATS)
+			ShowNetDbStats (s);
 		else {
 			res.code = 400;
 			ShowError(s, tr("Unknown page") + ": " + page);
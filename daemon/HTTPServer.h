@@ -96,6 +96,8 @@ namespace http
 	void ShowLeasesSets(std::stringstream& s);
 	void ShowTunnels (std::stringstream& s);
 	void ShowTransitTunnels (std::stringstream& s);
+	void ShowMemoryPools (std::stringstream& s);
+	void ShowNetDbStats (std::stringstream& s);
 	void ShowTransports (std::stringstream& s);
 	void ShowSAMSessions (std::stringstream& s);
 	void ShowI2PTunnels (std::stringstream& s);
@@ -78,6 +78,10 @@ namespace config {
 			("limits.coresize", value<uint32_t>()->default_value(0),          "Maximum size of corefile in Kb (0 - use system limit)")
 			("limits.openfiles", value<uint16_t>()->default_value(0),         "Maximum number of open files (0 - use system default)")
 			("limits.transittunnels", value<uint32_t>()->default_value(10000), "Maximum active transit tunnels (default:10000)")
+			("limits.transitthreads", value<uint16_t>()->default_value(1),    "Number of threads handling transit tunnels data (default: 1)")
+			("limits.netdbthreads", value<uint16_t>()->default_value(2),      "Number of NetDb worker threads loading and verifying RouterInfos, 0 - NetDb thread only (default: 2)")
+			("limits.ephemeralthreads", value<uint16_t>()->default_value(1),  "Number of threads pre-generating ephemeral keys for handshakes and tunnel builds (default: 1)")
+			("limits.garlicthreads", value<uint16_t>()->default_value(1),  "Number of threads decrypting new incoming garlic sessions of all destinations, 0 - destination's thread (default: 1)")
 			("limits.zombies", value<double>()->default_value(0),             "Minimum percentage of successfully created tunnels under which tunnel cleanup is paused (default [%]: 0.00)")
 			("limits.ntcpsoft", value<uint16_t>()->default_value(0),          "Ignored")
 			("limits.ntcphard", value<uint16_t>()->default_value(0),          "Ignored")
@@ -285,6 +289,9 @@ namespace config {
 			("ssu2.mtu4", value<uint16_t>()->default_value(0),            "MTU for ipv4 address (default: detect)")
 			("ssu2.mtu6", value<uint16_t>()->default_value(0),            "MTU for ipv6 address (default: detect)")
 			("ssu2.proxy", value<std::string>()->default_value(""),       "Socks5 proxy URL for SSU2 transport")
+			("ssu2.batchio", value<bool>()->default_value(true),          "Batch UDP I/O with recvmmsg/sendmmsg, Linux only (default: enabled)")
+			("ssu2.receivethreads", value<uint16_t>()->default_value(1),  "Number of SO_REUSEPORT sockets with own receive thread per address, Linux only (default: 1)")
+			("ssu2.congestion", value<std::string>()->default_value("aimd"), "Congestion control: aimd, cubic or bbr (default: aimd)")
 		;
 
 		options_description nettime("Time sync options");
@@ -304,6 +311,7 @@ namespace config {
 		persist.add_options()
 			("persist.profiles", value<bool>()->default_value(true),       "Persist peer profiles (default: true)")
 			("persist.addressbook", value<bool>()->default_value(true),    "Persist full addresses (default: true)")
+			("persist.netdbfile", value<bool>()->default_value(false),     "Store NetDb in single file netDb.dat instead of netDb directory (default: false)")
 		;
 
 		options_description cpuext("CPU encryption extensions options");
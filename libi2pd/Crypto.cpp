@@ -282,6 +282,7 @@ namespace crypto
 
 	void X25519Keys::GenerateKeys ()
 	{
+		std::lock_guard<std::mutex> l(m_CtxMutex);
 #if OPENSSL_X25519
 		if (m_Pkey)
 		{
@@ -303,16 +304,22 @@ namespace crypto
 	bool X25519Keys::Agree (const uint8_t * pub, uint8_t * shared)
 	{
 		if (!pub || (pub[31] & 0x80)) return false; // not x25519 key
+		// use m_Ctx if nobody else does, own context otherwise
+		std::unique_lock<std::mutex> l(m_CtxMutex, std::try_to_lock);
 #if OPENSSL_X25519
-		EVP_PKEY_derive_init (m_Ctx);
 		auto pkey = EVP_PKEY_new_raw_public_key (EVP_PKEY_X25519, NULL, pub, 32);
 		if (!pkey) return false;
-		EVP_PKEY_derive_set_peer (m_Ctx, pkey);
+		auto ctx = l.owns_lock () ? m_Ctx : EVP_PKEY_CTX_new (m_Pkey, NULL);
+		EVP_PKEY_derive_init (ctx);
+		EVP_PKEY_derive_set_peer (ctx, pkey);
 		size_t len = 32;
-		EVP_PKEY_derive (m_Ctx, shared, &len);
+		EVP_PKEY_derive (ctx, shared, &len);
+		if (ctx != m_Ctx) EVP_PKEY_CTX_free (ctx);
 		EVP_PKEY_free (pkey);
 #else
-		GetEd25519 ()->ScalarMul (pub, m_PrivateKey, shared, m_Ctx);
+		BN_CTX * ctx = l.owns_lock () ? m_Ctx : BN_CTX_new ();
+		GetEd25519 ()->ScalarMul (pub, m_PrivateKey, shared, ctx);
+		if (ctx != m_Ctx) BN_CTX_free (ctx);
 #endif
 		return true;
 	}
@@ -329,6 +336,7 @@ namespace crypto
 
 	void X25519Keys::SetPrivateKey (const uint8_t * priv, bool calculatePublic)
 	{
+		std::lock_guard<std::mutex> l(m_CtxMutex);
 #if OPENSSL_X25519
 		if (m_Ctx) EVP_PKEY_CTX_free (m_Ctx);
 		if (m_Pkey) EVP_PKEY_free (m_Pkey);
@@ -934,6 +942,105 @@ namespace crypto
 		}
 	}
 
+	void TunnelEncryption::Encrypt (const uint8_t * const in[], uint8_t * const out[], size_t num)
+	{
+		size_t i = 0;
+#if SUPPORTS_AES && IS_X86_64
+		if(i2p::cpu::aesni)
+		{
+			// AES rounds of one CBC chain depend on each other, process 4 messages at once to hide latency
+			for (; i + 4 <= num; i += 4)
+				Encrypt4 (in + i, out + i);
+		}
+#endif
+		for (; i < num; i++)
+			Encrypt (in[i], out[i]);
+	}
+
+#if SUPPORTS_AES && IS_X86_64
+	#define AESENC4(instr) \
+		instr" %%xmm8, %%xmm0 \n" \
+		instr" %%xmm8, %%xmm1 \n" \
+		instr" %%xmm8, %%xmm2 \n" \
+		instr" %%xmm8, %%xmm3 \n"
+
+	#define EncryptAES256x4(sched) \
+		"movaps (%["#sched"]), %%xmm8 \n" AESENC4("pxor") \
+		"movaps 16(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 32(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 48(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 64(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 80(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 96(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 112(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 128(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 144(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 160(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 176(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 192(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 208(%["#sched"]), %%xmm8 \n" AESENC4("aesenc") \
+		"movaps 224(%["#sched"]), %%xmm8 \n" AESENC4("aesenclast")
+
+	void TunnelEncryption::Encrypt4 (const uint8_t * const in[], uint8_t * const out[])
+	{
+		const uint8_t * in0 = in[0], * in1 = in[1], * in2 = in[2], * in3 = in[3];
+		uint8_t * out0 = out[0], * out1 = out[1], * out2 = out[2], * out3 = out[3];
+		int num = 63; // 63 blocks = 1008 bytes
+		__asm__
+		(
+			// encrypt IVs
+			"movups (%[in0]), %%xmm0 \n"
+			"movups (%[in1]), %%xmm1 \n"
+			"movups (%[in2]), %%xmm2 \n"
+			"movups (%[in3]), %%xmm3 \n"
+			EncryptAES256x4(sched_iv)
+			"movaps %%xmm0, %%xmm4 \n"
+			"movaps %%xmm1, %%xmm5 \n"
+			"movaps %%xmm2, %%xmm6 \n"
+			"movaps %%xmm3, %%xmm7 \n"
+			// double IV encryption
+			EncryptAES256x4(sched_iv)
+			"movups %%xmm0, (%[out0]) \n"
+			"movups %%xmm1, (%[out1]) \n"
+			"movups %%xmm2, (%[out2]) \n"
+			"movups %%xmm3, (%[out3]) \n"
+			// encrypt data, IVs are xmm4-xmm7
+			"1: \n"
+			"add $16, %[in0] \n"
+			"add $16, %[in1] \n"
+			"add $16, %[in2] \n"
+			"add $16, %[in3] \n"
+			"add $16, %[out0] \n"
+			"add $16, %[out1] \n"
+			"add $16, %[out2] \n"
+			"add $16, %[out3] \n"
+			"movups (%[in0]), %%xmm0 \n"
+			"movups (%[in1]), %%xmm1 \n"
+			"movups (%[in2]), %%xmm2 \n"
+			"movups (%[in3]), %%xmm3 \n"
+			"pxor %%xmm4, %%xmm0 \n"
+			"pxor %%xmm5, %%xmm1 \n"
+			"pxor %%xmm6, %%xmm2 \n"
+			"pxor %%xmm7, %%xmm3 \n"
+			EncryptAES256x4(sched_l)
+			"movaps %%xmm0, %%xmm4 \n"
+			"movaps %%xmm1, %%xmm5 \n"
+			"movaps %%xmm2, %%xmm6 \n"
+			"movaps %%xmm3, %%xmm7 \n"
+			"movups %%xmm0, (%[out0]) \n"
+			"movups %%xmm1, (%[out1]) \n"
+			"movups %%xmm2, (%[out2]) \n"
+			"movups %%xmm3, (%[out3]) \n"
+			"dec %[num] \n"
+			"jnz 1b \n"
+			: [in0]"+r"(in0), [in1]"+r"(in1), [in2]"+r"(in2), [in3]"+r"(in3),
+				[out0]"+r"(out0), [out1]"+r"(out1), [out2]"+r"(out2), [out3]"+r"(out3), [num]"+r"(num)
+			: [sched_iv]"r"(m_IVEncryption.GetKeySchedule ()), [sched_l]"r"(m_LayerEncryption.ECB().GetKeySchedule ())
+			: "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7", "%xmm8", "cc", "memory"
+		);
+	}
+#endif
+
 	void TunnelDecryption::Decrypt (const uint8_t * in, uint8_t * out)
 	{
 #if SUPPORTS_AES
@@ -978,36 +1085,66 @@ namespace crypto
 
 // AEAD/ChaCha20/Poly1305
 
+	class AEADChaCha20Poly1305Context
+	{
+		// cipher is set once, only key and nonce are set for every message
+		public:
+
+			AEADChaCha20Poly1305Context (): m_Ctx (EVP_CIPHER_CTX_new ())
+			{
+				EVP_CipherInit_ex (m_Ctx, EVP_chacha20_poly1305(), NULL, NULL, NULL, 1);
+				EVP_CIPHER_CTX_ctrl (m_Ctx, EVP_CTRL_AEAD_SET_IVLEN, 12, 0);
+			}
+			~AEADChaCha20Poly1305Context () { EVP_CIPHER_CTX_free (m_Ctx); }
+
+			bool Process (const uint8_t * msg, size_t msgLen, const uint8_t * ad, size_t adLen, const uint8_t * key, const uint8_t * nonce, uint8_t * buf, size_t len, bool encrypt)
+			{
+				if (len < msgLen) return false;
+				if (encrypt && len < msgLen + 16) return false;
+				bool ret = true;
+				int outlen = 0;
+				if (encrypt)
+				{
+					EVP_EncryptInit_ex(m_Ctx, NULL, NULL, key, nonce);
+					EVP_EncryptUpdate(m_Ctx, NULL, &outlen, ad, adLen);
+					EVP_EncryptUpdate(m_Ctx, buf, &outlen, msg, msgLen);
+					EVP_EncryptFinal_ex(m_Ctx, buf + outlen, &outlen);
+					EVP_CIPHER_CTX_ctrl(m_Ctx, EVP_CTRL_AEAD_GET_TAG, 16, buf + msgLen);
+				}
+				else
+				{
+					// switch to decryption first, otherwise tag is not set
+					EVP_DecryptInit_ex(m_Ctx, NULL, NULL, key, nonce);
+					if (EVP_CIPHER_CTX_ctrl(m_Ctx, EVP_CTRL_AEAD_SET_TAG, 16, (uint8_t *)(msg + msgLen)) <= 0)
+						return false;
+					EVP_DecryptUpdate(m_Ctx, NULL, &outlen, ad, adLen);
+					EVP_DecryptUpdate(m_Ctx, buf, &outlen, msg, msgLen);
+					ret = EVP_DecryptFinal_ex(m_Ctx, buf + outlen, &outlen) > 0;
+				}
+				return ret;
+			}
+
+		private:
+
+			EVP_CIPHER_CTX * m_Ctx;
+	};
+
 	bool AEADChaCha20Poly1305 (const uint8_t * msg, size_t msgLen, const uint8_t * ad, size_t adLen, const uint8_t * key, const uint8_t * nonce, uint8_t * buf, size_t len, bool encrypt)
 	{
-		if (len < msgLen) return false;
-		if (encrypt && len < msgLen + 16) return false;
-		bool ret = true;
-		int outlen = 0;
-		EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new ();
-		if (encrypt)
-		{
-			EVP_EncryptInit_ex(ctx, EVP_chacha20_poly1305(), 0, 0, 0);
-			EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, 12, 0);
-			EVP_EncryptInit_ex(ctx, NULL, NULL, key, nonce);
-			EVP_EncryptUpdate(ctx, NULL, &outlen, ad, adLen);
-			EVP_EncryptUpdate(ctx, buf, &outlen, msg, msgLen);
-			EVP_EncryptFinal_ex(ctx, buf + outlen, &outlen);
-			EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, 16, buf + msgLen);
-		}
-		else
+		static thread_local AEADChaCha20Poly1305Context ctx;
+		return ctx.Process (msg, msgLen, ad, adLen, key, nonce, buf, len, encrypt);
+	}
+
+	size_t AEADChaCha20Poly1305Batch (std::vector<AEADChaCha20Poly1305Message>& msgs, bool encrypt)
+	{
+		static thread_local AEADChaCha20Poly1305Context ctx;
+		size_t num = 0;
+		for (auto& it: msgs)
 		{
-			EVP_DecryptInit_ex(ctx, EVP_chacha20_poly1305(), 0, 0, 0);
-			EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, 12, 0);
-			EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, 16, (uint8_t *)(msg + msgLen));
-			EVP_DecryptInit_ex(ctx, NULL, NULL, key, nonce);
-			EVP_DecryptUpdate(ctx, NULL, &outlen, ad, adLen);
-			EVP_DecryptUpdate(ctx, buf, &outlen, msg, msgLen);
-			ret = EVP_DecryptFinal_ex(ctx, buf + outlen, &outlen) > 0;
+			it.result = ctx.Process (it.msg, it.msgLen, it.ad, it.adLen, it.key, it.nonce, it.buf, it.len, encrypt);
+			if (it.result) num++;
 		}
-
-		EVP_CIPHER_CTX_free (ctx);
-		return ret;
+		return num;
 	}
 
 	void AEADChaCha20Poly1305Encrypt (const std::vector<std::pair<uint8_t *, size_t> >& bufs, const uint8_t * key, const uint8_t * nonce, uint8_t * mac)
@@ -1025,16 +1162,35 @@ namespace crypto
 		EVP_CIPHER_CTX_free (ctx);
 	}
 
+	class ChaCha20Context
+	{
+		public:
+
+			ChaCha20Context (): m_Ctx (EVP_CIPHER_CTX_new ())
+			{
+				EVP_EncryptInit_ex (m_Ctx, EVP_chacha20 (), NULL, NULL, NULL);
+			}
+			~ChaCha20Context () { EVP_CIPHER_CTX_free (m_Ctx); }
+
+			void Process (const uint8_t * msg, size_t msgLen, const uint8_t * key, const uint8_t * nonce, uint8_t * out)
+			{
+				uint32_t iv[4];
+				iv[0] = htole32 (1); memcpy (iv + 1, nonce, 12); // counter | nonce
+				EVP_EncryptInit_ex(m_Ctx, NULL, NULL, key, (const uint8_t *)iv);
+				int outlen = 0;
+				EVP_EncryptUpdate(m_Ctx, out, &outlen, msg, msgLen);
+				EVP_EncryptFinal_ex(m_Ctx, NULL, &outlen);
+			}
+
+		private:
+
+			EVP_CIPHER_CTX * m_Ctx;
+	};
+
 	void ChaCha20 (const uint8_t * msg, size_t msgLen, const uint8_t * key, const uint8_t * nonce, uint8_t * out)
 	{
-		EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new ();
-		uint32_t iv[4];
-		iv[0] = htole32 (1); memcpy (iv + 1, nonce, 12); // counter | nonce
-		EVP_EncryptInit_ex(ctx, EVP_chacha20 (), NULL, key, (const uint8_t *)iv);
-		int outlen = 0;
-		EVP_EncryptUpdate(ctx, out, &outlen, msg, msgLen);
-		EVP_EncryptFinal_ex(ctx, NULL, &outlen);
-		EVP_CIPHER_CTX_free (ctx);
+		static thread_local ChaCha20Context ctx;
+		ctx.Process (msg, msgLen, key, nonce, out);
 	}
 
 	void HKDF (const uint8_t * salt, const uint8_t * key, size_t keyLen, const std::string& info,
@@ -12,6 +12,7 @@
 #include <inttypes.h>
 #include <string>
 #include <vector>
+#include <mutex>
 #include <openssl/bn.h>
 #include <openssl/dh.h>
 #include <openssl/aes.h>
@@ -78,6 +79,7 @@ namespace crypto
 			BN_CTX * m_Ctx;
 			uint8_t m_PrivateKey[32];
 #endif
+			std::mutex m_CtxMutex; // static keys might be used from different threads
 			bool m_IsElligatorIneligible = false; // true if definitely ineligible
 	};
 
@@ -241,6 +243,13 @@ namespace crypto
 			}
 
 			void Encrypt (const uint8_t * in, uint8_t * out); // 1024 bytes (16 IV + 1008 data)
+			void Encrypt (const uint8_t * const in[], uint8_t * const out[], size_t num); // num messages of 1024 bytes
+
+		private:
+
+#if SUPPORTS_AES && IS_X86_64
+			void Encrypt4 (const uint8_t * const in[], uint8_t * const out[]); // 4 independent CBC chains interleaved
+#endif
 
 		private:
 
@@ -271,6 +280,16 @@ namespace crypto
 
 	void AEADChaCha20Poly1305Encrypt (const std::vector<std::pair<uint8_t *, size_t> >& bufs, const uint8_t * key, const uint8_t * nonce, uint8_t * mac); // encrypt multiple buffers with zero ad
 
+	struct AEADChaCha20Poly1305Message
+	{
+		const uint8_t * msg; size_t msgLen; // msgLen is len without tag
+		const uint8_t * ad; size_t adLen;
+		const uint8_t * key, * nonce;
+		uint8_t * buf; size_t len;
+		bool result;
+	};
+	size_t AEADChaCha20Poly1305Batch (std::vector<AEADChaCha20Poly1305Message>& msgs, bool encrypt); // independent messages with own keys, returns number of successful
+
 // ChaCha20
 	void ChaCha20 (const uint8_t * msg, size_t msgLen, const uint8_t * key, const uint8_t * nonce, uint8_t * out);
 
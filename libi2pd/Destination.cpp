@@ -342,6 +342,17 @@ namespace client
 			});
 	}
 
+	bool LeaseSetDestination::RunInWorker (std::function<bool ()> job, std::function<void (bool)> handler)
+	{
+		if (!i2p::garlic::workers.IsRunning ()) return false;
+		auto s = shared_from_this ();
+		return i2p::garlic::workers.Post ([s, job, handler]()
+			{
+				bool result = job ();
+				s->GetService ().post ([s, result, handler]() { handler (result); });
+			});
+	}
+
 	void LeaseSetDestination::ProcessGarlicMessage (std::shared_ptr<I2NPMessage> msg)
 	{
 		m_Service.post (std::bind (&LeaseSetDestination::HandleGarlicMessage, shared_from_this (), msg));
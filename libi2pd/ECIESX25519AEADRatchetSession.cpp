@@ -105,6 +105,28 @@ namespace garlic
 		return m_ExpirationTimestamp && ts > m_ExpirationTimestamp;
 	}
 
+	void ReceiveRatchetTagSet::UpdateLookAhead (uint64_t ts)
+	{
+		m_NumReceivedMessages++;
+		if (ts >= m_LookAheadUpdateTime + ECIESX25519_LOOKAHEAD_UPDATE_INTERVAL)
+		{
+			// twice as many tags as messages during last interval, minimum after idle time
+			int lookAhead = (ts < m_LookAheadUpdateTime + 2*ECIESX25519_LOOKAHEAD_UPDATE_INTERVAL) ?
+				2*m_NumReceivedMessages : ECIESX25519_MIN_NUM_GENERATED_TAGS;
+			if (lookAhead < ECIESX25519_MIN_NUM_GENERATED_TAGS) lookAhead = ECIESX25519_MIN_NUM_GENERATED_TAGS;
+			if (lookAhead > ECIESX25519_MAX_NUM_GENERATED_TAGS) lookAhead = ECIESX25519_MAX_NUM_GENERATED_TAGS;
+			m_LookAhead = lookAhead;
+			m_NumReceivedMessages = 0;
+			m_LookAheadUpdateTime = ts;
+		}
+		else if (2*m_NumReceivedMessages > m_LookAhead)
+		{
+			// grow during burst
+			m_LookAhead *= 2;
+			if (m_LookAhead > ECIESX25519_MAX_NUM_GENERATED_TAGS) m_LookAhead = ECIESX25519_MAX_NUM_GENERATED_TAGS;
+		}
+	}
+
 	bool ReceiveRatchetTagSet::IsIndexExpired (int index) const
 	{
 		return index < m_TrimBehindIndex;
@@ -231,7 +253,14 @@ namespace garlic
 
 	bool ECIESX25519AEADRatchetSession::HandleNewIncomingSession (const uint8_t * buf, size_t len)
 	{
-		if (!GetOwner ()) return false;
+		if (!DecryptNewIncomingSession (buf, len)) return false;
+		HandleDecryptedNewIncomingSession ();
+		return true;
+	}
+
+	bool ECIESX25519AEADRatchetSession::DecryptNewIncomingSession (const uint8_t * buf, size_t len)
+	{
+		if (!GetOwner () || len < 96) return false;
 		// we are Bob
 		// KDF1
 		i2p::crypto::InitNoiseIKState (GetNoiseState (), GetOwner ()->GetEncryptionPublicKey (i2p::data::CRYPTO_KEY_TYPE_ECIES_X25519_AEAD)); // bpk
@@ -265,10 +294,10 @@ namespace garlic
 
 		// KDF2 for payload
 		bool isStatic = !i2p::data::Tag<32> (fs).IsZero ();
+		memcpy (m_RemoteStaticKey, fs, 32); // all zeros if not static
 		if (isStatic)
 		{
 			// static key, fs is apk
-			memcpy (m_RemoteStaticKey, fs, 32);
 			if (!GetOwner ()->Decrypt (fs, sharedSecret, i2p::data::CRYPTO_KEY_TYPE_ECIES_X25519_AEAD)) // x25519(bsk, apk)
 			{
 				LogPrint (eLogWarning, "Garlic: Incorrect Alice static key");
@@ -280,24 +309,30 @@ namespace garlic
 			CreateNonce (1, nonce);
 
 		// decrypt payload
-		std::vector<uint8_t> payload (len - 16); // we must save original ciphertext
-		if (!i2p::crypto::AEADChaCha20Poly1305 (buf, len - 16, m_H, 32, m_CK + 32, nonce, payload.data (), len - 16, false)) // decrypt
+		m_NewSessionPayload.resize (len - 16); // we must save original ciphertext
+		if (!i2p::crypto::AEADChaCha20Poly1305 (buf, len - 16, m_H, 32, m_CK + 32, nonce, m_NewSessionPayload.data (), len - 16, false)) // decrypt
 		{
 			LogPrint (eLogWarning, "Garlic: Payload section AEAD verification failed");
+			m_NewSessionPayload.clear ();
 			return false;
 		}
-
-		m_State = eSessionStateNewSessionReceived;
 		if (isStatic)
-		{
 			MixHash (buf, len); // h = SHA256(h || ciphertext)
-			GetOwner ()->AddECIESx25519Session (m_RemoteStaticKey, shared_from_this ());
-		}
-		HandlePayload (payload.data (), len - 16, nullptr, 0);
 
 		return true;
 	}
 
+	void ECIESX25519AEADRatchetSession::HandleDecryptedNewIncomingSession ()
+	{
+		m_LastActivityTimestamp = i2p::util::GetSecondsSinceEpoch ();
+		m_State = eSessionStateNewSessionReceived;
+		if (!i2p::data::Tag<32> (m_RemoteStaticKey).IsZero ())
+			GetOwner ()->AddECIESx25519Session (m_RemoteStaticKey, shared_from_this ());
+		std::vector<uint8_t> payload;
+		payload.swap (m_NewSessionPayload);
+		HandlePayload (payload.data (), payload.size (), nullptr, 0);
+	}
+
 	void ECIESX25519AEADRatchetSession::HandlePayload (const uint8_t * buf, size_t len, const std::shared_ptr<ReceiveRatchetTagSet>& receiveTagset, int index)
 	{
 		size_t offset = 0;
@@ -428,8 +463,9 @@ namespace garlic
 			newTagset->SetTagSetID (tagsetID);
 			newTagset->DHInitialize (receiveTagset->GetNextRootKey (), tagsetKey);
 			newTagset->NextSessionTagRatchet ();
+			newTagset->SetLookAhead (receiveTagset->GetLookAhead ()); // peer keeps sending at the same rate
 			GenerateMoreReceiveTags (newTagset, (GetOwner () && GetOwner ()->GetNumRatchetInboundTags () > 0) ?
-				GetOwner ()->GetNumRatchetInboundTags () : ECIESX25519_MAX_NUM_GENERATED_TAGS);
+				GetOwner ()->GetNumRatchetInboundTags () : newTagset->GetLookAhead ());
 			receiveTagset->Expire ();
 			LogPrint (eLogDebug, "Garlic: Next receive tagset ", tagsetID, " created");
 		}
@@ -753,9 +789,12 @@ namespace garlic
 			}
 			else
 			{
-				moreTags = ECIESX25519_MIN_NUM_GENERATED_TAGS + (index >> 2); // N/4
-				if (moreTags > ECIESX25519_MAX_NUM_GENERATED_TAGS) moreTags = ECIESX25519_MAX_NUM_GENERATED_TAGS;
-				moreTags -= (receiveTagset->GetNextIndex () - index);
+				// look ahead follows message rate of this tagset, generate tags in batches
+				receiveTagset->UpdateLookAhead (m_LastActivityTimestamp);
+				int lookAhead = receiveTagset->GetLookAhead ();
+				int numTagsAhead = receiveTagset->GetNextIndex () - index;
+				if (numTagsAhead < lookAhead/2)
+					moreTags = lookAhead - numTagsAhead;
 				index -= ECIESX25519_MAX_NUM_GENERATED_TAGS; // trim behind
 			}
 			if (moreTags > 0)
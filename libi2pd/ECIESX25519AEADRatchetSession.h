@@ -35,6 +35,7 @@ namespace garlic
 	const int ECIESX25519_MIN_NUM_GENERATED_TAGS = 24;
 	const int ECIESX25519_MAX_NUM_GENERATED_TAGS = 320;
 	const int ECIESX25519_NSR_NUM_GENERATED_TAGS = 12;
+	const int ECIESX25519_LOOKAHEAD_UPDATE_INTERVAL = 10; // in seconds
 
 	const size_t ECIESX25519_OPTIMAL_PAYLOAD_SIZE = 1912; // 1912 = 1956 /* to fit 2 tunnel messages */
 	// - 16 /* I2NP header */ - 16 /* poly hash */ - 8 /* tag */ - 4 /* garlic length */
@@ -84,6 +85,10 @@ namespace garlic
 			void Expire ();
 			bool IsExpired (uint64_t ts) const;
 
+			int GetLookAhead () const { return m_LookAhead; };
+			void SetLookAhead (int lookAhead) { m_LookAhead = lookAhead; };
+			void UpdateLookAhead (uint64_t ts); // for received message, ts in seconds
+
 			virtual bool IsIndexExpired (int index) const;
 			virtual bool HandleNextMessage (uint8_t * buf, size_t len, int index);
 			virtual bool IsSessionTerminated () const;
@@ -94,6 +99,9 @@ namespace garlic
 			std::shared_ptr<ECIESX25519AEADRatchetSession> m_Session;
 			bool m_IsNS;
 			uint64_t m_ExpirationTimestamp = 0;
+			int m_LookAhead = ECIESX25519_MIN_NUM_GENERATED_TAGS; // number of tags to keep generated ahead
+			int m_NumReceivedMessages = 0; // since m_LookAheadUpdateTime
+			uint64_t m_LookAheadUpdateTime = 0;
 	};
 
 	class SymmetricKeyTagSet: public ReceiveRatchetTagSet
@@ -157,6 +165,9 @@ namespace garlic
 			~ECIESX25519AEADRatchetSession ();
 
 			bool HandleNextMessage (uint8_t * buf, size_t len, std::shared_ptr<ReceiveRatchetTagSet> receiveTagset, int index = 0);
+			// new incoming session in two steps, decryption might run in another thread
+			bool DecryptNewIncomingSession (const uint8_t * buf, size_t len);
+			void HandleDecryptedNewIncomingSession ();
 			std::shared_ptr<I2NPMessage> WrapSingleMessage (std::shared_ptr<const I2NPMessage> msg);
 			std::shared_ptr<I2NPMessage> WrapOneTimeMessage (std::shared_ptr<const I2NPMessage> msg);
 
@@ -222,6 +233,7 @@ namespace garlic
 			bool m_SendReverseKey = false, m_SendForwardKey = false, m_IsTerminated = false;
 			std::unique_ptr<DHRatchet> m_NextReceiveRatchet, m_NextSendRatchet;
 			uint8_t m_PaddingSizes[32], m_NextPaddingSize;
+			std::vector<uint8_t> m_NewSessionPayload; // decrypted, for incoming only
 
 		public:
 
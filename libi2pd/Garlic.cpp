@@ -19,6 +19,7 @@
 #include "Timestamp.h"
 #include "Log.h"
 #include "FS.h"
+#include "util.h"
 #include "ECIESX25519AEADRatchetSession.h"
 #include "Garlic.h"
 
@@ -454,7 +455,7 @@ namespace garlic
 			it.second->SetOwner (nullptr);
 		}
 		m_ECIESx25519Sessions.clear ();
-		m_ECIESx25519Tags.clear ();
+		m_ECIESx25519Tags.Clear ();
 	}
 	void GarlicDestination::AddSessionKey (const uint8_t * key, const uint8_t * tag)
 	{
@@ -475,7 +476,7 @@ namespace garlic
 	void GarlicDestination::AddECIESx25519Key (const uint8_t * key, uint64_t tag)
 	{
 		auto tagset = std::make_shared<SymmetricKeyTagSet>(this, key);
-		m_ECIESx25519Tags.emplace (tag, ECIESX25519AEADRatchetIndexTagset{0, tagset});
+		m_ECIESx25519Tags.Insert (tag, ECIESX25519AEADRatchetIndexTagset{0, tagset});
 	}
 
 	bool GarlicDestination::SubmitSessionKey (const uint8_t * key, const uint8_t * tag)
@@ -545,35 +546,9 @@ namespace garlic
 				{
 					// otherwise ECIESx25519
 					auto session = std::make_shared<ECIESX25519AEADRatchetSession> (this, false); // incoming
-					if (!session->HandleNextMessage (buf, length, nullptr, 0))
-					{
-						// try to generate more tags for last tagset
-						if (m_LastTagset && (m_LastTagset->GetNextIndex () - m_LastTagset->GetTrimBehind () < 3*ECIESX25519_MAX_NUM_GENERATED_TAGS))
-						{
-							uint64_t missingTag; memcpy (&missingTag, buf, 8);
-							auto maxTags = std::max (m_NumRatchetInboundTags, ECIESX25519_MAX_NUM_GENERATED_TAGS);
-							LogPrint (eLogWarning, "Garlic: Trying to generate more ECIES-X25519-AEAD-Ratchet tags");
-							for (int i = 0; i < maxTags; i++)
-							{
-								auto nextTag = AddECIESx25519SessionNextTag (m_LastTagset);
-								if (!nextTag)
-								{
-									LogPrint (eLogError, "Garlic: Can't create new ECIES-X25519-AEAD-Ratchet tag for last tagset");
-									break;
-								}
-								if (nextTag == missingTag)
-								{
-									LogPrint (eLogDebug, "Garlic: Missing ECIES-X25519-AEAD-Ratchet tag was generated");
-									if (m_LastTagset->HandleNextMessage (buf, length, m_ECIESx25519Tags[nextTag].index))
-										found = true;
-									break;
-								}
-							}
-							if (!found) m_LastTagset = nullptr;
-						}
-						if (!found)
-							LogPrint (eLogError, "Garlic: Can't handle ECIES-X25519-AEAD-Ratchet message");
-					}
+					if (!RunInWorker ([session, msg, buf, length]() { return session->DecryptNewIncomingSession (buf, length); },
+						[this, session, msg, buf, length](bool decrypted) { HandleNewIncomingECIESx25519Session (session, decrypted, buf, length); }))
+						HandleNewIncomingECIESx25519Session (session, session->DecryptNewIncomingSession (buf, length), buf, length);
 				}
 				else
 					LogPrint (eLogError, "Garlic: Failed to decrypt message");
@@ -581,18 +556,57 @@ namespace garlic
 		}
 	}
 
+	void GarlicDestination::HandleNewIncomingECIESx25519Session (ECIESX25519AEADRatchetSessionPtr session, bool decrypted,
+		uint8_t * buf, size_t length)
+	{
+		if (decrypted)
+		{
+			session->HandleDecryptedNewIncomingSession ();
+			return;
+		}
+		bool found = false;
+		// try to generate more tags for last tagset
+		if (m_LastTagset && (m_LastTagset->GetNextIndex () - m_LastTagset->GetTrimBehind () < 3*ECIESX25519_MAX_NUM_GENERATED_TAGS))
+		{
+			uint64_t missingTag; memcpy (&missingTag, buf, 8);
+			auto maxTags = std::max (m_NumRatchetInboundTags, ECIESX25519_MAX_NUM_GENERATED_TAGS);
+			LogPrint (eLogWarning, "Garlic: Trying to generate more ECIES-X25519-AEAD-Ratchet tags");
+			for (int i = 0; i < maxTags; i++)
+			{
+				auto nextTag = AddECIESx25519SessionNextTag (m_LastTagset);
+				if (!nextTag)
+				{
+					LogPrint (eLogError, "Garlic: Can't create new ECIES-X25519-AEAD-Ratchet tag for last tagset");
+					break;
+				}
+				if (nextTag == missingTag)
+				{
+					LogPrint (eLogDebug, "Garlic: Missing ECIES-X25519-AEAD-Ratchet tag was generated");
+					auto indexTagset = m_ECIESx25519Tags.Find (nextTag);
+					if (indexTagset && m_LastTagset->HandleNextMessage (buf, length, indexTagset->index))
+						found = true;
+					break;
+				}
+			}
+			if (!found) m_LastTagset = nullptr;
+		}
+		if (!found)
+			LogPrint (eLogError, "Garlic: Can't handle ECIES-X25519-AEAD-Ratchet message");
+	}
+
 	bool GarlicDestination::HandleECIESx25519TagMessage (uint8_t * buf, size_t len)
 	{
 		uint64_t tag;
 		memcpy (&tag, buf, 8);
-		auto it = m_ECIESx25519Tags.find (tag);
-		if (it != m_ECIESx25519Tags.end ())
+		auto it = m_ECIESx25519Tags.Find (tag);
+		if (it)
 		{
-			if (it->second.tagset && it->second.tagset->HandleNextMessage (buf, len, it->second.index))
-				m_LastTagset = it->second.tagset;
+			auto indexTagset = *it;
+			m_ECIESx25519Tags.Erase (tag); // before new tags get added by tagset
+			if (indexTagset.tagset && indexTagset.tagset->HandleNextMessage (buf, len, indexTagset.index))
+				m_LastTagset = indexTagset.tagset;
 			else
 				LogPrint (eLogError, "Garlic: Can't handle ECIES-X25519-AEAD-Ratchet message");
-			m_ECIESx25519Tags.erase (it);
 			return true;
 		}
 		return false;
@@ -876,26 +890,16 @@ namespace garlic
 				++it;
 		}
 
-		numExpiredTags = 0;
-		for (auto it = m_ECIESx25519Tags.begin (); it != m_ECIESx25519Tags.end ();)
-		{
-			if (it->second.tagset->IsExpired (ts) || it->second.tagset->IsIndexExpired (it->second.index))
+		numExpiredTags = m_ECIESx25519Tags.EraseIf (
+			[ts](uint64_t, ECIESX25519AEADRatchetIndexTagset& it)
 			{
-				it->second.tagset->DeleteSymmKey (it->second.index);
-				it = m_ECIESx25519Tags.erase (it);
-				numExpiredTags++;
-			}
-			else
-			{
-				if (it->second.tagset->IsSessionTerminated ())
+				if (it.tagset->IsExpired (ts) || it.tagset->IsIndexExpired (it.index))
 				{
-					it = m_ECIESx25519Tags.erase (it);
-					numExpiredTags++;
+					it.tagset->DeleteSymmKey (it.index);
+					return true;
 				}
-				else
-					++it;
-			}
-		}
+				return it.tagset->IsSessionTerminated ();
+			});
 		if (numExpiredTags > 0)
 			LogPrint (eLogDebug, "Garlic: ", numExpiredTags, " ECIESx25519 tags expired for ", GetIdentHash().ToBase64 ());
 		if (m_LastTagset && m_LastTagset->IsExpired (ts))
@@ -1092,7 +1096,7 @@ namespace garlic
 		auto index = tagset->GetNextIndex ();
 		uint64_t tag = tagset->GetNextSessionTag ();
 		if (tag)
-			m_ECIESx25519Tags.emplace (tag, ECIESX25519AEADRatchetIndexTagset{index, tagset});
+			m_ECIESx25519Tags.Insert (tag, ECIESX25519AEADRatchetIndexTagset{index, tagset});
 		return tag;
 	}
 
@@ -1132,5 +1136,56 @@ namespace garlic
 			m_PayloadBuffer = new uint8_t[I2NP_MAX_MESSAGE_SIZE];
 		return m_PayloadBuffer;
 	}
+
+	GarlicWorkers workers;
+
+	void GarlicWorkers::Start (int numThreads)
+	{
+		if (m_IsRunning || numThreads <= 0) return;
+		if (numThreads > GARLIC_MAX_NUM_WORKER_THREADS) numThreads = GARLIC_MAX_NUM_WORKER_THREADS;
+		m_IsRunning = true;
+		for (int i = 0; i < numThreads; i++)
+			m_Threads.emplace_back (new std::thread (std::bind (&GarlicWorkers::Run, this)));
+	}
+
+	void GarlicWorkers::Stop ()
+	{
+		{
+			std::unique_lock<std::mutex> l(m_JobsMutex);
+			m_IsRunning = false;
+			m_JobsAvailable.notify_all ();
+		}
+		for (auto& it: m_Threads)
+			it->join ();
+		m_Threads.clear ();
+		m_Jobs.clear ();
+	}
+
+	bool GarlicWorkers::Post (Job job)
+	{
+		std::unique_lock<std::mutex> l(m_JobsMutex);
+		if (!m_IsRunning || m_Jobs.size () >= GARLIC_WORKERS_MAX_QUEUE_SIZE) return false;
+		m_Jobs.push_back (std::move (job));
+		m_JobsAvailable.notify_one ();
+		return true;
+	}
+
+	void GarlicWorkers::Run ()
+	{
+		i2p::util::SetThreadName ("Garlic");
+		while (m_IsRunning)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> l(m_JobsMutex);
+				while (m_Jobs.empty () && m_IsRunning)
+					m_JobsAvailable.wait (l);
+				if (!m_IsRunning) break;
+				job = std::move (m_Jobs.front ());
+				m_Jobs.pop_front ();
+			}
+			job ();
+		}
+	}
 }
 }
@@ -15,12 +15,18 @@
 #include <string>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include "Crypto.h"
 #include "I2NPProtocol.h"
 #include "LeaseSet.h"
 #include "Queue.h"
 #include "Identity.h"
+#include "SessionTagsTable.h"
 
 namespace i2p
 {
@@ -53,6 +59,8 @@ namespace garlic
 	const int LEASESET_CONFIRMATION_TIMEOUT = 4000; // in milliseconds
 	const int ROUTING_PATH_EXPIRATION_TIMEOUT = 30; // 30 seconds
 	const int ROUTING_PATH_MAX_NUM_TIMES_USED = 100; // how many times might be used
+	const int GARLIC_MAX_NUM_WORKER_THREADS = 8;
+	const size_t GARLIC_WORKERS_MAX_QUEUE_SIZE = 1024; // jobs, handled by destination's thread if exceeded
 
 	struct SessionTag: public i2p::data::Tag<32>
 	{
@@ -262,6 +270,10 @@ namespace garlic
 
 		protected:
 
+			// runs job in worker thread, then handler with job's result in destination's thread
+			// returns false if not supported, caller should do both itself
+			virtual bool RunInWorker (std::function<bool ()> job, std::function<void (bool)> handler) { return false; };
+
 			void AddECIESx25519Key (const uint8_t * key, const uint8_t * tag); // one tag
 			bool HandleECIESx25519TagMessage (uint8_t * buf, size_t len); // return true if found
 			virtual void HandleI2NPMessage (const uint8_t * buf, size_t len) = 0; // called from clove only
@@ -277,6 +289,8 @@ namespace garlic
 			void HandleAESBlock (uint8_t * buf, size_t len, std::shared_ptr<AESDecryption> decryption,
 				std::shared_ptr<i2p::tunnel::InboundTunnel> from);
 			void HandleGarlicPayload (uint8_t * buf, size_t len, std::shared_ptr<i2p::tunnel::InboundTunnel> from);
+			void HandleNewIncomingECIESx25519Session (ECIESX25519AEADRatchetSessionPtr session, bool decrypted,
+				uint8_t * buf, size_t len);
 
 		private:
 
@@ -289,7 +303,7 @@ namespace garlic
 			// incoming
 			int m_NumRatchetInboundTags;
 			std::unordered_map<SessionTag, std::shared_ptr<AESDecryption>, std::hash<i2p::data::Tag<32> > > m_Tags;
-			std::unordered_map<uint64_t, ECIESX25519AEADRatchetIndexTagset> m_ECIESx25519Tags; // session tag -> session
+			SessionTagsTable<ECIESX25519AEADRatchetIndexTagset> m_ECIESx25519Tags; // session tag -> session
 			ReceiveRatchetTagSetPtr m_LastTagset; // tagset last message came for
 			// DeliveryStatus
 			std::mutex m_DeliveryStatusSessionsMutex;
@@ -299,13 +313,41 @@ namespace garlic
 
 			// for HTTP only
 			size_t GetNumIncomingTags () const { return m_Tags.size (); }
-			size_t GetNumIncomingECIESx25519Tags () const { return m_ECIESx25519Tags.size (); }
+			size_t GetNumIncomingECIESx25519Tags () const { return m_ECIESx25519Tags.GetSize (); }
 			const decltype(m_Sessions)& GetSessions () const { return m_Sessions; };
 			const decltype(m_ECIESx25519Sessions)& GetECIESx25519Sessions () const { return m_ECIESx25519Sessions; }
 	};
 
 	void CleanUpTagsFiles ();
 
+	class GarlicWorkers
+	{
+		// decrypt new incoming sessions of all destinations
+		public:
+
+			typedef std::function<void ()> Job;
+
+			GarlicWorkers (): m_IsRunning (false) {};
+			~GarlicWorkers () { Stop (); };
+
+			void Start (int numThreads);
+			void Stop ();
+			bool IsRunning () const { return m_IsRunning; };
+			bool Post (Job job); // false if queue is full
+
+		private:
+
+			void Run ();
+
+		private:
+
+			std::atomic<bool> m_IsRunning;
+			std::vector<std::unique_ptr<std::thread> > m_Threads;
+			std::mutex m_JobsMutex;
+			std::condition_variable m_JobsAvailable;
+			std::deque<Job> m_Jobs;
+	};
+	extern GarlicWorkers workers;
 }
 }
 
@@ -165,9 +165,10 @@ namespace tunnel
 		std::shared_ptr<i2p::tunnel::InboundTunnel> from;
 		std::function<void ()> onDrop;
 		uint64_t enqueueTime; // monotonic microseconds
+		bool isTransit; // forwarded for transit tunnel, sent with lower priority
 
 		I2NPMessage (): buf (nullptr), len (I2NP_HEADER_SIZE + 2),
-			offset(2), maxLen (0), from (nullptr), enqueueTime (0) {}; // reserve 2 bytes for NTCP header
+			offset(2), maxLen (0), from (nullptr), enqueueTime (0), isTransit (false) {}; // reserve 2 bytes for NTCP header
 
 		// header accessors
 		uint8_t * GetHeader () { return GetBuffer (); };
@@ -6,6 +6,7 @@
 * See full license text in LICENSE file at top of project tree
 */
 
+#include <thread>
 #include "Crypto.h"
 #include "I2PEndian.h"
 #include "Log.h"
@@ -43,11 +44,12 @@ namespace data
 	}
 
 	IdentityEx::IdentityEx ():
-		m_ExtendedLen (0)
+		m_VerifierState (eVerifierNoPublicKey), m_ExtendedLen (0)
 	{
 	}
 
-	IdentityEx::IdentityEx(const uint8_t * publicKey, const uint8_t * signingKey, SigningKeyType type, CryptoKeyType cryptoType)
+	IdentityEx::IdentityEx(const uint8_t * publicKey, const uint8_t * signingKey, SigningKeyType type, CryptoKeyType cryptoType):
+		m_VerifierState (eVerifierNoPublicKey)
 	{
 		uint8_t randomPaddingBlock[32];
 		RAND_bytes (randomPaddingBlock, 32);
@@ -168,19 +170,19 @@ namespace data
 	}
 
 	IdentityEx::IdentityEx (const uint8_t * buf, size_t len):
-		m_ExtendedLen (0)
+		m_VerifierState (eVerifierNoPublicKey), m_ExtendedLen (0)
 	{
 		FromBuffer (buf, len);
 	}
 
 	IdentityEx::IdentityEx (const IdentityEx& other):
-		m_ExtendedLen (0)
+		m_VerifierState (eVerifierNoPublicKey), m_ExtendedLen (0)
 	{
 		*this = other;
 	}
 
 	IdentityEx::IdentityEx (const Identity& standard):
-		m_ExtendedLen (0)
+		m_VerifierState (eVerifierNoPublicKey), m_ExtendedLen (0)
 	{
 		*this = standard;
 	}
@@ -311,7 +313,11 @@ namespace data
 	bool IdentityEx::Verify (const uint8_t * buf, size_t len, const uint8_t * signature) const
 	{
 		if (m_Verifier)
+		{
+			if (m_VerifierState.load (std::memory_order_acquire) != eVerifierReady)
+				SetVerifierPublicKey ();
 			return m_Verifier->Verify (buf, len, signature);
+		}
 		return false;
 	}
 
@@ -370,24 +376,37 @@ namespace data
 	{
 		if (!m_Verifier)
 		{
-			auto verifier = CreateVerifier (GetSigningKeyType ());
-			if (verifier)
+			// public key is decoded at first verification, most identities are never verified after loading
+			m_Verifier.reset (CreateVerifier (GetSigningKeyType ()));
+			m_VerifierState.store (eVerifierNoPublicKey, std::memory_order_release);
+		}
+	}
+
+	void IdentityEx::SetVerifierPublicKey () const
+	{
+		int state = eVerifierNoPublicKey;
+		if (m_VerifierState.compare_exchange_strong (state, eVerifierSettingPublicKey, std::memory_order_acquire))
+		{
+			auto keyLen = m_Verifier->GetPublicKeyLen ();
+			if (keyLen <= 128)
+				m_Verifier->SetPublicKey (m_StandardIdentity.signingKey + 128 - keyLen);
+			else
 			{
-				auto keyLen = verifier->GetPublicKeyLen ();
-				if (keyLen <= 128)
-					verifier->SetPublicKey (m_StandardIdentity.signingKey + 128 - keyLen);
-				else
-				{
-					// for P521
-					uint8_t * signingKey = new uint8_t[keyLen];
-					memcpy (signingKey, m_StandardIdentity.signingKey, 128);
-					size_t excessLen = keyLen - 128;
-					memcpy (signingKey + 128, m_ExtendedBuffer + 4, excessLen); // right after signing and crypto key types
-					verifier->SetPublicKey (signingKey);
-					delete[] signingKey;
-				}
+				// for P521
+				uint8_t * signingKey = new uint8_t[keyLen];
+				memcpy (signingKey, m_StandardIdentity.signingKey, 128);
+				size_t excessLen = keyLen - 128;
+				memcpy (signingKey + 128, m_ExtendedBuffer + 4, excessLen); // right after signing and crypto key types
+				m_Verifier->SetPublicKey (signingKey);
+				delete[] signingKey;
 			}
-			m_Verifier.reset (verifier);
+			m_VerifierState.store (eVerifierReady, std::memory_order_release);
+		}
+		else
+		{
+			// being set by another thread
+			while (m_VerifierState.load (std::memory_order_acquire) != eVerifierReady)
+				std::this_thread::yield ();
 		}
 	}
 
@@ -797,12 +816,19 @@ namespace data
 
 	IdentHash CreateRoutingKey (const IdentHash& ident, bool nextDay)
 	{
-		uint8_t buf[41]; // ident + yyyymmdd
-		memcpy (buf, (const uint8_t *)ident, 32);
+		char date[9]; // yyyymmdd
 		if (nextDay)
-			i2p::util::GetNextDayDate ((char *)(buf + 32));
+			i2p::util::GetNextDayDate (date);
 		else	
-			i2p::util::GetCurrentDate ((char *)(buf + 32));
+			i2p::util::GetCurrentDate (date);
+		return CreateRoutingKey (ident, date);
+	}
+
+	IdentHash CreateRoutingKey (const IdentHash& ident, const char * date)
+	{
+		uint8_t buf[40]; // ident + yyyymmdd
+		memcpy (buf, (const uint8_t *)ident, 32);
+		memcpy (buf + 32, date, 8);
 		IdentHash key;
 		SHA256(buf, 40, key);
 		return key;
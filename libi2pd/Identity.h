@@ -14,6 +14,7 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <atomic>
 #include "Base.h"
 #include "Signature.h"
 #include "CryptoKey.h"
@@ -126,12 +127,21 @@ namespace data
 		private:
 
 			void CreateVerifier ();
+			void SetVerifierPublicKey () const; // on first verification
 			
 		private:
 
+			enum VerifierState
+			{
+				eVerifierNoPublicKey = 0,
+				eVerifierSettingPublicKey,
+				eVerifierReady
+			};	
+
 			Identity m_StandardIdentity;
 			IdentHash m_IdentHash;
 			std::unique_ptr<i2p::crypto::Verifier> m_Verifier;
+			mutable std::atomic<int> m_VerifierState;
 			size_t m_ExtendedLen;
 			uint8_t m_ExtendedBuffer[MAX_EXTENDED_BUFFER_SIZE];
 	};
@@ -207,6 +217,7 @@ namespace data
 	};
 
 	IdentHash CreateRoutingKey (const IdentHash& ident, bool nextDay = false);
+	IdentHash CreateRoutingKey (const IdentHash& ident, const char * date); // date is YYYYMMDD
 	XORMetric operator^(const IdentHash& key1, const IdentHash& key2);
 
 	// destination for delivery instructions
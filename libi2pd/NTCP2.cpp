@@ -375,9 +375,7 @@ namespace transport
 			m_Socket.close ();
 			transports.PeerDisconnected (shared_from_this ());
 			m_Server.RemoveNTCP2Session (shared_from_this ());
-			for (auto& it: m_SendQueue)
-				it->Drop ();
-			m_SendQueue.clear ();
+			m_SendQueue.DropAll ();
 			SetSendQueueSize (0);
 			auto remoteIdentity = GetRemoteIdentity ();
 			if (remoteIdentity)
@@ -1004,6 +1002,7 @@ namespace transport
 		size_t totalLen = 0;
 		std::vector<std::pair<uint8_t *, size_t> > encryptBufs;
 		std::vector<boost::asio::const_buffer> bufs;
+		encryptBufs.reserve (msgs.size () + 1); bufs.reserve (msgs.size () + 1); // + padding
 		std::shared_ptr<I2NPMessage> first;
 		uint8_t * macBuf = nullptr;
 		for (auto& it: msgs)
@@ -1045,15 +1044,13 @@ namespace transport
 
 		if (!macBuf) // last block was not enough for MAC
 		{
-			// allocate send buffer
-			m_NextSendBuffer = new uint8_t[287]; // can be any size > 16, we just allocate 287 frequently
-			// create padding block
-			auto paddingLen = CreatePaddingBlock (totalLen, m_NextSendBuffer, 287 - 16);
+			// create padding block in tail buffer
+			auto paddingLen = CreatePaddingBlock (totalLen, m_SendTailBuffer, NTCP2_SEND_TAIL_BUFFER_SIZE - 16);
 			// and padding block to encrypt and send
 			if (paddingLen)
-				encryptBufs.push_back ( {m_NextSendBuffer, paddingLen} );
-			bufs.push_back (boost::asio::buffer (m_NextSendBuffer, paddingLen + 16));
-			macBuf = m_NextSendBuffer + paddingLen;
+				encryptBufs.push_back ( {m_SendTailBuffer, paddingLen} );
+			bufs.push_back (boost::asio::buffer (m_SendTailBuffer, paddingLen + 16));
+			macBuf = m_SendTailBuffer + paddingLen;
 			totalLen += paddingLen;
 		}
 		if (totalLen > NTCP2_UNENCRYPTED_FRAME_MAX_SIZE)
@@ -1127,26 +1124,25 @@ namespace transport
 			else
 			{
 				SendQueue ();
-				SetSendQueueSize (m_SendQueue.size ());
+				SetSendQueueSize (m_SendQueue.GetSize ());
 			}
 		}
 	}
 
 	void NTCP2Session::SendQueue ()
 	{
-		if (!m_SendQueue.empty () && m_IsEstablished)
+		if (!m_SendQueue.IsEmpty () && m_IsEstablished)
 		{
 			std::vector<std::shared_ptr<I2NPMessage> > msgs;
 			auto ts = i2p::util::GetMillisecondsSinceEpoch ();
+			auto mts = i2p::util::GetMonotonicMicroseconds ();
 			size_t s = 0;
-			while (!m_SendQueue.empty ())
+			while (auto msg = m_SendQueue.GetFront (mts))
 			{
-				auto msg = m_SendQueue.front ();
-				if (!msg || msg->IsExpired (ts))
+				if (msg->IsExpired (ts))
 				{
-					// drop null or expired message
-					if (msg) msg->Drop ();
-					m_SendQueue.pop_front ();
+					// drop expired message
+					m_SendQueue.DropFront ();
 					continue;
 				}	
 				size_t len = msg->GetNTCP2Length ();
@@ -1154,15 +1150,14 @@ namespace transport
 				{
 					msgs.push_back (msg);
 					s += (len + 3);
-					m_SendQueue.pop_front ();
+					m_SendQueue.PopFront (mts);
 					if (s >= NTCP2_SEND_AFTER_FRAME_SIZE)
 						break; // send frame right a way
 				}
 				else if (len + 3 > NTCP2_UNENCRYPTED_FRAME_MAX_SIZE)
 				{
 					LogPrint (eLogError, "NTCP2: I2NP message of size ", len, " can't be sent. Dropped");
-					msg->Drop ();
-					m_SendQueue.pop_front ();
+					m_SendQueue.DropFront ();
 				}
 				else
 					break;
@@ -1173,15 +1168,15 @@ namespace transport
 
 	void NTCP2Session::MoveSendQueue (std::shared_ptr<NTCP2Session> other)
 	{
-		if (!other || m_SendQueue.empty ()) return;
-		std::vector<std::shared_ptr<I2NPMessage> > msgs;
+		if (!other || m_SendQueue.IsEmpty ()) return;
+		std::vector<std::shared_ptr<I2NPMessage> > queue, msgs;
+		m_SendQueue.GetAll (queue);
 		auto ts = i2p::util::GetMillisecondsSinceEpoch ();
-		for (auto it: m_SendQueue)
+		for (auto& it: queue)
 			if (!it->IsExpired (ts))
 				msgs.push_back (it);
 			else
 				it->Drop ();
-		m_SendQueue.clear ();
 		if (!msgs.empty ())
 			other->PostI2NPMessages (msgs);
 	}	
@@ -1217,10 +1212,10 @@ namespace transport
 	void NTCP2Session::SendRouterInfo ()
 	{
 		if (!IsEstablished ()) return;
-		auto riBuffer =  i2p::context.CopyRouterInfoBuffer ();
+		auto riBuffer =  i2p::context.CopyRouterInfoBuffer (); // our own copy, encrypted in place
 		auto riLen = riBuffer->GetBufferLen ();
 		size_t payloadLen = riLen + 3 + 1 + 7; // 3 bytes block header + 1 byte RI flag + 7 bytes DateTime
-		m_NextSendBuffer = new uint8_t[payloadLen + 16 + 2 + 64]; // up to 64 bytes padding
+		m_NextSendBuffer = new uint8_t[NTCP2_ROUTERINFO_FRAME_HEADER_SIZE + 64 + 16]; // headers, up to 64 bytes padding and MAC
 		// DateTime	block
 		m_NextSendBuffer[2] = eNTCP2BlkDateTime;
 		htobe16buf (m_NextSendBuffer + 3, 4);
@@ -1229,12 +1224,49 @@ namespace transport
 		m_NextSendBuffer[9] = eNTCP2BlkRouterInfo;
 		htobe16buf (m_NextSendBuffer + 10, riLen + 1); // size
 		m_NextSendBuffer[12] = 0; // flag
-		memcpy (m_NextSendBuffer + 13, riBuffer->data (), riLen); // TODO: eliminate extra copy
-		// padding block
-		auto paddingSize = CreatePaddingBlock (payloadLen, m_NextSendBuffer + 2 + payloadLen, 64);
+		// padding block after RouterInfo
+		uint8_t * tail = m_NextSendBuffer + NTCP2_ROUTERINFO_FRAME_HEADER_SIZE;
+		auto paddingSize = CreatePaddingBlock (payloadLen, tail, 64);
 		payloadLen += paddingSize;
-		// encrypt and send
-		EncryptAndSendNextBuffer (payloadLen);
+		// same checks as EncryptAndSendNextBuffer
+		if (IsTerminated ())
+		{
+			delete[] m_NextSendBuffer; m_NextSendBuffer = nullptr;
+			return;
+		}
+		if (payloadLen > NTCP2_UNENCRYPTED_FRAME_MAX_SIZE)
+		{
+			LogPrint (eLogError, "NTCP2: RouterInfo frame to send is too long ", payloadLen);
+			delete[] m_NextSendBuffer; m_NextSendBuffer = nullptr;
+			return;
+		}
+		// encrypt headers, RouterInfo and padding without copying RouterInfo
+		uint8_t nonce[12];
+		CreateNonce (m_SendSequenceNumber, nonce); m_SendSequenceNumber++;
+		std::vector<std::pair<uint8_t *, size_t> > encryptBufs =
+		{
+			{ m_NextSendBuffer + 2, NTCP2_ROUTERINFO_FRAME_HEADER_SIZE - 2 },
+			{ riBuffer->data (), riLen }
+		};
+		if (paddingSize) encryptBufs.push_back ( {tail, paddingSize} );
+		i2p::crypto::AEADChaCha20Poly1305Encrypt (encryptBufs, m_SendKey, nonce, tail + paddingSize);
+		SetNextSentFrameLength (payloadLen + 16, m_NextSendBuffer);
+		// send
+		std::vector<boost::asio::const_buffer> bufs =
+		{
+			boost::asio::buffer (m_NextSendBuffer, NTCP2_ROUTERINFO_FRAME_HEADER_SIZE),
+			boost::asio::buffer (riBuffer->data (), riLen),
+			boost::asio::buffer (tail, paddingSize + 16)
+		};
+		m_IsSending = true;
+		boost::asio::async_write (m_Socket, bufs, boost::asio::transfer_all (),
+			std::bind(&NTCP2Session::HandleRouterInfoSent, shared_from_this (), std::placeholders::_1, std::placeholders::_2, riBuffer));
+	}
+
+	void NTCP2Session::HandleRouterInfoSent (const boost::system::error_code& ecode, std::size_t bytes_transferred, std::shared_ptr<i2p::data::RouterInfo::Buffer> riBuffer)
+	{
+		HandleNextFrameSent (ecode, bytes_transferred);
+		// riBuffer gets destroyed here
 	}
 
 	void NTCP2Session::SendTermination (NTCP2TerminationReason reason)
@@ -1272,22 +1304,23 @@ namespace transport
 	void NTCP2Session::PostI2NPMessages (std::vector<std::shared_ptr<I2NPMessage> > msgs)
 	{
 		if (m_IsTerminated) return;
-		bool isSemiFull = m_SendQueue.size () > NTCP2_MAX_OUTGOING_QUEUE_SIZE/2;
+		bool isSemiFull = m_SendQueue.GetSize () > NTCP2_MAX_OUTGOING_QUEUE_SIZE/2;
+		auto mts = i2p::util::GetMonotonicMicroseconds ();
 		for (auto it: msgs)
 			if (isSemiFull && it->onDrop)
 				it->Drop (); // drop earlier because we can handle it
 			else
-				m_SendQueue.push_back (std::move (it));
+				m_SendQueue.Put (std::move (it), mts);
 		
 		if (!m_IsSending && m_IsEstablished)
 			SendQueue ();
-		else if (m_SendQueue.size () > NTCP2_MAX_OUTGOING_QUEUE_SIZE)
+		else if (m_SendQueue.GetSize () > NTCP2_MAX_OUTGOING_QUEUE_SIZE)
 		{
 			LogPrint (eLogWarning, "NTCP2: Outgoing messages queue size to ",
 				GetIdentHashBase64(), " exceeds ", NTCP2_MAX_OUTGOING_QUEUE_SIZE);
 			Terminate ();
 		}
-		SetSendQueueSize (m_SendQueue.size ());
+		SetSendQueueSize (m_SendQueue.GetSize ());
 	}
 
 	void NTCP2Session::SendLocalRouterInfo (bool update)
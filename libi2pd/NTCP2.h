@@ -31,6 +31,8 @@ namespace transport
 	const size_t NTCP2_SEND_AFTER_FRAME_SIZE = 16386; // send frame when exceeds this size
 	const size_t NTCP2_SESSION_REQUEST_MAX_SIZE = 287;
 	const size_t NTCP2_SESSION_CREATED_MAX_SIZE = 287;
+	const size_t NTCP2_SEND_TAIL_BUFFER_SIZE = 287; // padding block and MAC if last message doesn't have room
+	const size_t NTCP2_ROUTERINFO_FRAME_HEADER_SIZE = 13; // 2 bytes length + 7 bytes DateTime + 3 bytes block header + 1 byte flag
 	const int NTCP2_MAX_PADDING_RATIO = 6; // in %
 
 	const int NTCP2_CONNECT_TIMEOUT = 5; // 5 seconds
@@ -188,6 +190,7 @@ namespace transport
 			void HandleI2NPMsgsSent (const boost::system::error_code& ecode, std::size_t bytes_transferred, std::vector<std::shared_ptr<I2NPMessage> > msgs);
 			void EncryptAndSendNextBuffer (size_t payloadLen);
 			void HandleNextFrameSent (const boost::system::error_code& ecode, std::size_t bytes_transferred);
+			void HandleRouterInfoSent (const boost::system::error_code& ecode, std::size_t bytes_transferred, std::shared_ptr<i2p::data::RouterInfo::Buffer> riBuffer);
 			size_t CreatePaddingBlock (size_t msgLen, uint8_t * buf, size_t len);
 			void SendQueue ();
 			void SendRouterInfo ();
@@ -213,6 +216,7 @@ namespace transport
 #endif
 			uint16_t m_NextReceivedLen;
 			uint8_t * m_NextReceivedBuffer, * m_NextSendBuffer;
+			uint8_t m_SendTailBuffer[NTCP2_SEND_TAIL_BUFFER_SIZE]; // for I2NP messages frame, one frame is being sent at the time
 			size_t m_NextReceivedBufferSize;
 			union
 			{
@@ -224,7 +228,7 @@ namespace transport
 			i2p::I2NPMessagesHandler m_Handler;
 
 			bool m_IsSending, m_IsReceiving;
-			std::list<std::shared_ptr<I2NPMessage> > m_SendQueue;
+			TransportSendQueue m_SendQueue;
 			uint64_t m_NextRouterInfoResendTime; // seconds since epoch
 
 			uint16_t m_PaddingSizes[16];
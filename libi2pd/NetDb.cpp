@@ -38,9 +38,29 @@ namespace data
 {
 	NetDb netdb;
 
-	NetDb::NetDb (): m_IsRunning (false), m_Thread (nullptr), m_Reseeder (nullptr), 
+	NetDbVerificationStats::NetDbVerificationStats ():
+		numVerified (0), numFailed (0), totalTime (0)
+	{
+		for (auto& it: latencies) it = 0;
+	}
+
+	void NetDbVerificationStats::AddSample (bool verified, uint64_t time)
+	{
+		if (verified) numVerified++; else numFailed++;
+		totalTime += time;
+		int bucket = 0;
+		for (uint64_t limit = NETDB_VERIFICATION_LATENCY_FIRST_BUCKET;
+			time >= limit && bucket < NETDB_VERIFICATION_LATENCY_NUM_BUCKETS - 1; limit <<= 1)
+			bucket++;
+		latencies[bucket]++;
+	}
+
+	NetDb::NetDb (): m_IsRunning (false), m_Thread (nullptr), m_Workers ("NetDbW"), m_Reseeder (nullptr), 
 		m_Storage("netDb", "r", "routerInfo-", "dat"), m_PersistProfiles (true),
-		m_LastExploratorySelectionUpdateTime (0)
+		m_LastExploratorySelectionUpdateTime (0), m_RouterInfosRoutingKeysDay (0), m_RoutingKeysDay (0),
+		m_RouterInfoBuffersPool ("RouterInfo buffers"), m_RouterInfoAddressesPool ("RouterInfo addresses"),
+		m_RouterInfoAddressVectorsPool ("RouterInfo address vectors"), m_LeasesPool ("Leases"),
+		m_IdentitiesPool ("Identities"), m_RouterProfilesPool ("Router profiles")
 	{
 	}
 
@@ -56,6 +76,13 @@ namespace data
 		m_Storage.Init(i2p::data::GetBase64SubstitutionTable(), 64);
 		InitProfilesStorage ();
 		m_Families.LoadCertificates ();
+		uint16_t numWorkers; i2p::config::GetOption ("limits.netdbthreads", numWorkers);
+		m_Workers.Start (std::min ((int)numWorkers, NETDB_MAX_NUM_WORKER_THREADS));
+		bool singleFile; i2p::config::GetOption ("persist.netdbfile", singleFile);
+		if (singleFile)
+			m_Store.reset (new NetDbStore (i2p::fs::DataDirPath (NETDB_STORE_FILENAME)));
+		else
+			m_Store = nullptr;
 		Load ();
 
 		if (!m_Requests)
@@ -109,8 +136,13 @@ namespace data
 				delete m_Thread;
 				m_Thread = 0;
 			}
+			if (m_PersistingRouters.valid ())
+				m_PersistingRouters.get ();
+			if (m_Store)
+				m_Store->Close ();
 			m_LeaseSets.clear();
 		}
+		m_Workers.Stop ();
 		m_Requests = nullptr;
 	}
 
@@ -121,38 +153,48 @@ namespace data
 		uint64_t lastManage = 0;
 		uint64_t lastProfilesCleanup = i2p::util::GetMonotonicMilliseconds (), lastObsoleteProfilesCleanup = lastProfilesCleanup;
 		int16_t profilesCleanupVariance = 0, obsoleteProfilesCleanVariance = 0;
+		std::vector<std::shared_ptr<const I2NPMessage> > msgs;
+		std::vector<VerifiedRouterInfo> verified; // for msgs
 
 		while (m_IsRunning)
 		{
 			try
 			{
-				auto msg = m_Queue.GetNextWithTimeout (1000); // 1 sec
-				if (msg)
+				m_Queue.GetAllWithTimeout (msgs, 1000, NETDB_MAX_NUM_MSGS_PER_ITERATION); // 1 sec
+				if (!msgs.empty ())
 				{
-					int numMsgs = 0;
-					while (msg)
+					VerifyRouterInfos (msgs, verified); // in parallel if many
+					for (size_t i = 0; i < msgs.size (); i++)
 					{
+						auto& msg = msgs[i];
 						LogPrint(eLogDebug, "NetDb: Got request with type ", (int) msg->GetTypeID ());
-						switch (msg->GetTypeID ())
+						try
+						{
+							switch (msg->GetTypeID ())
+							{
+								case eI2NPDatabaseStore:
+									HandleDatabaseStoreMsg (msg, verified[i]);
+								break;
+								case eI2NPDatabaseLookup:
+									HandleDatabaseLookupMsg (msg);
+								break;
+								case eI2NPDummyMsg:
+									// plain RouterInfo from NTCP2 with flags for now
+									HandleNTCP2RouterInfoMsg (msg, verified[i]);
+								break;
+								default: // WTF?
+									LogPrint (eLogError, "NetDb: Unexpected message type ", (int) msg->GetTypeID ());
+									//i2p::HandleI2NPMessage (msg);
+							}
+						}
+						catch (std::exception& ex)
 						{
-							case eI2NPDatabaseStore:
-								HandleDatabaseStoreMsg (msg);
-							break;
-							case eI2NPDatabaseLookup:
-								HandleDatabaseLookupMsg (msg);
-							break;
-							case eI2NPDummyMsg:
-								// plain RouterInfo from NTCP2 with flags for now
-								HandleNTCP2RouterInfoMsg (msg);
-							break;
-							default: // WTF?
-								LogPrint (eLogError, "NetDb: Unexpected message type ", (int) msg->GetTypeID ());
-								//i2p::HandleI2NPMessage (msg);
+							// skip this message only
+							LogPrint (eLogError, "NetDb: Exception while handling message type ", (int) msg->GetTypeID (), ": ", ex.what ());
 						}
-						if (numMsgs > 100) break;
-						msg = m_Queue.Get ();
-						numMsgs++;
 					}
+					msgs.clear ();
+					verified.clear ();
 				}
 				if (!m_IsRunning) break;
 				if (!i2p::transport::transports.IsOnline () || !i2p::transport::transports.IsRunning ()) 
@@ -208,6 +250,8 @@ namespace data
 			catch (std::exception& ex)
 			{
 				LogPrint (eLogError, "NetDb: Runtime exception: ", ex.what ());
+				msgs.clear ();
+				verified.clear ();
 			}
 		}
 	}
@@ -218,11 +262,11 @@ namespace data
 		return AddRouterInfo (buf, len, updated);
 	}
 
-	std::shared_ptr<const RouterInfo> NetDb::AddRouterInfo (const uint8_t * buf, int len, bool& updated)
+	std::shared_ptr<const RouterInfo> NetDb::AddRouterInfo (const uint8_t * buf, int len, bool& updated, bool verifySignature)
 	{
 		IdentityEx identity;
 		if (identity.FromBuffer (buf, len))
-			return AddRouterInfo (identity.GetIdentHash (), buf, len, updated);
+			return AddRouterInfo (identity.GetIdentHash (), buf, len, updated, verifySignature);
 		updated = false;
 		return nullptr;
 	}
@@ -235,7 +279,7 @@ namespace data
 		return updated;
 	}
 
-	std::shared_ptr<const RouterInfo> NetDb::AddRouterInfo (const IdentHash& ident, const uint8_t * buf, int len, bool& updated)
+	std::shared_ptr<const RouterInfo> NetDb::AddRouterInfo (const IdentHash& ident, const uint8_t * buf, int len, bool& updated, bool verifySignature)
 	{
 		updated = true;
 		auto r = FindRouter (ident);
@@ -246,7 +290,7 @@ namespace data
 				bool wasFloodfill = r->IsFloodfill ();
 				{
 					std::lock_guard<std::mutex> l(m_RouterInfosMutex);
-					if (!r->Update (buf, len))
+					if (!r->Update (buf, len, verifySignature))
 					{
 						updated = false;
 						m_Requests->RequestComplete (ident, r);
@@ -293,7 +337,8 @@ namespace data
 		}
 		else
 		{
-			r = std::make_shared<RouterInfo> (buf, len);
+			r = std::make_shared<RouterInfo> (buf, len, verifySignature);
+			r->SetRoutingKey (CreateRoutingKey (r->GetIdentHash ()));
 			bool isValid = !r->IsUnreachable () && r->HasValidAddresses () && (!r->IsFloodfill () || !r->GetProfile ()->IsUnreachable ());
 			if (isValid)
 			{
@@ -347,7 +392,10 @@ namespace data
 		{
 			// we update only is existing LeaseSet is not LeaseSet2
 			uint64_t expires;
-			if(LeaseSetBufferValidate(buf, len, expires))
+			auto ts = i2p::util::GetMonotonicMicroseconds ();
+			bool isValid = LeaseSetBufferValidate(buf, len, expires);
+			m_VerificationStats[eNetDbVerificationLeaseSet].AddSample (isValid, i2p::util::GetMonotonicMicroseconds () - ts);
+			if(isValid)
 			{
 				if(it->second->GetExpirationTime() < expires)
 				{
@@ -364,7 +412,9 @@ namespace data
 		}
 		else
 		{
+			auto ts = i2p::util::GetMonotonicMicroseconds ();
 			auto leaseSet = std::make_shared<LeaseSet> (buf, len, false); // we don't need leases in netdb
+			m_VerificationStats[eNetDbVerificationLeaseSet].AddSample (leaseSet->IsValid (), i2p::util::GetMonotonicMicroseconds () - ts);
 			if (leaseSet->IsValid ())
 			{
 				if (CheckLogLevel (eLogInfo))
@@ -380,7 +430,9 @@ namespace data
 
 	bool NetDb::AddLeaseSet2 (const IdentHash& ident, const uint8_t * buf, int len, uint8_t storeType)
 	{
+		auto ts = i2p::util::GetMonotonicMicroseconds ();
 		auto leaseSet = std::make_shared<LeaseSet2> (storeType, buf, len, false); // we don't need leases in netdb
+		m_VerificationStats[eNetDbVerificationLeaseSet2].AddSample (leaseSet->IsValid (), i2p::util::GetMonotonicMicroseconds () - ts);
 		if (leaseSet->IsValid ())
 		{
 			std::lock_guard<std::mutex> lock(m_LeaseSetsMutex);
@@ -510,25 +562,163 @@ namespace data
 		i2p::transport::transports.SendMessages(ih, requests);
 	}
 
-	bool NetDb::LoadRouterInfo (const std::string& path, uint64_t ts)
+	void NetDb::ParseRouterInfos (size_t num, std::function<std::shared_ptr<RouterInfo> (size_t)> parse,
+		uint64_t ts, std::vector<std::shared_ptr<RouterInfo> >& routers)
 	{
-		auto r = std::make_shared<RouterInfo>(path);
-		if (r->GetRouterIdentity () && !r->IsUnreachable () && r->HasValidAddresses () &&
-			ts < r->GetTimestamp () + 24*60*60*NETDB_MAX_OFFLINE_EXPIRATION_TIMEOUT*1000LL) // too old
+		// split into contiguous shards, few per thread to balance load
+		routers.resize (num);
+		size_t numShards = (m_Workers.GetNumThreads () + 1)*NETDB_NUM_LOAD_SHARDS_PER_THREAD;
+		if (numShards > num) numShards = num;
+		std::vector<i2p::util::ThreadPool::Job> jobs;
+		for (size_t i = 0; i < numShards; i++)
 		{
-			r->DeleteBuffer ();
-			if (m_RouterInfos.emplace (r->GetIdentHash (), r).second)
+			size_t first = num*i/numShards, last = num*(i + 1)/numShards;
+			jobs.push_back ([first, last, ts, &parse, &routers]()
+				{
+					for (size_t j = first; j < last; j++)
+					{
+						auto r = parse (j);
+						if (r && r->GetRouterIdentity () && !r->IsUnreachable () && r->HasValidAddresses () &&
+							ts < r->GetTimestamp () + 24*60*60*NETDB_MAX_OFFLINE_EXPIRATION_TIMEOUT*1000LL) // too old
+						{
+							r->DeleteBuffer ();
+							routers[j] = r;
+						}
+					}
+				});
+		}
+		m_Workers.Run (jobs);
+	}
+
+	void NetDb::AddLoadedRouterInfo (std::shared_ptr<RouterInfo> r)
+	{
+		if (m_RouterInfos.emplace (r->GetIdentHash (), r).second)
+		{
+			if (r->IsFloodfill () && r->IsEligibleFloodfill ())
+				m_Floodfills.Insert (r);
+		}
+	}
+
+	void NetDb::LoadFiles (uint64_t ts)
+	{
+		auto startTime = i2p::util::GetMonotonicMilliseconds ();
+		std::vector<std::string> files;
+		m_Storage.Traverse(files);
+		auto traverseTime = i2p::util::GetMonotonicMilliseconds ();
+		std::vector<std::shared_ptr<RouterInfo> > routers;
+		ParseRouterInfos (files.size (), [&files](size_t i)
 			{
-				if (r->IsFloodfill () && r->IsEligibleFloodfill ())
-					m_Floodfills.Insert (r);
+				return std::make_shared<RouterInfo>(files[i]);
+			}, ts, routers);
+		auto parseTime = i2p::util::GetMonotonicMilliseconds ();
+		for (size_t i = 0; i < routers.size (); i++)
+		{
+			if (routers[i])
+				AddLoadedRouterInfo (routers[i]);
+			else
+			{
+				LogPrint(eLogWarning, "NetDb: RI from ", files[i], " is invalid or too old. Delete");
+				i2p::fs::Remove(files[i]);
 			}
 		}
-		else
+		LogPrint (eLogInfo, "NetDb: Loaded ", files.size (), " files in ", i2p::util::GetMonotonicMilliseconds () - startTime,
+			"ms: traverse ", traverseTime - startTime, "ms, parse ", parseTime - traverseTime, "ms by ", m_Workers.GetNumThreads () + 1,
+			" threads, merge ", i2p::util::GetMonotonicMilliseconds () - parseTime, "ms");
+	}
+
+	void NetDb::LoadStore (uint64_t ts)
+	{
+		auto startTime = i2p::util::GetMonotonicMilliseconds ();
+		struct Record
 		{
-			LogPrint(eLogWarning, "NetDb: RI from ", path, " is invalid or too old. Delete");
-			i2p::fs::Remove(path);
+			IdentHash ident;
+			const uint8_t * buf;
+			size_t len;
+		};
+		std::vector<Record> records;
+		// buffers stay mapped since store is not updated until load is complete
+		m_Store->Visit ([&records](const IdentHash& ident, const uint8_t * buf, size_t len)
+			{
+				records.push_back ({ident, buf, len});
+			});
+		auto traverseTime = i2p::util::GetMonotonicMilliseconds ();
+		std::vector<std::shared_ptr<RouterInfo> > routers;
+		ParseRouterInfos (records.size (), [this, &records](size_t i)->std::shared_ptr<RouterInfo>
+			{
+				const auto& record = records[i];
+				auto r = std::make_shared<RouterInfo>(NewRouterInfoBuffer (record.buf, record.len), record.len, false);
+				r->SetUpdated (false);
+				if (!r->GetRouterIdentity () || r->GetIdentHash () != record.ident) return nullptr;
+				return r;
+			}, ts, routers);
+		auto parseTime = i2p::util::GetMonotonicMilliseconds ();
+		std::list<IdentHash> remove;
+		for (size_t i = 0; i < routers.size (); i++)
+		{
+			if (routers[i])
+				AddLoadedRouterInfo (routers[i]);
+			else
+			{
+				LogPrint(eLogWarning, "NetDb: RI ", records[i].ident.ToBase64 (), " from ", m_Store->GetPath (), " is invalid or too old. Delete");
+				remove.push_back (records[i].ident);
+			}
+		}
+		auto mergeTime = i2p::util::GetMonotonicMilliseconds ();
+		if (!remove.empty ())
+			m_Store->Update ({}, remove);
+		LogPrint (eLogInfo, "NetDb: Loaded ", records.size (), " records in ", i2p::util::GetMonotonicMilliseconds () - startTime,
+			"ms: traverse ", traverseTime - startTime, "ms, parse ", parseTime - traverseTime, "ms by ", m_Workers.GetNumThreads () + 1,
+			" threads, merge ", mergeTime - parseTime, "ms, delete ", i2p::util::GetMonotonicMilliseconds () - mergeTime, "ms");
+	}
+
+	void NetDb::ImportRouterInfos ()
+	{
+		std::vector<std::string> files;
+		m_Storage.Traverse (files);
+		if (files.empty ()) return;
+		size_t numImported = 0;
+		NetDbStore::Updates update;
+		for (size_t i = 0; i < files.size (); i++)
+		{
+			auto r = std::make_shared<RouterInfo>(files[i]);
+			if (r->GetRouterIdentity () && !r->IsUnreachable ())
+				update.emplace_back (r->GetIdentHash (), r->GetSharedBuffer ());
+			if (update.size () >= NETDB_STORE_IMPORT_BATCH_SIZE || i + 1 == files.size ())
+			{
+				if (!m_Store->Update (update, {}))
+				{
+					LogPrint (eLogError, "NetDb: Can't import RouterInfos to ", m_Store->GetPath ());
+					return; // keep files
+				}
+				numImported += update.size ();
+				update.clear ();
+			}
 		}
-		return true;
+		for (const auto& path: files)
+			i2p::fs::Remove (path);
+		LogPrint (eLogInfo, "NetDb: ", numImported, " routers imported to ", m_Store->GetPath ());
+	}
+
+	void NetDb::ExportRouterInfos (const std::string& path)
+	{
+		NetDbStore store (path);
+		if (!store.Open ()) return;
+		size_t numExported = 0;
+		bool failed = false;
+		store.Visit ([this, &numExported, &failed](const IdentHash& ident, const uint8_t * buf, size_t len)
+			{
+				std::ofstream f (m_Storage.Path (ident.ToBase64 ()), std::ofstream::binary | std::ofstream::out);
+				f.write ((const char *)buf, len);
+				if (f.good ()) numExported++; else failed = true;
+			});
+		store.Close ();
+		if (failed)
+		{
+			LogPrint (eLogError, "NetDb: Can't export RouterInfos from ", path);
+			return; // keep file
+		}
+		i2p::fs::Remove (path);
+		LogPrint (eLogInfo, "NetDb: ", numExported, " routers exported from ", path);
 	}
 
 	void NetDb::VisitLeaseSets(LeaseSetVisitor v)
@@ -540,11 +730,20 @@ namespace data
 
 	void NetDb::VisitStoredRouterInfos(RouterInfoVisitor v)
 	{
-		m_Storage.Iterate([v] (const std::string & filename)
+		if (m_Store)
 		{
-			auto ri = std::make_shared<i2p::data::RouterInfo>(filename);
+			m_Store->Visit ([v](const IdentHash& ident, const uint8_t * buf, size_t len)
+				{
+					auto ri = std::make_shared<i2p::data::RouterInfo>(buf, len, false);
+					v(ri);
+				});
+			return;
+		}
+		m_Storage.Iterate([v] (const std::string & filename)
+			{
+				auto ri = std::make_shared<i2p::data::RouterInfo>(filename);
 				v(ri);
-		});
+			});
 	}
 
 	void NetDb::VisitRouterInfos(RouterInfoVisitor v)
@@ -607,10 +806,27 @@ namespace data
 		m_Floodfills.Clear ();
 
 		uint64_t ts = i2p::util::GetMillisecondsSinceEpoch();
-		std::vector<std::string> files;
-		m_Storage.Traverse(files);
-		for (const auto& path : files)
-			LoadRouterInfo (path, ts);
+		if (m_Store)
+		{
+			bool isNew = !i2p::fs::Exists (m_Store->GetPath ());
+			if (m_Store->Open ())
+			{
+				if (isNew) ImportRouterInfos ();
+				LoadStore (ts);
+			}
+			else
+			{
+				LogPrint (eLogError, "NetDb: Can't open ", m_Store->GetPath (), ". Use netDb directory");
+				m_Store = nullptr;
+			}
+		}
+		else
+		{
+			auto path = i2p::fs::DataDirPath (NETDB_STORE_FILENAME);
+			if (i2p::fs::Exists (path)) ExportRouterInfos (path);
+		}
+		if (!m_Store)
+			LoadFiles (ts);
 
 		LogPrint (eLogInfo, "NetDb: ", m_RouterInfos.size(), " routers loaded (", m_Floodfills.GetSize (), " floodfils)");
 	}
@@ -643,14 +859,14 @@ namespace data
 			expirationTimeout = i2p::context.IsFloodfill () ? NETDB_FLOODFILL_EXPIRATION_TIMEOUT*1000LL :
 				NETDB_MIN_EXPIRATION_TIMEOUT*1000LL + (NETDB_MAX_EXPIRATION_TIMEOUT - NETDB_MIN_EXPIRATION_TIMEOUT)*1000LL*NETDB_MIN_ROUTERS/total;
 
-		std::list<std::pair<std::string, std::shared_ptr<RouterInfo::Buffer> > > saveToDisk;
-		std::list<std::string> removeFromDisk;	
+		NetDbStore::Updates saveToDisk;
+		std::list<IdentHash> removeFromDisk;	
 			
 		auto own = i2p::context.GetSharedRouterInfo ();
 		for (auto& it: m_RouterInfos)
 		{
 			if (!it.second || it.second == own) continue; // skip own
-			std::string ident = it.second->GetIdentHashBase64();
+			const auto& ident = it.second->GetIdentHash ();
 			if (it.second->IsUpdated ())
 			{
 				if (it.second->GetBuffer ())
@@ -693,7 +909,7 @@ namespace data
 					else if ((ts > it.second->GetTimestamp () + expirationTimeout/2) && // more than half of expiration
 						total > NETDB_NUM_ROUTERS_THRESHOLD && !it.second->IsHighBandwidth() &&  // low bandwidth
 						!it.second->IsFloodfill() && (!i2p::context.IsFloodfill () || // non floodfill 
-					    (CreateRoutingKey (it.second->GetIdentHash ()) ^ i2p::context.GetIdentHash ()).metric[0] >= 0x02)) // different first 7 bits 
+					    (it.second->GetRoutingKey () ^ i2p::context.GetIdentHash ()).metric[0] >= 0x02)) // different first 7 bits 
 							it.second->SetUnreachable (true);
 				}	
 			}
@@ -752,13 +968,29 @@ namespace data
 		}
 	}
 
-	void NetDb::PersistRouters (std::list<std::pair<std::string, std::shared_ptr<RouterInfo::Buffer> > >&& update, 
-		std::list<std::string>&& remove)
+	void NetDb::PersistRouters (NetDbStore::Updates&& update, std::list<IdentHash>&& remove)
 	{
+		if (m_Store)
+		{
+			if (!m_Store->IsOpen ()) m_Store->Open (); // try to recover
+			if (!m_Store->Update (update, remove))
+			{
+				// buffers were deleted in SaveUpdated, put them back unless updated meanwhile
+				LogPrint (eLogWarning, "NetDb: Can't save ", update.size (), " routers to ", m_Store->GetPath (), ". Keep them in memory");
+				for (auto& it: update)
+				{
+					auto r = FindRouter (it.first);
+					if (!r) continue;
+					std::lock_guard<std::mutex> l(m_RouterInfosMutex);
+					if (!r->GetBuffer ()) r->SetBuffer (it.second);
+				}
+			}
+			return;
+		}
 		for (auto it: update)
-			RouterInfo::SaveToFile (m_Storage.Path(it.first), it.second);
+			RouterInfo::SaveToFile (m_Storage.Path(it.first.ToBase64 ()), it.second);
 		for (auto it: remove)
-			m_Storage.Remove (it);
+			m_Storage.Remove (it.ToBase64 ());
 	}	
 	
 	void NetDb::RequestDestination (const IdentHash& destination, RequestedDestination::RequestComplete requestComplete, bool direct)
@@ -770,11 +1002,75 @@ namespace data
 			LogPrint (eLogError, "NetDb: Requests is null");
 	}
 
-	void NetDb::HandleNTCP2RouterInfoMsg (std::shared_ptr<const I2NPMessage> m)
+	void NetDb::VerifyRouterInfos (const std::vector<std::shared_ptr<const I2NPMessage> >& msgs, std::vector<VerifiedRouterInfo>& verified)
+	{
+		verified.resize (msgs.size ());
+		std::vector<i2p::util::ThreadPool::Job> jobs;
+		for (size_t i = 0; i < msgs.size (); i++)
+		{
+			auto msg = msgs[i];
+			auto& v = verified[i];
+			switch (msg->GetTypeID ())
+			{
+				case eI2NPDatabaseStore:
+					if (msg->GetSize () > DATABASE_STORE_HEADER_SIZE && !msg->GetPayload ()[DATABASE_STORE_TYPE_OFFSET]) // RouterInfo
+						jobs.push_back ([this, msg, &v]() { VerifyDatabaseStoreRouterInfo (msg, v); });
+				break;
+				case eI2NPDummyMsg: // RouterInfo from NTCP2 with flags
+					if (msg->GetPayloadLength () > 1)
+						jobs.push_back ([this, msg, &v]()
+							{ v.isVerified = VerifyRouterInfoSignature (msg->GetPayload () + 1, msg->GetPayloadLength () - 1, nullptr); });
+				break;
+				default: ;
+			}
+		}
+		if (jobs.size () >= NETDB_MIN_PARALLEL_VERIFICATION_BATCH)
+			m_Workers.Run (jobs);
+		else
+			for (auto& it: jobs) it ();
+	}
+
+	void NetDb::VerifyDatabaseStoreRouterInfo (std::shared_ptr<const I2NPMessage> msg, VerifiedRouterInfo& verified)
+	{
+		// same checks as in HandleDatabaseStoreMsg, reported there
+		const uint8_t * buf = msg->GetPayload ();
+		size_t len = msg->GetSize ();
+		size_t offset = DATABASE_STORE_HEADER_SIZE;
+		if (bufbe32toh (buf + DATABASE_STORE_REPLY_TOKEN_OFFSET)) offset += 36; // tunnelID + gateway
+		if (len < offset + 2) return;
+		size_t size = bufbe16toh (buf + offset);
+		offset += 2;
+		if (size > MAX_RI_BUFFER_SIZE || size > len - offset) return;
+		static thread_local GzipInflator inflator;
+		auto buffer = NewRouterInfoBuffer ();
+		size_t uncompressedSize = inflator.Inflate (buf + offset, size, buffer->data (), MAX_RI_BUFFER_SIZE);
+		if (!uncompressedSize || uncompressedSize >= MAX_RI_BUFFER_SIZE) return;
+		buffer->SetBufferLen (uncompressedSize);
+		verified.buffer = buffer;
+		IdentHash ident (buf + DATABASE_STORE_KEY_OFFSET);
+		verified.isVerified = VerifyRouterInfoSignature (buffer->data (), uncompressedSize, &ident);
+	}
+
+	bool NetDb::VerifyRouterInfoSignature (const uint8_t * buf, size_t len, const IdentHash * ident)
+	{
+		auto ts = i2p::util::GetMonotonicMicroseconds ();
+		bool verified = false;
+		IdentityEx identity;
+		size_t identityLen = identity.FromBuffer (buf, len);
+		if (identityLen && identityLen < len && !identity.IsRSA () && (!ident || identity.GetIdentHash () == *ident))
+		{
+			int l = len - identity.GetSignatureLen ();
+			verified = l > (int)identityLen && identity.Verify (buf, l, buf + l);
+		}
+		m_VerificationStats[eNetDbVerificationRouterInfo].AddSample (verified, i2p::util::GetMonotonicMicroseconds () - ts);
+		return verified;
+	}
+
+	void NetDb::HandleNTCP2RouterInfoMsg (std::shared_ptr<const I2NPMessage> m, const VerifiedRouterInfo& verified)
 	{
 		uint8_t flood = m->GetPayload ()[0] & NTCP2_ROUTER_INFO_FLAG_REQUEST_FLOOD;
 		bool updated;
-		auto ri = AddRouterInfo (m->GetPayload () + 1, m->GetPayloadLength () - 1, updated); // without flags
+		auto ri = AddRouterInfo (m->GetPayload () + 1, m->GetPayloadLength () - 1, updated, !verified.isVerified); // without flags
 		if (flood && updated && context.IsFloodfill () && ri)
 		{
 			auto floodMsg = CreateDatabaseStoreMsg (ri, 0); // replyToken = 0
@@ -782,7 +1078,7 @@ namespace data
 		}
 	}
 
-	void NetDb::HandleDatabaseStoreMsg (std::shared_ptr<const I2NPMessage> m)
+	void NetDb::HandleDatabaseStoreMsg (std::shared_ptr<const I2NPMessage> m, const VerifiedRouterInfo& verified)
 	{
 		const uint8_t * buf = m->GetPayload ();
 		size_t len = m->GetSize ();
@@ -888,14 +1184,22 @@ namespace data
 				LogPrint (eLogError, "NetDb: Invalid RouterInfo length ", (int)size);
 				return;
 			}
-			uint8_t uncompressed[MAX_RI_BUFFER_SIZE];
-			size_t uncompressedSize = m_Inflator.Inflate (buf + offset, size, uncompressed, MAX_RI_BUFFER_SIZE);
-			if (uncompressedSize && uncompressedSize < MAX_RI_BUFFER_SIZE)
-				updated = AddRouterInfo (ident, uncompressed, uncompressedSize);
+			if (verified.buffer) // decompressed and possibly verified already
+			{
+				if (!AddRouterInfo (ident, verified.buffer->data (), verified.buffer->GetBufferLen (), updated, !verified.isVerified))
+					updated = false;
+			}
 			else
 			{
-				LogPrint (eLogInfo, "NetDb: Decompression failed ", uncompressedSize);
-				return;
+				uint8_t uncompressed[MAX_RI_BUFFER_SIZE];
+				size_t uncompressedSize = m_Inflator.Inflate (buf + offset, size, uncompressed, MAX_RI_BUFFER_SIZE);
+				if (uncompressedSize && uncompressedSize < MAX_RI_BUFFER_SIZE)
+					updated = AddRouterInfo (ident, uncompressed, uncompressedSize);
+				else
+				{
+					LogPrint (eLogInfo, "NetDb: Decompression failed ", uncompressedSize);
+					return;
+				}
 			}
 		}
 
@@ -1260,7 +1564,19 @@ namespace data
 	std::shared_ptr<const RouterInfo> NetDb::GetClosestFloodfill (const IdentHash& destination,
 		const std::unordered_set<IdentHash>& excluded, bool nextDay) const
 	{
-		IdentHash destKey = CreateRoutingKey (destination, nextDay);
+		return GetClosestFloodfillToKey (GetRoutingKey (destination, nextDay), excluded);
+	}
+
+	std::shared_ptr<const RouterInfo> NetDb::GetExploratoryFloodfill (const IdentHash& destination,
+		const std::unordered_set<IdentHash>& excluded) const
+	{
+		// random destination is never requested again, don't pollute the cache
+		return GetClosestFloodfillToKey (CreateRoutingKey (destination), excluded);
+	}
+
+	std::shared_ptr<const RouterInfo> NetDb::GetClosestFloodfillToKey (const IdentHash& destKey,
+		const std::unordered_set<IdentHash>& excluded) const
+	{
 		std::lock_guard<std::mutex> l(m_FloodfillsMutex);
 		return m_Floodfills.FindClosest (destKey, [&excluded](const std::shared_ptr<RouterInfo>& r)->bool
 			{
@@ -1273,7 +1589,7 @@ namespace data
 		std::unordered_set<IdentHash>& excluded, bool closeThanUsOnly) const
 	{
 		std::vector<IdentHash> res;
-		IdentHash destKey = CreateRoutingKey (destination);
+		IdentHash destKey = GetRoutingKey (destination);
 		std::vector<std::shared_ptr<RouterInfo> > v;
 		{
 			std::lock_guard<std::mutex> l(m_FloodfillsMutex);
@@ -1371,9 +1687,58 @@ namespace data
 			for (auto& it: m_RouterInfos)
 				it.second->UpdateIntroducers (ts);
 		}
+		UpdateRoutingKeys (ts);
 		SaveUpdated ();
 	}
 
+	void NetDb::UpdateRoutingKeys (uint64_t ts)
+	{
+		// new RouterInfos get routing key when added, recalculate all at once after midnight
+		uint64_t day = ts/(24*60*60);
+		if (day == m_RouterInfosRoutingKeysDay) return;
+		auto startTime = i2p::util::GetMonotonicMicroseconds ();
+		char date[9];
+		i2p::util::GetDateString (ts, date);
+		size_t num = 0;
+		{
+			std::lock_guard<std::mutex> l(m_RouterInfosMutex);
+			for (auto& it: m_RouterInfos)
+				it.second->SetRoutingKey (CreateRoutingKey (it.first, date));
+			num = m_RouterInfos.size ();
+		}
+		if (m_RouterInfosRoutingKeysDay)
+			LogPrint (eLogInfo, "NetDb: Routing keys of ", num, " routers updated for ", date, " in ",
+				i2p::util::GetMonotonicMicroseconds () - startTime, "us");
+		m_RouterInfosRoutingKeysDay = day;
+	}
+
+	IdentHash NetDb::GetRoutingKey (const IdentHash& ident, bool nextDay) const
+	{
+		auto ts = i2p::util::GetSecondsSinceEpoch ();
+		uint64_t day = ts/(24*60*60);
+		std::lock_guard<std::mutex> l(m_RoutingKeysMutex);
+		if (day != m_RoutingKeysDay)
+		{
+			// next day's keys become current
+			if (day == m_RoutingKeysDay + 1)
+				m_RoutingKeys.swap (m_NextDayRoutingKeys);
+			else
+				m_RoutingKeys.clear ();
+			m_NextDayRoutingKeys.clear ();
+			m_RoutingKeysDay = day;
+		}
+		auto& keys = nextDay ? m_NextDayRoutingKeys : m_RoutingKeys;
+		auto it = keys.find (ident);
+		if (it != keys.end ()) return it->second;
+		char date[9];
+		i2p::util::GetDateString (nextDay ? ts + 24*60*60 : ts, date);
+		auto key = CreateRoutingKey (ident, date);
+		if (keys.size () >= NETDB_MAX_NUM_CACHED_ROUTING_KEYS)
+			keys.erase (keys.begin ()); // idents are hashes, so first in bucket order is effectively random
+		keys.emplace (ident, key);
+		return key;
+	}
+
 	void NetDb::ManageLeaseSets ()
 	{
 		auto ts = i2p::util::GetMillisecondsSinceEpoch ();
@@ -1394,6 +1759,15 @@ namespace data
 	{
 		if (!r) return false;
 		if (r->GetBuffer ()) return true;
+		if (m_Store)
+		{
+			auto buf = NewRouterInfoBuffer ();
+			size_t len = m_Store->Get (r->GetIdentHash (), buf->data (), buf->size ());
+			if (!len) return false;
+			buf->SetBufferLen (len);
+			r->SetBuffer (buf);
+			return true;
+		}
 		return r->LoadBuffer (m_Storage.Path (r->GetIdentHashBase64 ()));
 	}
 }
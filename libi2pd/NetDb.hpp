@@ -16,6 +16,7 @@
 #include <thread>
 #include <mutex>
 #include <future>
+#include <atomic>
 
 #include "Base.h"
 #include "Gzip.h"
@@ -28,6 +29,7 @@
 #include "TunnelPool.h"
 #include "Reseed.h"
 #include "NetDbRequests.h"
+#include "NetDbStore.h"
 #include "Family.h"
 #include "version.h"
 #include "util.h"
@@ -47,6 +49,10 @@ namespace data
 	const int NETDB_MIN_EXPIRATION_TIMEOUT = 90 * 60; // 1.5 hours
 	const int NETDB_MAX_EXPIRATION_TIMEOUT = 27 * 60 * 60; // 27 hours
 	const int NETDB_MAX_OFFLINE_EXPIRATION_TIMEOUT = 180; // in days
+	const char NETDB_STORE_FILENAME[] = "netDb.dat";
+	const size_t NETDB_STORE_IMPORT_BATCH_SIZE = 1024; // RouterInfos
+	const size_t NETDB_MAX_NUM_MSGS_PER_ITERATION = 100; // others are handled after timers
+	const size_t NETDB_NUM_LOAD_SHARDS_PER_THREAD = 4;
 	const int NETDB_EXPIRATION_TIMEOUT_THRESHOLD = 2*60; // 2 minutes
 	const int NETDB_MIN_HIGHBANDWIDTH_VERSION = MAKE_VERSION_NUMBER(0, 9, 58); // 0.9.58
 	const int NETDB_MIN_FLOODFILL_VERSION = MAKE_VERSION_NUMBER(0, 9, 59); // 0.9.59
@@ -56,6 +62,28 @@ namespace data
 	const int NETDB_EXPLORATORY_SELECTION_UPDATE_INTERVAL = 82; // in seconds. for floodfill
 	const int NETDB_NEXT_DAY_ROUTER_INFO_THRESHOLD = 45; // in minutes
 	const int NETDB_NEXT_DAY_LEASESET_THRESHOLD = 10; // in minutes
+	const size_t NETDB_MAX_NUM_CACHED_ROUTING_KEYS = 4096; // per day
+	const size_t NETDB_MIN_PARALLEL_VERIFICATION_BATCH = 4; // RouterInfos in batch of messages
+	const int NETDB_MAX_NUM_WORKER_THREADS = 32;
+	const int NETDB_VERIFICATION_LATENCY_NUM_BUCKETS = 8;
+	const uint64_t NETDB_VERIFICATION_LATENCY_FIRST_BUCKET = 32; // in microseconds, next is twice more, last is unlimited
+
+	enum NetDbVerificationType
+	{
+		eNetDbVerificationRouterInfo = 0,
+		eNetDbVerificationLeaseSet,
+		eNetDbVerificationLeaseSet2,
+		eNumNetDbVerificationTypes
+	};
+
+	struct NetDbVerificationStats
+	{
+		std::atomic<uint64_t> numVerified, numFailed, totalTime; // time in microseconds
+		std::atomic<uint64_t> latencies[NETDB_VERIFICATION_LATENCY_NUM_BUCKETS]; // histogram
+
+		NetDbVerificationStats ();
+		void AddSample (bool verified, uint64_t time);
+	};
 
 	/** function for visiting a leaseset stored in a floodfill */
 	typedef std::function<void(const IdentHash, std::shared_ptr<LeaseSet>)> LeaseSetVisitor;
@@ -68,6 +96,12 @@ namespace data
 
 	class NetDb
 	{
+		struct VerifiedRouterInfo
+		{
+			std::shared_ptr<RouterInfo::Buffer> buffer; // decompressed from DatabaseStore
+			bool isVerified = false; // signature is valid and matches key
+		};
+
 		public:
 
 			NetDb ();
@@ -92,6 +126,7 @@ namespace data
 			std::shared_ptr<const RouterInfo> GetRandomSSU2PeerTestRouter (bool v4, const std::unordered_set<IdentHash>& excluded) const;
 			std::shared_ptr<const RouterInfo> GetRandomSSU2Introducer (bool v4, const std::unordered_set<IdentHash>& excluded) const;
 			std::shared_ptr<const RouterInfo> GetClosestFloodfill (const IdentHash& destination, const std::unordered_set<IdentHash>& excluded, bool nextDay = false) const;
+			std::shared_ptr<const RouterInfo> GetExploratoryFloodfill (const IdentHash& destination, const std::unordered_set<IdentHash>& excluded) const; // uncached routing key
 			std::vector<IdentHash> GetClosestFloodfills (const IdentHash& destination, size_t num,
 				std::unordered_set<IdentHash>& excluded, bool closeThanUsOnly = false) const;
 			std::vector<IdentHash> GetExploratoryNonFloodfill (const IdentHash& destination, size_t num, const std::unordered_set<IdentHash>& excluded);
@@ -109,6 +144,8 @@ namespace data
 			int GetNumRouters () const { return m_RouterInfos.size (); };
 			int GetNumFloodfills () const { return m_Floodfills.GetSize (); };
 			int GetNumLeaseSets () const { return m_LeaseSets.size (); };
+			const NetDbVerificationStats& GetVerificationStats (NetDbVerificationType type) const { return m_VerificationStats[type]; };
+			size_t GetNumWorkerThreads () const { return m_Workers.GetNumThreads (); };
 
 			/** visit all lease sets we currently store */
 			void VisitLeaseSets(LeaseSetVisitor v);
@@ -141,27 +178,39 @@ namespace data
 		private:
 
 			void Load ();
-			bool LoadRouterInfo (const std::string& path, uint64_t ts);
+			void LoadFiles (uint64_t ts);
+			void LoadStore (uint64_t ts);
+			void ParseRouterInfos (size_t num, std::function<std::shared_ptr<RouterInfo> (size_t)> parse,
+				uint64_t ts, std::vector<std::shared_ptr<RouterInfo> >& routers); // in worker threads, null if invalid or too old
+			void AddLoadedRouterInfo (std::shared_ptr<RouterInfo> r);
+			void ImportRouterInfos (); // from netDb directory to store
+			void ExportRouterInfos (const std::string& path); // from store file to netDb directory
 			void SaveUpdated ();
-			void PersistRouters (std::list<std::pair<std::string, std::shared_ptr<RouterInfo::Buffer> > >&& update, 
-				std::list<std::string>&& remove);
+			void PersistRouters (NetDbStore::Updates&& update, std::list<IdentHash>&& remove);
 			void Run (); 
 			void Flood (const IdentHash& ident, std::shared_ptr<I2NPMessage> floodMsg, bool andNextDay = false);
 			void ManageRouterInfos ();
+			void UpdateRoutingKeys (uint64_t ts); // of all RouterInfos if day changed
+			IdentHash GetRoutingKey (const IdentHash& ident, bool nextDay = false) const; // cached
+			std::shared_ptr<const RouterInfo> GetClosestFloodfillToKey (const IdentHash& destKey, const std::unordered_set<IdentHash>& excluded) const;
 			void ManageLeaseSets ();
 			void ManageRequests ();
 
 			void ReseedFromFloodfill(const RouterInfo & ri, int numRouters = 40, int numFloodfills = 20);
 
-			std::shared_ptr<const RouterInfo> AddRouterInfo (const uint8_t * buf, int len, bool& updated);
-			std::shared_ptr<const RouterInfo> AddRouterInfo (const IdentHash& ident, const uint8_t * buf, int len, bool& updated);
+			std::shared_ptr<const RouterInfo> AddRouterInfo (const uint8_t * buf, int len, bool& updated, bool verifySignature = true);
+			std::shared_ptr<const RouterInfo> AddRouterInfo (const IdentHash& ident, const uint8_t * buf, int len, bool& updated, bool verifySignature = true);
 
 			template<typename Filter>
 			std::shared_ptr<const RouterInfo> GetRandomRouter (Filter filter) const;
 
-			void HandleDatabaseStoreMsg (std::shared_ptr<const I2NPMessage> msg);
+			void HandleDatabaseStoreMsg (std::shared_ptr<const I2NPMessage> msg, const VerifiedRouterInfo& verified);
 			void HandleDatabaseLookupMsg (std::shared_ptr<const I2NPMessage> msg);
-			void HandleNTCP2RouterInfoMsg (std::shared_ptr<const I2NPMessage> m);
+			void HandleNTCP2RouterInfoMsg (std::shared_ptr<const I2NPMessage> m, const VerifiedRouterInfo& verified);
+
+			void VerifyRouterInfos (const std::vector<std::shared_ptr<const I2NPMessage> >& msgs, std::vector<VerifiedRouterInfo>& verified);
+			void VerifyDatabaseStoreRouterInfo (std::shared_ptr<const I2NPMessage> msg, VerifiedRouterInfo& verified);
+			bool VerifyRouterInfoSignature (const uint8_t * buf, size_t len, const IdentHash * ident); // ident must match if set
 
 		private:
 
@@ -177,9 +226,12 @@ namespace data
 			i2p::util::Queue<std::shared_ptr<const I2NPMessage> > m_Queue; // of I2NPDatabaseStoreMsg
 
 			GzipInflator m_Inflator;
+			i2p::util::ThreadPool m_Workers;
+			NetDbVerificationStats m_VerificationStats[eNumNetDbVerificationTypes];
 			Reseeder * m_Reseeder;
 			Families m_Families;
 			i2p::fs::HashedStorage m_Storage;
+			std::unique_ptr<NetDbStore> m_Store; // single file instead of m_Storage if set
 
 			std::shared_ptr<NetDbRequests> m_Requests;
 
@@ -189,6 +241,11 @@ namespace data
 			std::vector<std::shared_ptr<const RouterInfo> > m_ExploratorySelection;
 			uint64_t m_LastExploratorySelectionUpdateTime; // in monotonic seconds
 
+			uint64_t m_RouterInfosRoutingKeysDay; // in days since epoch
+			mutable std::mutex m_RoutingKeysMutex;
+			mutable uint64_t m_RoutingKeysDay; // in days since epoch
+			mutable std::unordered_map<IdentHash, IdentHash> m_RoutingKeys, m_NextDayRoutingKeys; // lookup and store keys
+
 			i2p::util::MemoryPoolMt<RouterInfo::Buffer> m_RouterInfoBuffersPool;
 			i2p::util::MemoryPoolMt<RouterInfo::Address> m_RouterInfoAddressesPool;
 			i2p::util::MemoryPoolMt<RouterInfo::Addresses> m_RouterInfoAddressVectorsPool;
@@ -469,7 +469,7 @@ namespace data
 				LogPrint (eLogWarning, "NetDbReq: Exploratory destination is requested already");
 				return;
 			}
-			auto floodfill = netdb.GetClosestFloodfill (randomHash, dest->GetExcludedPeers ());
+			auto floodfill = netdb.GetExploratoryFloodfill (randomHash, dest->GetExcludedPeers ());
 			if (floodfill)
 			{
 				if (i2p::transport::transports.IsConnected (floodfill->GetIdentHash ()))
@@ -0,0 +1,345 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#include <string.h>
+#include <fstream>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include "I2PEndian.h"
+#include "FS.h"
+#include "Log.h"
+#include "NetDbStore.h"
+
+namespace i2p
+{
+namespace data
+{
+	NetDbStore::NetDbStore (const std::string& path):
+		m_Path (path), m_FileSize (0), m_NumDeletedBytes (0), m_RecordsEnd (0)
+	{
+	}
+
+	NetDbStore::~NetDbStore ()
+	{
+		Close ();
+	}
+
+	bool NetDbStore::Open ()
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (m_Region) return true;
+		if (!i2p::fs::Exists (m_Path) && !CreateEmpty ())
+			return false;
+		if (!Map ()) return false;
+		m_Index.clear ();
+		if (!ReadIndex ())
+		{
+			LogPrint (eLogWarning, "NetDbStore: ", m_Path, " is malformed. Recreate");
+			Unmap ();
+			m_Index.clear ();
+			if (!CreateEmpty () || !Map ()) return false;
+			ReadIndex ();
+		}
+		LogPrint (eLogDebug, "NetDbStore: ", m_Index.size (), " records, ", m_NumDeletedBytes, " of ", m_FileSize, " bytes deleted");
+		if (NeedsCompaction ()) Rewrite ();
+		return m_Region != nullptr;
+	}
+
+	void NetDbStore::Close ()
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		Unmap ();
+		m_Index.clear ();
+		m_NumDeletedBytes = 0;
+	}
+
+	size_t NetDbStore::GetNumRecords () const
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		return m_Index.size ();
+	}
+
+	size_t NetDbStore::Get (const IdentHash& ident, uint8_t * buf, size_t len) const
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (!m_Region) return 0;
+		auto it = m_Index.find (ident);
+		if (it == m_Index.end ()) return 0;
+		size_t recordLen = bufbe16toh (GetData () + it->second + 32);
+		if (recordLen > len) return 0;
+		memcpy (buf, GetData () + it->second + NETDB_STORE_RECORD_HEADER_SIZE, recordLen);
+		return recordLen;
+	}
+
+	void NetDbStore::Visit (RecordVisitor v) const
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (!m_Region) return;
+		auto data = GetData ();
+		for (const auto& it: m_Index)
+			v (it.first, data + it.second + NETDB_STORE_RECORD_HEADER_SIZE, bufbe16toh (data + it.second + 32));
+	}
+
+	bool NetDbStore::Update (const Updates& update, const std::list<IdentHash>& remove)
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (!m_Region) return false;
+		if (!Append (update, remove)) return false;
+		if (NeedsCompaction ()) Rewrite ();
+		return true;
+	}
+
+	bool NetDbStore::Compact ()
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (!m_Region) return false;
+		return Rewrite ();
+	}
+
+	bool NetDbStore::CreateEmpty ()
+	{
+		std::ofstream f (m_Path, std::ofstream::binary | std::ofstream::out | std::ofstream::trunc);
+		if (!f.is_open ())
+		{
+			LogPrint (eLogError, "NetDbStore: Can't create ", m_Path);
+			return false;
+		}
+		uint8_t header[NETDB_STORE_HEADER_SIZE];
+		memset (header, 0, NETDB_STORE_HEADER_SIZE);
+		memcpy (header, NETDB_STORE_MAGIC, 8);
+		htobe64buf (header + 8, NETDB_STORE_HEADER_SIZE); // empty index right after header
+		f.write ((char *)header, NETDB_STORE_HEADER_SIZE);
+		return f.good ();
+	}
+
+	bool NetDbStore::Map (size_t size)
+	{
+		try
+		{
+			size_t fileSize = boost::filesystem::file_size (m_Path);
+			std::unique_ptr<boost::interprocess::file_mapping> mapping (new boost::interprocess::file_mapping (m_Path.c_str (), boost::interprocess::read_only));
+#ifdef _WIN32
+			// can't map beyond end of file
+			std::unique_ptr<boost::interprocess::mapped_region> region (new boost::interprocess::mapped_region (*mapping, boost::interprocess::read_only));
+#else
+			// pages beyond end of file are never accessed
+			std::unique_ptr<boost::interprocess::mapped_region> region (new boost::interprocess::mapped_region (*mapping, boost::interprocess::read_only, 0, std::max (size, fileSize)));
+#endif
+			m_Region = std::move (region);
+			m_Mapping = std::move (mapping);
+			m_FileSize = fileSize;
+		}
+		catch (std::exception& ex)
+		{
+			LogPrint (eLogError, "NetDbStore: Can't map ", m_Path, ": ", ex.what ());
+			return false;
+		}
+		return true;
+	}
+
+	void NetDbStore::Unmap ()
+	{
+		m_Region = nullptr;
+		m_Mapping = nullptr;
+		m_FileSize = 0;
+	}
+
+	bool NetDbStore::ReadIndex ()
+	{
+		if (m_FileSize < NETDB_STORE_HEADER_SIZE) return false;
+		auto data = GetData ();
+		if (memcmp (data, NETDB_STORE_MAGIC, 8)) return false;
+		uint64_t indexOffset = bufbe64toh (data + 8);
+		uint64_t numEntries = bufbe32toh (data + 16);
+		if (indexOffset < NETDB_STORE_HEADER_SIZE || indexOffset + numEntries*NETDB_STORE_INDEX_ENTRY_SIZE > m_FileSize)
+			return false;
+		size_t liveBytes = 0;
+		auto entry = data + indexOffset;
+		for (uint64_t i = 0; i < numEntries; i++, entry += NETDB_STORE_INDEX_ENTRY_SIZE)
+		{
+			size_t offset = bufbe32toh (entry + 32);
+			if (offset < NETDB_STORE_HEADER_SIZE || offset + NETDB_STORE_RECORD_HEADER_SIZE > indexOffset ||
+				memcmp (data + offset, entry, 32)) return false;
+			size_t recordSize = NETDB_STORE_RECORD_HEADER_SIZE + bufbe16toh (data + offset + 32);
+			if (offset + recordSize > indexOffset) return false;
+			m_Index[IdentHash (entry)] = offset;
+			liveBytes += recordSize;
+		}
+		m_NumDeletedBytes = indexOffset - NETDB_STORE_HEADER_SIZE - liveBytes;
+		ReadRecords (indexOffset + numEntries*NETDB_STORE_INDEX_ENTRY_SIZE);
+		return true;
+	}
+
+	void NetDbStore::ReadRecords (size_t offset)
+	{
+		auto data = GetData ();
+		size_t end = std::min (m_FileSize, GetMappedSize ());
+		while (offset + NETDB_STORE_RECORD_HEADER_SIZE <= end)
+		{
+			size_t len = bufbe16toh (data + offset + 32);
+			if (offset + NETDB_STORE_RECORD_HEADER_SIZE + len > end) break;
+			AddRecord (IdentHash (data + offset), offset, len);
+			offset += NETDB_STORE_RECORD_HEADER_SIZE + len;
+		}
+		m_RecordsEnd = offset;
+		if (offset < m_FileSize && end == m_FileSize)
+		{
+			// incomplete record, written partially at shutdown or failed write
+			LogPrint (eLogWarning, "NetDbStore: Truncate ", m_FileSize - offset, " bytes of incomplete record");
+#ifdef _WIN32
+			Unmap (); // can't truncate mapped file
+#endif
+			boost::system::error_code ec;
+			boost::filesystem::resize_file (m_Path, offset, ec);
+			if (ec)
+				LogPrint (eLogError, "NetDbStore: Can't truncate ", m_Path, ": ", ec.message ());
+			else
+				m_FileSize = offset;
+#ifdef _WIN32
+			Map ();
+#endif
+		}
+	}
+
+	void NetDbStore::AddRecord (const IdentHash& ident, size_t offset, size_t len)
+	{
+		auto it = m_Index.find (ident);
+		if (it != m_Index.end ())
+			m_NumDeletedBytes += NETDB_STORE_RECORD_HEADER_SIZE + bufbe16toh (GetData () + it->second + 32);
+		if (len)
+			m_Index[ident] = offset;
+		else
+		{
+			// deleted record
+			if (it != m_Index.end ()) m_Index.erase (it);
+			m_NumDeletedBytes += NETDB_STORE_RECORD_HEADER_SIZE;
+		}
+	}
+
+	bool NetDbStore::Append (const Updates& update, const std::list<IdentHash>& remove)
+	{
+		size_t size = m_FileSize;
+		for (const auto& it: update)
+			if (it.second && it.second->GetBufferLen ()) size += NETDB_STORE_RECORD_HEADER_SIZE + it.second->GetBufferLen ();
+		size += remove.size ()*NETDB_STORE_RECORD_HEADER_SIZE;
+		if (size > NETDB_STORE_MAX_SIZE)
+		{
+			LogPrint (eLogError, "NetDbStore: ", m_Path, " is too large");
+			return false;
+		}
+		std::unordered_set<IdentHash> updated; // deleted record is needed if in index or in the same update
+		for (const auto& it: update) updated.insert (it.first);
+#ifdef _WIN32
+		Unmap (); // can't append to mapped file
+#endif
+		{
+			std::ofstream f (m_Path, std::ofstream::binary | std::ofstream::out | std::ofstream::app);
+			uint8_t header[NETDB_STORE_RECORD_HEADER_SIZE];
+			for (const auto& it: update)
+			{
+				if (!it.second || !it.second->GetBufferLen ()) continue;
+				memcpy (header, it.first, 32);
+				htobe16buf (header + 32, it.second->GetBufferLen ());
+				f.write ((char *)header, NETDB_STORE_RECORD_HEADER_SIZE);
+				f.write ((char *)it.second->data (), it.second->GetBufferLen ());
+			}
+			for (const auto& it: remove)
+			{
+				if (!m_Index.count (it) && !updated.count (it)) continue;
+				memcpy (header, it, 32);
+				htobe16buf (header + 32, 0);
+				f.write ((char *)header, NETDB_STORE_RECORD_HEADER_SIZE);
+			}
+			if (!f.good ()) LogPrint (eLogError, "NetDbStore: Can't write to ", m_Path);
+		}
+		boost::system::error_code ec;
+		auto fileSize = boost::filesystem::file_size (m_Path, ec);
+		if (!ec) m_FileSize = fileSize;
+		if (!m_Region || m_FileSize > GetMappedSize ())
+		{
+			// remap with the room for next appends
+			size_t mappedSize = std::max (GetMappedSize (), NETDB_STORE_MIN_MAPPING_SIZE);
+			while (mappedSize < m_FileSize) mappedSize <<= 1;
+			if (!Map (std::min (mappedSize, NETDB_STORE_MAX_SIZE)) && !m_Region) return false;
+		}
+		ReadRecords (m_RecordsEnd); // apply what has been written actually
+		return m_RecordsEnd == m_FileSize; // new records are not available otherwise
+	}
+
+	bool NetDbStore::NeedsCompaction () const
+	{
+		return m_NumDeletedBytes >= NETDB_STORE_MIN_COMPACTION_SIZE && m_NumDeletedBytes > m_FileSize/2;
+	}
+
+	bool NetDbStore::Rewrite ()
+	{
+		std::vector<std::pair<IdentHash, size_t> > records (m_Index.begin (), m_Index.end ());
+		std::sort (records.begin (), records.end ());
+		auto data = GetData ();
+		std::string tmpPath = m_Path + ".tmp";
+		{
+			std::ofstream f (tmpPath, std::ofstream::binary | std::ofstream::out | std::ofstream::trunc);
+			if (!f.is_open ())
+			{
+				LogPrint (eLogError, "NetDbStore: Can't create ", tmpPath);
+				return false;
+			}
+			uint8_t header[NETDB_STORE_HEADER_SIZE];
+			memset (header, 0, NETDB_STORE_HEADER_SIZE);
+			memcpy (header, NETDB_STORE_MAGIC, 8);
+			f.write ((char *)header, NETDB_STORE_HEADER_SIZE); // index offset is not known yet
+			size_t offset = NETDB_STORE_HEADER_SIZE;
+			for (auto& it: records)
+			{
+				size_t recordSize = NETDB_STORE_RECORD_HEADER_SIZE + bufbe16toh (data + it.second + 32);
+				f.write ((const char *)data + it.second, recordSize);
+				it.second = offset;
+				offset += recordSize;
+			}
+			uint8_t entry[NETDB_STORE_INDEX_ENTRY_SIZE];
+			for (const auto& it: records)
+			{
+				memcpy (entry, it.first, 32);
+				htobe32buf (entry + 32, it.second);
+				f.write ((char *)entry, NETDB_STORE_INDEX_ENTRY_SIZE);
+			}
+			htobe64buf (header + 8, offset);
+			htobe32buf (header + 16, records.size ());
+			f.seekp (0);
+			f.write ((char *)header, NETDB_STORE_HEADER_SIZE);
+			if (!f.good ())
+			{
+				LogPrint (eLogError, "NetDbStore: Can't write to ", tmpPath);
+				f.close ();
+				i2p::fs::Remove (tmpPath);
+				return false;
+			}
+		}
+		auto fileSize = m_FileSize;
+		Unmap ();
+		boost::system::error_code ec;
+		boost::filesystem::rename (tmpPath, m_Path, ec);
+		if (ec)
+		{
+			LogPrint (eLogError, "NetDbStore: Can't rename ", tmpPath, ": ", ec.message ());
+			i2p::fs::Remove (tmpPath);
+			return Map ();
+		}
+		if (!Map ()) return false;
+		m_Index.clear ();
+		for (const auto& it: records)
+			m_Index.emplace (it.first, it.second);
+		m_NumDeletedBytes = 0;
+		m_RecordsEnd = m_FileSize;
+		LogPrint (eLogInfo, "NetDbStore: Compacted ", m_Path, " from ", fileSize, " to ", m_FileSize, " bytes");
+		return true;
+	}
+}
+}
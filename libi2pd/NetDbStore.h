@@ -0,0 +1,94 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#ifndef NETDB_STORE_H__
+#define NETDB_STORE_H__
+
+#include <inttypes.h>
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "Identity.h"
+#include "RouterInfo.h"
+
+namespace i2p
+{
+namespace data
+{
+	/*
+	 * Single file NetDb store, memory mapped for reading, appended on update
+	 * header: magic (8) | index offset (8) | number of index entries (4) | reserved (12)
+	 * records: ident hash (32) | length (2), 0 means deleted | RouterInfo (length)
+	 * index: sorted by ident hash, ident hash (32) | record offset (4), written at compaction
+	 * records appended after index are applied on top of it at open
+	 */
+	const char NETDB_STORE_MAGIC[8] = { 'i', '2', 'p', 'd', 'n', 'd', 'b', '1' };
+	const size_t NETDB_STORE_HEADER_SIZE = 32;
+	const size_t NETDB_STORE_RECORD_HEADER_SIZE = 34;
+	const size_t NETDB_STORE_INDEX_ENTRY_SIZE = 36;
+	const size_t NETDB_STORE_MIN_COMPACTION_SIZE = 1024*1024; // don't compact less than 1M of deleted records
+	const size_t NETDB_STORE_MAX_SIZE = 0xFFFFFFFF; // record offsets are 32 bits
+	const size_t NETDB_STORE_MIN_MAPPING_SIZE = 4*1024*1024; // mapping grows twice from it, not remapped on every append
+
+	class NetDbStore
+	{
+		public:
+
+			typedef std::function<void (const IdentHash& ident, const uint8_t * buf, size_t len)> RecordVisitor;
+			typedef std::list<std::pair<IdentHash, std::shared_ptr<RouterInfo::Buffer> > > Updates;
+
+			NetDbStore (const std::string& path);
+			~NetDbStore ();
+
+			bool Open (); // create if doesn't exist
+			void Close ();
+			bool IsOpen () const { return m_Region != nullptr; };
+			const std::string& GetPath () const { return m_Path; };
+
+			size_t GetNumRecords () const;
+			size_t GetFileSize () const { return m_FileSize; };
+			size_t GetNumDeletedBytes () const { return m_NumDeletedBytes; };
+
+			size_t Get (const IdentHash& ident, uint8_t * buf, size_t len) const; // returns actual length, 0 if not found
+			void Visit (RecordVisitor v) const; // buffers are valid inside visitor only
+			bool Update (const Updates& update, const std::list<IdentHash>& remove); // appends, compacts if necessary
+			bool Compact ();
+
+		private:
+
+			bool CreateEmpty ();
+			bool Map (size_t size = 0); // at least file size, current mapping is kept if fails
+			void Unmap ();
+			bool ReadIndex ();
+			void ReadRecords (size_t offset);
+			void AddRecord (const IdentHash& ident, size_t offset, size_t len);
+			bool Append (const Updates& update, const std::list<IdentHash>& remove);
+			bool NeedsCompaction () const;
+			bool Rewrite ();
+			const uint8_t * GetData () const { return (const uint8_t *)m_Region->get_address (); };
+			size_t GetMappedSize () const { return m_Region ? m_Region->get_size () : 0; };
+
+		private:
+
+			std::string m_Path;
+			mutable std::mutex m_Mutex;
+			std::unique_ptr<boost::interprocess::file_mapping> m_Mapping;
+			std::unique_ptr<boost::interprocess::mapped_region> m_Region;
+			size_t m_FileSize, m_NumDeletedBytes;
+			size_t m_RecordsEnd; // records before it are in index, might be less than file size if not mapped
+			std::unordered_map<IdentHash, size_t> m_Index; // ident -> record offset
+	};
+}
+}
+
+#endif
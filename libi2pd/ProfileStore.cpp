@@ -0,0 +1,220 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#include <string.h>
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include "I2PEndian.h"
+#include "FS.h"
+#include "Log.h"
+#include "ProfileStore.h"
+
+namespace i2p
+{
+namespace data
+{
+	ProfileStore::ProfileStore (const std::string& path, size_t recordSize):
+		m_Path (path), m_RecordSize (recordSize), m_SlotSize (32 + recordSize), m_NumSlots (0)
+	{
+	}
+
+	ProfileStore::~ProfileStore ()
+	{
+		Close ();
+	}
+
+	bool ProfileStore::Open ()
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (m_Region) return true;
+		bool isValid = false;
+		if (i2p::fs::Exists (m_Path) && Map ())
+		{
+			auto size = m_Region->get_size ();
+			auto header = GetSlot (0) - PROFILE_STORE_HEADER_SIZE;
+			isValid = size >= PROFILE_STORE_HEADER_SIZE && !memcmp (header, PROFILE_STORE_MAGIC, 8) &&
+				bufbe32toh (header + 8) == m_RecordSize && !((size - PROFILE_STORE_HEADER_SIZE) % m_SlotSize);
+			if (!isValid)
+			{
+				LogPrint (eLogWarning, "ProfileStore: ", m_Path, " is malformed. Recreate");
+				Unmap ();
+			}
+		}
+		if (!isValid)
+		{
+			{
+				std::ofstream f (m_Path, std::ofstream::binary | std::ofstream::out | std::ofstream::trunc);
+				uint8_t header[PROFILE_STORE_HEADER_SIZE];
+				memset (header, 0, PROFILE_STORE_HEADER_SIZE);
+				memcpy (header, PROFILE_STORE_MAGIC, 8);
+				htobe32buf (header + 8, m_RecordSize);
+				f.write ((char *)header, PROFILE_STORE_HEADER_SIZE);
+				if (!f.good ())
+				{
+					LogPrint (eLogError, "ProfileStore: Can't create ", m_Path);
+					return false;
+				}
+			}
+			boost::system::error_code ec;
+			boost::filesystem::resize_file (m_Path, PROFILE_STORE_HEADER_SIZE + PROFILE_STORE_MIN_NUM_SLOTS*m_SlotSize, ec);
+			if (ec || !Map ()) return false;
+		}
+		// build index
+		m_Index.clear ();
+		m_FreeSlots.clear ();
+		for (size_t i = m_NumSlots; i > 0; i--)
+		{
+			auto slot = GetSlot (i - 1);
+			IdentHash ident (slot);
+			if (ident.IsZero ())
+				m_FreeSlots.push_back (i - 1);
+			else if (!m_Index.emplace (ident, i - 1).second)
+			{
+				// duplicate
+				memset (slot, 0, m_SlotSize);
+				m_FreeSlots.push_back (i - 1);
+			}
+		}
+		LogPrint (eLogDebug, "ProfileStore: ", m_Index.size (), " of ", m_NumSlots, " slots used");
+		return true;
+	}
+
+	void ProfileStore::Close ()
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		Unmap ();
+		m_Index.clear ();
+		m_FreeSlots.clear ();
+	}
+
+	void ProfileStore::Flush ()
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (m_Region) m_Region->flush ();
+	}
+
+	size_t ProfileStore::GetNumRecords () const
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		return m_Index.size ();
+	}
+
+	bool ProfileStore::Get (const IdentHash& ident, uint8_t * record) const
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (!m_Region) return false;
+		auto it = m_Index.find (ident);
+		if (it == m_Index.end ()) return false;
+		memcpy (record, GetSlot (it->second) + 32, m_RecordSize);
+		return true;
+	}
+
+	bool ProfileStore::Put (const IdentHash& ident, const uint8_t * record)
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (!m_Region || ident.IsZero ()) return false;
+		auto it = m_Index.find (ident);
+		if (it != m_Index.end ())
+		{
+			memcpy (GetSlot (it->second) + 32, record, m_RecordSize);
+			return true;
+		}
+		if (m_FreeSlots.empty () && !Grow ()) return false;
+		auto ind = m_FreeSlots.back (); m_FreeSlots.pop_back ();
+		auto slot = GetSlot (ind);
+		memcpy (slot, ident, 32);
+		memcpy (slot + 32, record, m_RecordSize);
+		m_Index.emplace (ident, ind);
+		return true;
+	}
+
+	void ProfileStore::Remove (const IdentHash& ident)
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (!m_Region) return;
+		auto it = m_Index.find (ident);
+		if (it == m_Index.end ()) return;
+		memset (GetSlot (it->second), 0, m_SlotSize);
+		m_FreeSlots.push_back (it->second);
+		m_Index.erase (it);
+	}
+
+	size_t ProfileStore::Remove (RecordFilter filter)
+	{
+		std::lock_guard<std::mutex> l(m_Mutex);
+		if (!m_Region) return 0;
+		size_t numRemoved = 0;
+		for (auto it = m_Index.begin (); it != m_Index.end ();)
+		{
+			auto slot = GetSlot (it->second);
+			if (filter (it->first, slot + 32))
+			{
+				memset (slot, 0, m_SlotSize);
+				m_FreeSlots.push_back (it->second);
+				it = m_Index.erase (it);
+				numRemoved++;
+			}
+			else
+				it++;
+		}
+		return numRemoved;
+	}
+
+	bool ProfileStore::Map ()
+	{
+		try
+		{
+			m_Mapping.reset (new boost::interprocess::file_mapping (m_Path.c_str (), boost::interprocess::read_write));
+			m_Region.reset (new boost::interprocess::mapped_region (*m_Mapping, boost::interprocess::read_write));
+			auto size = m_Region->get_size ();
+			m_NumSlots = size > PROFILE_STORE_HEADER_SIZE ? (size - PROFILE_STORE_HEADER_SIZE)/m_SlotSize : 0;
+		}
+		catch (std::exception& ex)
+		{
+			LogPrint (eLogError, "ProfileStore: Can't map ", m_Path, ": ", ex.what ());
+			Unmap ();
+			return false;
+		}
+		return true;
+	}
+
+	void ProfileStore::Unmap ()
+	{
+		m_Region = nullptr;
+		m_Mapping = nullptr;
+		m_NumSlots = 0;
+	}
+
+	bool ProfileStore::Grow ()
+	{
+		auto numSlots = m_NumSlots;
+		auto newNumSlots = numSlots*2;
+		if (newNumSlots < PROFILE_STORE_MIN_NUM_SLOTS) newNumSlots = PROFILE_STORE_MIN_NUM_SLOTS;
+		m_Region->flush ();
+		Unmap ();
+		boost::system::error_code ec;
+		boost::filesystem::resize_file (m_Path, PROFILE_STORE_HEADER_SIZE + newNumSlots*m_SlotSize, ec);
+		if (ec) LogPrint (eLogError, "ProfileStore: Can't resize ", m_Path, ": ", ec.message ());
+		if (!Map ())
+		{
+			// records are not accessible anymore
+			m_Index.clear ();
+			m_FreeSlots.clear ();
+			return false;
+		}
+		for (auto i = m_NumSlots; i > numSlots; i--)
+			m_FreeSlots.push_back (i - 1);
+		return m_NumSlots > numSlots;
+	}
+
+	uint8_t * ProfileStore::GetSlot (size_t slot) const
+	{
+		return (uint8_t *)m_Region->get_address () + PROFILE_STORE_HEADER_SIZE + slot*m_SlotSize;
+	}
+}
+}
@@ -0,0 +1,78 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#ifndef PROFILE_STORE_H__
+#define PROFILE_STORE_H__
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "Identity.h"
+
+namespace i2p
+{
+namespace data
+{
+	/*
+	 * Table of fixed size records keyed by ident hash, memory mapped for reading and writing
+	 * header: magic (8) | record size (4) | reserved (4)
+	 * slots: ident hash (32) | record (record size), all zeros if free
+	 */
+	const char PROFILE_STORE_MAGIC[8] = { 'i', '2', 'p', 'd', 'p', 'r', 'f', '1' };
+	const size_t PROFILE_STORE_HEADER_SIZE = 16;
+	const size_t PROFILE_STORE_MIN_NUM_SLOTS = 256;
+
+	class ProfileStore
+	{
+		public:
+
+			typedef std::function<bool (const IdentHash& ident, const uint8_t * record)> RecordFilter;
+
+			ProfileStore (const std::string& path, size_t recordSize);
+			~ProfileStore ();
+
+			bool Open (); // create if doesn't exist
+			void Close ();
+			bool IsOpen () const { return m_Region != nullptr; };
+			void Flush ();
+
+			size_t GetNumRecords () const;
+			size_t GetNumSlots () const { return m_NumSlots; };
+
+			bool Get (const IdentHash& ident, uint8_t * record) const;
+			bool Put (const IdentHash& ident, const uint8_t * record); // update in place or take free slot
+			void Remove (const IdentHash& ident);
+			size_t Remove (RecordFilter filter); // returns number of removed records
+
+		private:
+
+			bool Map ();
+			void Unmap ();
+			bool Grow ();
+			uint8_t * GetSlot (size_t slot) const;
+
+		private:
+
+			std::string m_Path;
+			size_t m_RecordSize, m_SlotSize, m_NumSlots;
+			mutable std::mutex m_Mutex;
+			std::unique_ptr<boost::interprocess::file_mapping> m_Mapping;
+			std::unique_ptr<boost::interprocess::mapped_region> m_Region;
+			std::unordered_map<IdentHash, size_t> m_Index; // ident -> slot
+			std::vector<size_t> m_FreeSlots;
+	};
+}
+}
+
+#endif
@@ -6,17 +6,20 @@
 * See full license text in LICENSE file at top of project tree
 */
 
-#include <sys/stat.h>
+#include <string.h>
 #include <unordered_map>
 #include <list>
 #include <thread>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
+#include <boost/filesystem.hpp>
+#include "I2PEndian.h"
 #include "Base.h"
 #include "FS.h"
 #include "Log.h"
 #include "Timestamp.h"
 #include "NetDb.hpp"
+#include "ProfileStore.h"
 #include "Profiling.h"
 
 namespace i2p
@@ -26,6 +29,7 @@ namespace data
 	static i2p::fs::HashedStorage g_ProfilesStorage("peerProfiles", "p", "profile-", "txt");
 	static std::unordered_map<i2p::data::IdentHash, std::shared_ptr<RouterProfile> > g_Profiles;
 	static std::mutex g_ProfilesMutex;
+	static std::unique_ptr<ProfileStore> g_ProfilesStore; // saved profiles, peerProfiles.dat
 
 	static boost::posix_time::ptime GetTime ()
 	{
@@ -47,51 +51,76 @@ namespace data
 		m_IsUpdated = true;
 	}
 
-	void RouterProfile::Save (const IdentHash& identHash)
+	static uint64_t ToSeconds (const boost::posix_time::ptime& t)
 	{
-		// fill sections
-		boost::property_tree::ptree participation;
-		participation.put (PEER_PROFILE_PARTICIPATION_AGREED, m_NumTunnelsAgreed);
-		participation.put (PEER_PROFILE_PARTICIPATION_DECLINED, m_NumTunnelsDeclined);
-		participation.put (PEER_PROFILE_PARTICIPATION_NON_REPLIED, m_NumTunnelsNonReplied);
-		boost::property_tree::ptree usage;
-		usage.put (PEER_PROFILE_USAGE_TAKEN, m_NumTimesTaken);
-		usage.put (PEER_PROFILE_USAGE_REJECTED, m_NumTimesRejected);
-		usage.put (PEER_PROFILE_USAGE_CONNECTED, m_HasConnected);
-		if (m_IsDuplicated)
-			usage.put (PEER_PROFILE_USAGE_DUPLICATED, true);
-		// fill property tree
-		boost::property_tree::ptree pt;
-		pt.put (PEER_PROFILE_LAST_UPDATE_TIME, boost::posix_time::to_simple_string (m_LastUpdateTime));
-		if (m_LastUnreachableTime)
-			pt.put (PEER_PROFILE_LAST_UNREACHABLE_TIME, m_LastUnreachableTime);
-		pt.put_child (PEER_PROFILE_SECTION_PARTICIPATION, participation);
-		pt.put_child (PEER_PROFILE_SECTION_USAGE, usage);
+		return (t - boost::posix_time::ptime (boost::gregorian::date (1970, 1, 1))).total_seconds ();
+	}
 
-		// save to file
-		std::string ident = identHash.ToBase64 ();
-		std::string path = g_ProfilesStorage.Path(ident);
+	static boost::posix_time::ptime FromSeconds (uint64_t seconds)
+	{
+		return boost::posix_time::ptime (boost::gregorian::date (1970, 1, 1)) + boost::posix_time::seconds (seconds);
+	}
 
-		try {
-			boost::property_tree::write_ini (path, pt);
-		} catch (std::exception& ex) {
-			/* boost exception verbose enough */
-			LogPrint (eLogError, "Profiling: ", ex.what ());
-		}
+	void RouterProfile::ToBuffer (uint8_t * buf) const
+	{
+		memset (buf, 0, PEER_PROFILE_RECORD_SIZE);
+		htobe64buf (buf, ToSeconds (m_LastUpdateTime));
+		htobe64buf (buf + 8, m_LastUnreachableTime);
+		htobe32buf (buf + 16, m_NumTunnelsAgreed);
+		htobe32buf (buf + 20, m_NumTunnelsDeclined);
+		htobe32buf (buf + 24, m_NumTunnelsNonReplied);
+		htobe32buf (buf + 28, m_NumTimesTaken);
+		htobe32buf (buf + 32, m_NumTimesRejected);
+		uint8_t flags = 0;
+		if (m_HasConnected) flags |= PEER_PROFILE_RECORD_FLAG_CONNECTED;
+		if (m_IsDuplicated) flags |= PEER_PROFILE_RECORD_FLAG_DUPLICATED;
+		buf[36] = flags;
+		// rest is reserved
 	}
 
-	void RouterProfile::Load (const IdentHash& identHash)
+	void RouterProfile::FromBuffer (const uint8_t * buf)
 	{
-		std::string ident = identHash.ToBase64 ();
-		std::string path = g_ProfilesStorage.Path(ident);
-		boost::property_tree::ptree pt;
+		m_LastUpdateTime = FromSeconds (bufbe64toh (buf));
+		m_LastUnreachableTime = bufbe64toh (buf + 8);
+		m_NumTunnelsAgreed = bufbe32toh (buf + 16);
+		m_NumTunnelsDeclined = bufbe32toh (buf + 20);
+		m_NumTunnelsNonReplied = bufbe32toh (buf + 24);
+		m_NumTimesTaken = bufbe32toh (buf + 28);
+		m_NumTimesRejected = bufbe32toh (buf + 32);
+		m_HasConnected = buf[36] & PEER_PROFILE_RECORD_FLAG_CONNECTED;
+		m_IsDuplicated = buf[36] & PEER_PROFILE_RECORD_FLAG_DUPLICATED;
+	}
+
+	bool RouterProfile::IsExpired () const
+	{
+		return (GetTime () - m_LastUpdateTime).hours () >= PEER_PROFILE_EXPIRATION_TIMEOUT;
+	}
 
-		if (!i2p::fs::Exists(path))
+	void RouterProfile::Save (const IdentHash& identHash)
+	{
+		if (!g_ProfilesStore) return;
+		uint8_t buf[PEER_PROFILE_RECORD_SIZE];
+		ToBuffer (buf);
+		if (!g_ProfilesStore->Put (identHash, buf))
+			LogPrint (eLogError, "Profiling: Can't save profile ", identHash.ToBase64 ());
+	}
+
+	void RouterProfile::Load (const IdentHash& identHash)
+	{
+		uint8_t buf[PEER_PROFILE_RECORD_SIZE];
+		if (!g_ProfilesStore || !g_ProfilesStore->Get (identHash, buf))
 		{
-			LogPrint(eLogWarning, "Profiling: No profile yet for ", ident);
+			LogPrint(eLogWarning, "Profiling: No profile yet for ", identHash.ToBase64 ());
 			return;
 		}
+		FromBuffer (buf);
+		if (IsExpired ())
+			*this = RouterProfile ();
+	}
 
+	bool RouterProfile::LoadIni (const std::string& path)
+	{
+		boost::property_tree::ptree pt;
 		try
 		{
 			boost::property_tree::read_ini (path, pt);
@@ -99,7 +128,7 @@ namespace data
 		{
 			/* boost exception verbose enough */
 			LogPrint (eLogError, "Profiling: ", ex.what ());
-			return;
+			return false;
 		}
 
 		try
@@ -107,42 +136,40 @@ namespace data
 			auto t = pt.get (PEER_PROFILE_LAST_UPDATE_TIME, "");
 			if (t.length () > 0)
 				m_LastUpdateTime = boost::posix_time::time_from_string (t);
-			if ((GetTime () - m_LastUpdateTime).hours () < PEER_PROFILE_EXPIRATION_TIMEOUT)
+			if (IsExpired ()) return false;
+			m_LastUnreachableTime = pt.get (PEER_PROFILE_LAST_UNREACHABLE_TIME, 0);
+			try
 			{
-				m_LastUnreachableTime = pt.get (PEER_PROFILE_LAST_UNREACHABLE_TIME, 0);
-				try
-				{
-					// read participations
-					auto participations = pt.get_child (PEER_PROFILE_SECTION_PARTICIPATION);
-					m_NumTunnelsAgreed = participations.get (PEER_PROFILE_PARTICIPATION_AGREED, 0);
-					m_NumTunnelsDeclined = participations.get (PEER_PROFILE_PARTICIPATION_DECLINED, 0);
-					m_NumTunnelsNonReplied = participations.get (PEER_PROFILE_PARTICIPATION_NON_REPLIED, 0);
-				}
-				catch (boost::property_tree::ptree_bad_path& ex)
-				{
-					LogPrint (eLogWarning, "Profiling: Missing section ", PEER_PROFILE_SECTION_PARTICIPATION, " in profile for ", ident);
-				}
-				try
-				{
-					// read usage
-					auto usage = pt.get_child (PEER_PROFILE_SECTION_USAGE);
-					m_NumTimesTaken = usage.get (PEER_PROFILE_USAGE_TAKEN, 0);
-					m_NumTimesRejected = usage.get (PEER_PROFILE_USAGE_REJECTED, 0);
-					m_HasConnected = usage.get (PEER_PROFILE_USAGE_CONNECTED, false);
-					m_IsDuplicated = usage.get (PEER_PROFILE_USAGE_DUPLICATED, false);
-				}
-				catch (boost::property_tree::ptree_bad_path& ex)
-				{
-					LogPrint (eLogWarning, "Profiling: Missing section ", PEER_PROFILE_SECTION_USAGE, " in profile for ", ident);
-				}
+				// read participations
+				auto participations = pt.get_child (PEER_PROFILE_SECTION_PARTICIPATION);
+				m_NumTunnelsAgreed = participations.get (PEER_PROFILE_PARTICIPATION_AGREED, 0);
+				m_NumTunnelsDeclined = participations.get (PEER_PROFILE_PARTICIPATION_DECLINED, 0);
+				m_NumTunnelsNonReplied = participations.get (PEER_PROFILE_PARTICIPATION_NON_REPLIED, 0);
+			}
+			catch (boost::property_tree::ptree_bad_path& ex)
+			{
+				LogPrint (eLogWarning, "Profiling: Missing section ", PEER_PROFILE_SECTION_PARTICIPATION, " in profile ", path);
+			}
+			try
+			{
+				// read usage
+				auto usage = pt.get_child (PEER_PROFILE_SECTION_USAGE);
+				m_NumTimesTaken = usage.get (PEER_PROFILE_USAGE_TAKEN, 0);
+				m_NumTimesRejected = usage.get (PEER_PROFILE_USAGE_REJECTED, 0);
+				m_HasConnected = usage.get (PEER_PROFILE_USAGE_CONNECTED, false);
+				m_IsDuplicated = usage.get (PEER_PROFILE_USAGE_DUPLICATED, false);
+			}
+			catch (boost::property_tree::ptree_bad_path& ex)
+			{
+				LogPrint (eLogWarning, "Profiling: Missing section ", PEER_PROFILE_SECTION_USAGE, " in profile ", path);
 			}
-			else
-				*this = RouterProfile ();
 		}
 		catch (std::exception& ex)
 		{
-			LogPrint (eLogError, "Profiling: Can't read profile ", ident, " :", ex.what ());
+			LogPrint (eLogError, "Profiling: Can't read profile ", path, " :", ex.what ());
+			return false;
 		}
+		return true;
 	}
 
 	void RouterProfile::TunnelBuildResponse (uint8_t ret)
@@ -263,16 +290,53 @@ namespace data
 		return false;
 	}	
 		
+	static void MigrateProfiles ()
+	{
+		// one time conversion of old INI files
+		if (!i2p::fs::Exists (g_ProfilesStorage.GetRoot ())) return;
+		std::vector<std::string> files;
+		g_ProfilesStorage.Traverse (files);
+		size_t numMigrated = 0;
+		for (const auto& path: files)
+		{
+			auto name = boost::filesystem::path (path).stem ().string (); // profile-<ident>
+			IdentHash ident;
+			if (name.length () <= 8 || ident.FromBase64 (name.substr (8)) != 32) continue;
+			RouterProfile profile;
+			if (profile.LoadIni (path))
+			{
+				profile.Save (ident);
+				numMigrated++;
+			}
+		}
+		g_ProfilesStore->Flush ();
+		boost::system::error_code ec;
+		boost::filesystem::remove_all (g_ProfilesStorage.GetRoot (), ec);
+		if (ec) LogPrint (eLogWarning, "Profiling: Can't remove ", g_ProfilesStorage.GetRoot (), ": ", ec.message ());
+		LogPrint (eLogInfo, "Profiling: ", numMigrated, " of ", files.size (), " profiles migrated to ", PEER_PROFILES_STORE_FILENAME);
+	}
+
 	void InitProfilesStorage ()
 	{
+		if (g_ProfilesStore) return;
 		g_ProfilesStorage.SetPlace(i2p::fs::GetDataDir());
-		g_ProfilesStorage.Init(i2p::data::GetBase64SubstitutionTable(), 64);
+		auto path = i2p::fs::DataDirPath (PEER_PROFILES_STORE_FILENAME);
+		bool isNew = !i2p::fs::Exists (path);
+		std::unique_ptr<ProfileStore> store (new ProfileStore (path, PEER_PROFILE_RECORD_SIZE));
+		if (!store->Open ())
+		{
+			LogPrint (eLogError, "Profiling: Can't open ", path, ". Profiles are not persisted");
+			return;
+		}
+		g_ProfilesStore = std::move (store);
+		if (isNew) MigrateProfiles ();
 	}
 
 	static void SaveProfilesToDisk (std::list<std::pair<i2p::data::IdentHash, std::shared_ptr<RouterProfile> > >&& profiles)
 	{
 		for (auto& it: profiles)
 			if (it.second) it.second->Save (it.first);
+		if (g_ProfilesStore) g_ProfilesStore->Flush ();
 	}	
 		
 	std::future<void> PersistProfiles ()
@@ -309,27 +373,21 @@ namespace data
 		for (auto& it: tmp)
 			if (it.second->IsUseful() && (it.second->IsUpdated () || (ts - it.second->GetLastUpdateTime ()).total_seconds () < PEER_PROFILE_EXPIRATION_TIMEOUT*3600))
 				it.second->Save (it.first);
+		if (g_ProfilesStore) g_ProfilesStore->Flush ();
 	}
 
-	static void DeleteFilesFromDisk ()
+	static void DeleteProfilesFromDisk ()
 	{
-		std::vector<std::string> files;
-		g_ProfilesStorage.Traverse(files);
-		
-		struct stat st;
-		std::time_t now = std::time(nullptr);
-		for (const auto& path: files) 
-		{
-			if (stat(path.c_str(), &st) != 0) 
-			{	
-				LogPrint(eLogWarning, "Profiling: Can't stat(): ", path);
-				continue;
-			}
-			if (now - st.st_mtime >= PEER_PROFILE_EXPIRATION_TIMEOUT*3600) 
+		if (!g_ProfilesStore) return;
+		auto ts = ToSeconds (GetTime ());
+		auto numDeleted = g_ProfilesStore->Remove ([ts](const IdentHash&, const uint8_t * buf)
 			{
-				LogPrint(eLogDebug, "Profiling: Removing expired peer profile: ", path);
-				i2p::fs::Remove(path);
-			}
+				return ts >= bufbe64toh (buf) + PEER_PROFILE_EXPIRATION_TIMEOUT*3600; // last update time
+			});
+		if (numDeleted)
+		{
+			LogPrint (eLogDebug, "Profiling: Removed ", numDeleted, " expired peer profiles");
+			g_ProfilesStore->Flush ();
 		}
 	}	
 		
@@ -347,7 +405,7 @@ namespace data
 			}
 		}
 
-		return std::async (std::launch::async, DeleteFilesFromDisk);
+		return std::async (std::launch::async, DeleteProfilesFromDisk);
 	}
 }
 }
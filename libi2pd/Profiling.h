@@ -31,6 +31,11 @@ namespace data
 	const char PEER_PROFILE_USAGE_REJECTED[] = "rejected";
 	const char PEER_PROFILE_USAGE_CONNECTED[] = "connected";
 	const char PEER_PROFILE_USAGE_DUPLICATED[] = "duplicated";
+	// binary record
+	const char PEER_PROFILES_STORE_FILENAME[] = "peerProfiles.dat";
+	const size_t PEER_PROFILE_RECORD_SIZE = 48;
+	const uint8_t PEER_PROFILE_RECORD_FLAG_CONNECTED = 0x01;
+	const uint8_t PEER_PROFILE_RECORD_FLAG_DUPLICATED = 0x02;
 	
 	const int PEER_PROFILE_EXPIRATION_TIMEOUT = 36; // in hours (1.5 days)
 	const int PEER_PROFILE_AUTOCLEAN_TIMEOUT = 1500; // in seconds (25 minutes)
@@ -50,6 +55,7 @@ namespace data
 
 			void Save (const IdentHash& identHash);
 			void Load (const IdentHash& identHash);
+			bool LoadIni (const std::string& path); // old format, false if can't read or expired
 
 			bool IsBad ();
 			bool IsUnreachable ();
@@ -71,6 +77,9 @@ namespace data
 		private:
 
 			void UpdateTime ();
+			void ToBuffer (uint8_t * buf) const; // PEER_PROFILE_RECORD_SIZE
+			void FromBuffer (const uint8_t * buf);
+			bool IsExpired () const;
 
 			bool IsAlwaysDeclining () const { return !m_NumTunnelsAgreed && m_NumTunnelsDeclined >= 5; };
 			bool IsLowPartcipationRate () const;
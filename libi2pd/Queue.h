@@ -1,5 +1,5 @@
 /*
-* Copyright (c) 2013-2020, The PurpleI2P Project
+* Copyright (c) 2013-2024, The PurpleI2P Project
 *
 * This file is part of Purple i2pd project and licensed under BSD3
 *
@@ -9,13 +9,14 @@
 #ifndef QUEUE_H__
 #define QUEUE_H__
 
-#include <queue>
+#include <deque>
 #include <vector>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
 #include <functional>
 #include <utility>
+#include <atomic>
 
 namespace i2p
 {
@@ -26,11 +27,15 @@ namespace util
 	{
 		public:
 
+			Queue (): m_MaxSize (0) {};
+
 			void Put (Element e)
 			{
 				std::unique_lock<std::mutex> l(m_QueueMutex);
-				m_Queue.push (std::move(e));
-				m_NonEmpty.notify_one ();
+				bool wasEmpty = m_Queue.empty ();
+				m_Queue.push_back (std::move(e));
+				UpdateMaxSize ();
+				if (wasEmpty) m_NonEmpty.notify_one (); // consumer waits only if empty
 			}
 
 			template<template<typename, typename...>class Container, typename... R>
@@ -39,9 +44,11 @@ namespace util
 				if (!vec.empty ())
 				{
 					std::unique_lock<std::mutex> l(m_QueueMutex);
+					bool wasEmpty = m_Queue.empty ();
 					for (const auto& it: vec)
-						m_Queue.push (std::move(it));
-					m_NonEmpty.notify_one ();
+						m_Queue.push_back (it);
+					UpdateMaxSize ();
+					if (wasEmpty) m_NonEmpty.notify_one ();
 				}
 			}
 
@@ -69,15 +76,31 @@ namespace util
 				return el;
 			}
 
+			void GetAll (std::vector<Element>& elements, size_t maxNum = 0) // appends all elements at once, or up to maxNum if set
+			{
+				std::unique_lock<std::mutex> l(m_QueueMutex);
+				GetAllNonThreadSafe (elements, maxNum);
+			}
+
+			void GetAllWithTimeout (std::vector<Element>& elements, int msec, size_t maxNum = 0)
+			{
+				std::unique_lock<std::mutex> l(m_QueueMutex);
+				if (m_Queue.empty ())
+					m_NonEmpty.wait_for (l, std::chrono::milliseconds (msec));
+				GetAllNonThreadSafe (elements, maxNum);
+			}
+
 			void Wait ()
 			{
 				std::unique_lock<std::mutex> l(m_QueueMutex);
-				m_NonEmpty.wait (l);
+				if (m_Queue.empty ())
+					m_NonEmpty.wait (l);
 			}
 
 			bool Wait (int sec, int usec)
 			{
 				std::unique_lock<std::mutex> l(m_QueueMutex);
+				if (!m_Queue.empty ()) return true;
 				return m_NonEmpty.wait_for (l, std::chrono::seconds (sec) + std::chrono::milliseconds (usec)) != std::cv_status::timeout;
 			}
 
@@ -93,6 +116,8 @@ namespace util
 				return m_Queue.size ();
 			}
 
+			size_t GetMaxSize () const { return m_MaxSize; }; // high-water mark
+
 			void WakeUp () { m_NonEmpty.notify_all (); };
 
 			Element Get ()
@@ -113,19 +138,46 @@ namespace util
 			{
 				if (!m_Queue.empty ())
 				{
-					auto el = m_Queue.front ();
-					if (!peek)
-						m_Queue.pop ();
+					if (peek) return m_Queue.front ();
+					auto el = std::move (m_Queue.front ());
+					m_Queue.pop_front ();
 					return el;
 				}
 				return nullptr;
 			}
 
+			void GetAllNonThreadSafe (std::vector<Element>& elements, size_t maxNum)
+			{
+				if (m_Queue.empty ()) return;
+				if (maxNum && maxNum < m_Queue.size ())
+				{
+					elements.reserve (elements.size () + maxNum);
+					for (size_t i = 0; i < maxNum; i++)
+					{
+						elements.push_back (std::move (m_Queue.front ()));
+						m_Queue.pop_front ();
+					}
+					return;
+				}
+				elements.reserve (elements.size () + m_Queue.size ());
+				for (auto& it: m_Queue)
+					elements.push_back (std::move (it));
+				m_Queue.clear ();
+			}
+
+			void UpdateMaxSize ()
+			{
+				// written under lock, read by others without
+				if (m_Queue.size () > m_MaxSize.load (std::memory_order_relaxed))
+					m_MaxSize.store (m_Queue.size (), std::memory_order_relaxed);
+			}
+
 		private:
 
-			std::queue<Element> m_Queue;
+			std::deque<Element> m_Queue;
 			std::mutex m_QueueMutex;
 			std::condition_variable m_NonEmpty;
+			std::atomic<size_t> m_MaxSize;
 	};
 }
 }
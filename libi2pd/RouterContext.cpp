@@ -1148,7 +1148,7 @@ namespace i2p
 	{
 		return std::max (
 			i2p::tunnel::tunnels.GetCongestionLevel (),
-			i2p::transport::transports.GetCongestionLevel (longTerm)
+			i2p::transport::transports.GetCongestionLevel (longTerm, i2p::tunnel::tunnels.GetNumLastActiveTransitTunnels ())
 		);
 	}
 	
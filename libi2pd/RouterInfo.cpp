@@ -30,6 +30,40 @@ namespace i2p
 {
 namespace data
 {
+	class ReadOnlyStreamBuf: public std::streambuf
+	{
+		// reads from existing buffer without copy
+		public:
+
+			ReadOnlyStreamBuf (const uint8_t * buf, size_t len)
+			{
+				auto b = (char *)buf;
+				setg (b, b, b + len);
+			}
+
+		protected:
+
+			pos_type seekoff (off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+			{
+				char * p = nullptr;
+				switch (dir)
+				{
+					case std::ios_base::beg: p = eback () + off; break;
+					case std::ios_base::cur: p = gptr () + off; break;
+					case std::ios_base::end: p = egptr () + off; break;
+					default: ;
+				}
+				if (!p || p < eback () || p > egptr ()) return pos_type (off_type (-1));
+				setg (eback (), p, egptr ());
+				return pos_type (p - eback ());
+			}
+
+			pos_type seekpos (pos_type pos, std::ios_base::openmode which) override
+			{
+				return seekoff (off_type (pos), std::ios_base::beg, which);
+			}
+	};
+
 	RouterInfo::Buffer::Buffer (const uint8_t * buf, size_t len)
 	{
 		if (len > size ()) len = size ();
@@ -52,7 +86,7 @@ namespace data
 		ReadFromFile (fullPath);
 	}
 
-	RouterInfo::RouterInfo (std::shared_ptr<Buffer>&& buf, size_t len):
+	RouterInfo::RouterInfo (std::shared_ptr<Buffer>&& buf, size_t len, bool verifySignature):
 		m_FamilyID (0), m_IsUpdated (true), m_IsUnreachable (false), m_IsFloodfill (false),
 		m_SupportedTransports (0), m_ReachableTransports (0), m_PublishedTransports (0),
 		m_Caps (0), m_Version (0), m_Congestion (eLowCongestion)
@@ -62,7 +96,7 @@ namespace data
 			m_Addresses = boost::make_shared<Addresses>(); // create empty list
 			m_Buffer = buf;
 			if (m_Buffer) m_Buffer->SetBufferLen (len);
-			ReadFromBuffer (true);
+			ReadFromBuffer (verifySignature);
 		}
 		else
 		{
@@ -72,8 +106,8 @@ namespace data
 		}
 	}
 
-	RouterInfo::RouterInfo (const uint8_t * buf, size_t len):
-		RouterInfo (std::make_shared<Buffer> (buf, len), len)
+	RouterInfo::RouterInfo (const uint8_t * buf, size_t len, bool verifySignature):
+		RouterInfo (std::make_shared<Buffer> (buf, len), len, verifySignature)
 	{
 	}
 
@@ -81,7 +115,7 @@ namespace data
 	{
 	}
 
-	bool RouterInfo::Update (const uint8_t * buf, size_t len)
+	bool RouterInfo::Update (const uint8_t * buf, size_t len, bool verifySignature)
 	{
 		if (len > MAX_RI_BUFFER_SIZE)
 		{
@@ -90,7 +124,7 @@ namespace data
 		}
 		// verify signature since we have identity already
 		int l = len - m_RouterIdentity->GetSignatureLen ();
-		if (m_RouterIdentity->Verify (buf, l, buf + l))
+		if (!verifySignature || m_RouterIdentity->Verify (buf, l, buf + l))
 		{
 			// clean up
 			m_IsUpdated = true;
@@ -193,8 +227,8 @@ namespace data
 			}
 		}
 		// parse RI
-		std::stringstream str;
-		str.write ((const char *)m_Buffer->data () + identityLen, bufferLen - identityLen);
+		ReadOnlyStreamBuf buf (m_Buffer->data () + identityLen, bufferLen - identityLen);
+		std::istream str (&buf);
 		ReadFromStream (str);
 		if (!str)
 		{
@@ -203,14 +203,16 @@ namespace data
 			RouterInfo (const std::string& fullPath);
 			RouterInfo (const RouterInfo& ) = default;
 			RouterInfo& operator=(const RouterInfo& ) = default;
-			RouterInfo (std::shared_ptr<Buffer>&& buf, size_t len);
-			RouterInfo (const uint8_t * buf, size_t len);
+			RouterInfo (std::shared_ptr<Buffer>&& buf, size_t len, bool verifySignature = true);
+			RouterInfo (const uint8_t * buf, size_t len, bool verifySignature = true);
 			virtual ~RouterInfo ();
 
 			std::shared_ptr<const IdentityEx> GetRouterIdentity () const { return m_RouterIdentity; };
 			void SetRouterIdentity (std::shared_ptr<const IdentityEx> identity);
 			std::string GetIdentHashBase64 () const { return GetIdentHash ().ToBase64 (); };
 			uint64_t GetTimestamp () const { return m_Timestamp; };
+			const IdentHash& GetRoutingKey () const { return m_RoutingKey; }; // for current day, set by NetDb
+			void SetRoutingKey (const IdentHash& key) { m_RoutingKey = key; };
 			int GetVersion () const { return m_Version; };
 			virtual void SetProperty (const std::string& key, const std::string& value) {};
 			virtual void ClearProperties () {};
@@ -283,6 +285,7 @@ namespace data
 			const uint8_t * LoadBuffer (const std::string& fullPath); // load if necessary
 			size_t GetBufferLen () const { return m_Buffer ? m_Buffer->GetBufferLen () : 0; };
 			void DeleteBuffer () { m_Buffer = nullptr; };
+			void SetBuffer (std::shared_ptr<Buffer> buf) { m_Buffer = buf; }; // loaded by NetDb
 			std::shared_ptr<Buffer> GetSharedBuffer () const { return m_Buffer; };	
 			std::shared_ptr<Buffer> CopyBuffer () const;
 
@@ -295,7 +298,7 @@ namespace data
 			void DropProfile () { m_Profile = nullptr; };
 			bool HasProfile () const { return (bool)m_Profile; }; 
 
-			bool Update (const uint8_t * buf, size_t len);
+			bool Update (const uint8_t * buf, size_t len, bool verifySignature = true);
 			bool IsNewer (const uint8_t * buf, size_t len) const;
 
 			/** return true if we are in a router family and the signature is valid */
@@ -341,6 +344,7 @@ namespace data
 			std::shared_ptr<const IdentityEx> m_RouterIdentity;
 			std::shared_ptr<Buffer> m_Buffer;
 			uint64_t m_Timestamp; // in milliseconds
+			IdentHash m_RoutingKey;
 			boost::shared_ptr<Addresses> m_Addresses; // TODO: use std::shared_ptr and std::atomic_store for gcc >= 4.9
 			bool m_IsUpdated, m_IsUnreachable, m_IsFloodfill;
 			CompatibleTransports m_SupportedTransports, m_ReachableTransports, m_PublishedTransports;
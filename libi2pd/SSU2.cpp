@@ -7,6 +7,16 @@
 */
 
 #include <random>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <errno.h>
+#include <string.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
 #include "Log.h"
 #include "RouterContext.h"
 #include "Transports.h"
@@ -20,12 +30,14 @@ namespace transport
 {
 	SSU2Server::SSU2Server ():
 		RunnableServiceWithWork ("SSU2"), m_ReceiveService ("SSU2r"),
-		m_SocketV4 (m_ReceiveService.GetService ()), m_SocketV6 (m_ReceiveService.GetService ()),
+		m_SocketV4 (m_ReceiveService.GetService ()), m_SocketV6 (m_ReceiveService.GetService ()), m_NumReceiveThreads (1),
 		m_AddressV4 (boost::asio::ip::address_v4()), m_AddressV6 (boost::asio::ip::address_v6()),
-		m_TerminationTimer (GetService ()), m_CleanupTimer (GetService ()), m_ResendTimer (GetService ()),
+		m_PacketsPool ("SSU2 packets"), m_TerminationTimer (GetService ()), m_CleanupTimer (GetService ()), m_ResendTimer (GetService ()),
 		m_IntroducersUpdateTimer (GetService ()), m_IntroducersUpdateTimerV6 (GetService ()),
-		m_IsPublished (true), m_IsSyncClockFromPeers (true), m_PendingTimeOffset (0),
-		m_Rng(i2p::util::GetMonotonicMicroseconds ()%1000000LL), m_IsThroughProxy (false)
+		m_IsPublished (true), m_IsSyncClockFromPeers (true), m_CongestionControlType (eSSU2CongestionControlAIMD),
+		m_PendingTimeOffset (0),
+		m_Rng(i2p::util::GetMonotonicMicroseconds ()%1000000LL),
+		m_IsBatchIO (false), m_IsSendQueueFlushPosted (false), m_IsGSOV4 (true), m_IsGSOV6 (true), m_IsThroughProxy (false)
 	{
 	}
 
@@ -36,6 +48,21 @@ namespace transport
 			StartIOService ();
 			i2p::config::GetOption ("ssu2.published", m_IsPublished);
 			i2p::config::GetOption("nettime.frompeers", m_IsSyncClockFromPeers);
+			std::string congestionControl; i2p::config::GetOption ("ssu2.congestion", congestionControl);
+			if (!GetSSU2CongestionControlType (congestionControl, m_CongestionControlType))
+			{
+				LogPrint (eLogWarning, "SSU2: Unknown congestion control ", congestionControl, ". Using aimd");
+				m_CongestionControlType = eSSU2CongestionControlAIMD;
+			}
+#ifdef __linux__
+			i2p::config::GetOption ("ssu2.batchio", m_IsBatchIO);
+			uint16_t numReceiveThreads; i2p::config::GetOption ("ssu2.receivethreads", numReceiveThreads);
+			m_NumReceiveThreads = std::max (1, std::min ((int)numReceiveThreads, SSU2_MAX_NUM_RECEIVE_THREADS));
+#else
+			m_IsBatchIO = false; // no recvmmsg/sendmmsg
+			m_NumReceiveThreads = 1; // no SO_REUSEPORT load balancing
+#endif
+			m_ReceivePackets[&m_SocketV4]; m_ReceivePackets[&m_SocketV6]; // before receive threads start
 			bool found = false;
 			auto addresses = i2p::context.GetRouterInfo ().GetAddresses ();
 			if (!addresses) return;
@@ -80,24 +107,26 @@ namespace transport
 						{
 							found = true;
 							LogPrint (eLogDebug, "SSU2: Opening IPv4 socket at Start");
-							OpenSocket (boost::asio::ip::udp::endpoint (m_AddressV4, port));
+							OpenSocket (m_SocketV4, boost::asio::ip::udp::endpoint (m_AddressV4, port));
 							m_ReceiveService.GetService ().post(
 								[this]()
 								{
 									Receive (m_SocketV4);
 								});
+							OpenAdditionalSockets (boost::asio::ip::udp::endpoint (m_AddressV4, port));
 							ScheduleIntroducersUpdateTimer (); // wait for 30 seconds and decide if we need introducers
 						}
 						if (address->IsV6 ())
 						{
 							found = true;
 							LogPrint (eLogDebug, "SSU2: Opening IPv6 socket at Start");
-							OpenSocket (boost::asio::ip::udp::endpoint (m_AddressV6, port));
+							OpenSocket (m_SocketV6, boost::asio::ip::udp::endpoint (m_AddressV6, port));
 							m_ReceiveService.GetService ().post(
 							[this]()
 								{
 									Receive (m_SocketV6);
 								});
+							OpenAdditionalSockets (boost::asio::ip::udp::endpoint (m_AddressV6, port));
 							ScheduleIntroducersUpdateTimerV6 (); // wait for 30 seconds and decide if we need introducers
 						}
 					}
@@ -110,6 +139,8 @@ namespace transport
 				if (m_IsThroughProxy)
 					ConnectToProxy ();
 				m_ReceiveService.Start ();
+				for (auto& it: m_AdditionalReceiveServices)
+					it->Start ();
 			}
 			ScheduleTermination ();
 			ScheduleCleanup ();
@@ -128,6 +159,7 @@ namespace transport
 			m_IntroducersUpdateTimerV6.cancel ();
 		}
 
+		m_IsBatchIO = false; // send termination directly
 		auto sessions = m_Sessions;
 		for (auto& it: sessions)
 		{
@@ -137,8 +169,12 @@ namespace transport
 
 		if (context.SupportsV4 () || context.SupportsV6 ())
 			m_ReceiveService.Stop ();
+		for (auto& it: m_AdditionalReceiveServices)
+			it->Stop ();
 		m_SocketV4.close ();
 		m_SocketV6.close ();
+		m_AdditionalSockets.clear ();
+		m_AdditionalReceiveServices.clear ();
 
 		if (m_UDPAssociateSocket)
 		{
@@ -148,6 +184,12 @@ namespace transport
 
 		StopIOService ();
 
+		for (auto& it: m_ReceivePackets)
+			m_PacketsPool.ReleaseMt (it.second);
+		m_ReceivePackets.clear ();
+		m_PacketsPool.ReleaseMt (m_SendQueueV4); m_SendQueueV4.clear ();
+		m_PacketsPool.ReleaseMt (m_SendQueueV6); m_SendQueueV6.clear ();
+		m_IsSendQueueFlushPosted = false;
 		m_Sessions.clear ();
 		m_SessionsByRouterHash.clear ();
 		m_PendingOutgoingSessions.clear ();
@@ -246,9 +288,8 @@ namespace transport
 		}	
 	}	
 		
-	boost::asio::ip::udp::socket& SSU2Server::OpenSocket (const boost::asio::ip::udp::endpoint& localEndpoint)
+	void SSU2Server::OpenSocket (boost::asio::ip::udp::socket& socket, const boost::asio::ip::udp::endpoint& localEndpoint)
 	{
-		boost::asio::ip::udp::socket& socket = localEndpoint.address ().is_v6 () ? m_SocketV6 : m_SocketV4;
 		try
 		{
 			if (socket.is_open ())
@@ -283,12 +324,29 @@ namespace transport
 			}
 
 			socket.non_blocking (true);
+#ifdef __linux__
+			if (m_NumReceiveThreads > 1)
+			{
+				int reusePort = 1;
+				if (setsockopt (socket.native_handle (), SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof (reusePort)))
+					LogPrint (eLogError, "SSU2: Can't set SO_REUSEPORT: ", strerror (errno));
+			}
+			auto isGSO = GetGSOFlag (socket);
+			if (isGSO && *isGSO) // don't enable again after failure
+			{
+				int gsoSize = 0; socklen_t gsoSizeLen = sizeof (gsoSize);
+				if (!getsockopt (socket.native_handle (), SOL_UDP, UDP_SEGMENT, &gsoSize, &gsoSizeLen))
+					LogPrint (eLogInfo, "SSU2: UDP GSO is supported on ", localEndpoint);
+				else
+					*isGSO = false;
+			}
+#endif
 		}
 		catch (std::exception& ex )
 		{
 			LogPrint (eLogCritical, "SSU2: Failed to open socket on ", localEndpoint.address (), ": ", ex.what());
 			ThrowFatal ("Unable to start SSU2 transport on ", localEndpoint.address (), ": ", ex.what ());
-			return socket;
+			return;
 		}
 		try
 		{
@@ -300,7 +358,39 @@ namespace transport
 			LogPrint (eLogWarning, "SSU2: Failed to bind to ", localEndpoint, ": ", ex.what(), ". Actual endpoint is ", socket.local_endpoint ());
 			// we can continue without binding being firewalled
 		}
-		return socket;
+	}
+
+	std::atomic<bool> * SSU2Server::GetGSOFlag (const boost::asio::ip::udp::socket& socket)
+	{
+		if (&socket == &m_SocketV4) return &m_IsGSOV4;
+		if (&socket == &m_SocketV6) return &m_IsGSOV6;
+		return nullptr;
+	}
+
+	void SSU2Server::OpenAdditionalSockets (const boost::asio::ip::udp::endpoint& localEndpoint)
+	{
+		// bound to the same port, kernel distributes incoming packets between sockets by remote endpoint
+		for (int i = 1; i < m_NumReceiveThreads; i++)
+		{
+			std::unique_ptr<ReceiveService> service (new ReceiveService ("SSU2r" + std::to_string (m_AdditionalReceiveServices.size () + 1)));
+			std::unique_ptr<boost::asio::ip::udp::socket> socket (new boost::asio::ip::udp::socket (service->GetService ()));
+			OpenSocket (*socket, localEndpoint);
+			boost::system::error_code ec;
+			if (!socket->is_open () || socket->local_endpoint (ec).port () != localEndpoint.port () || ec)
+			{
+				LogPrint (eLogError, "SSU2: Can't open additional socket at ", localEndpoint);
+				break;
+			}
+			auto s = socket.get ();
+			m_ReceivePackets[s];
+			service->GetService ().post (
+				[this, s]()
+				{
+					Receive (*s);
+				});
+			m_AdditionalReceiveServices.push_back (std::move (service));
+			m_AdditionalSockets.push_back (std::move (socket));
+		}
 	}
 
 	void SSU2Server::Receive (boost::asio::ip::udp::socket& socket)
@@ -338,31 +428,19 @@ namespace transport
 				return;
 			}	
 			packet->len = bytes_transferred;
-			
+			if (!m_IsThroughProxy)
+				packet->connID = GetConnID (packet->buf, packet->len);
+
 			boost::system::error_code ec;
 			size_t moreBytes = socket.available (ec);
 			if (!ec && moreBytes)
 			{
 				std::vector<Packet *> packets;
 				packets.push_back (packet);
-				while (moreBytes && packets.size () < 32)
-				{
-					packet = m_PacketsPool.AcquireMt ();
-					packet->len = socket.receive_from (boost::asio::buffer (packet->buf, SSU2_MAX_PACKET_SIZE), packet->from, 0, ec);
-					if (!ec)
-					{
-						i2p::transport::transports.UpdateReceivedBytes (packet->len);
-						packets.push_back (packet);
-						moreBytes = socket.available(ec);
-						if (ec) break;
-					}
-					else
-					{
-						LogPrint (eLogError, "SSU2: receive_from error: code ", ec.value(), ": ", ec.message ());
-						m_PacketsPool.ReleaseMt (packet);
-						break;
-					}
-				}
+				ReceivePackets (socket, packets);
+				if (!m_IsThroughProxy)
+					for (size_t i = 1; i < packets.size (); i++)
+						packets[i]->connID = GetConnID (packets[i]->buf, packets[i]->len);
 				GetService ().post (std::bind (&SSU2Server::HandleReceivedPackets, this, packets));
 			}
 			else
@@ -386,13 +464,78 @@ namespace transport
 				{
 					auto ep = socket.local_endpoint ();
 					LogPrint (eLogCritical, "SSU2: Reopening socket in HandleReceivedFrom: code ", ecode.value(), ": ", ecode.message ());
-					OpenSocket (ep);
+					OpenSocket (socket, ep);
 					Receive (socket);
 				}
 			}
 		}
 	}
 
+	void SSU2Server::ReceivePackets (boost::asio::ip::udp::socket& socket, std::vector<Packet *>& packets)
+	{
+		if (packets.size () >= SSU2_MAX_NUM_RECEIVED_PACKETS) return;
+#ifdef __linux__
+		auto it = m_IsBatchIO ? m_ReceivePackets.find (&socket) : m_ReceivePackets.end ();
+		if (it != m_ReceivePackets.end ())
+		{
+			auto& receivePackets = it->second; // accessed by socket's receive thread only
+			size_t num = SSU2_MAX_NUM_RECEIVED_PACKETS - packets.size ();
+			while (receivePackets.size () < num)
+				receivePackets.push_back (m_PacketsPool.AcquireMt ());
+			mmsghdr msgs[SSU2_MAX_NUM_RECEIVED_PACKETS];
+			iovec iovs[SSU2_MAX_NUM_RECEIVED_PACKETS];
+			memset (msgs, 0, num*sizeof (mmsghdr));
+			for (size_t i = 0; i < num; i++)
+			{
+				auto packet = receivePackets[i];
+				iovs[i].iov_base = packet->buf;
+				iovs[i].iov_len = SSU2_MAX_PACKET_SIZE;
+				msgs[i].msg_hdr.msg_name = packet->from.data ();
+				msgs[i].msg_hdr.msg_namelen = packet->from.capacity ();
+				msgs[i].msg_hdr.msg_iov = iovs + i;
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+			int n = recvmmsg (socket.native_handle (), msgs, num, MSG_DONTWAIT, nullptr);
+			if (n > 0)
+			{
+				for (int i = 0; i < n; i++)
+				{
+					auto packet = receivePackets[i];
+					packet->len = msgs[i].msg_len;
+					packet->from.resize (msgs[i].msg_hdr.msg_namelen);
+					i2p::transport::transports.UpdateReceivedBytes (packet->len);
+					if (packet->len >= SSU2_MIN_RECEIVED_PACKET_SIZE)
+						packets.push_back (packet);
+					else
+						m_PacketsPool.ReleaseMt (packet); // drop too short packets
+				}
+				receivePackets.erase (receivePackets.begin (), receivePackets.begin () + n);
+			}
+			else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+				LogPrint (eLogError, "SSU2: recvmmsg error: ", strerror (errno));
+			return;
+		}
+#endif
+		boost::system::error_code ec;
+		size_t moreBytes = socket.available (ec);
+		while (!ec && moreBytes && packets.size () < SSU2_MAX_NUM_RECEIVED_PACKETS)
+		{
+			auto packet = m_PacketsPool.AcquireMt ();
+			packet->len = socket.receive_from (boost::asio::buffer (packet->buf, SSU2_MAX_PACKET_SIZE), packet->from, 0, ec);
+			if (!ec)
+			{
+				i2p::transport::transports.UpdateReceivedBytes (packet->len);
+				packets.push_back (packet);
+				moreBytes = socket.available (ec);
+			}
+			else
+			{
+				LogPrint (eLogError, "SSU2: receive_from error: code ", ec.value(), ": ", ec.message ());
+				m_PacketsPool.ReleaseMt (packet);
+			}
+		}
+	}
+
 	void SSU2Server::HandleReceivedPacket (Packet * packet)
 	{
 		if (packet)
@@ -400,10 +543,11 @@ namespace transport
 			if (m_IsThroughProxy)
 				ProcessNextPacketFromProxy (packet->buf, packet->len);
 			else
-				ProcessNextPacket (packet->buf, packet->len, packet->from);
+				ProcessNextPacket (packet->buf, packet->len, packet->connID, packet->from);
 			m_PacketsPool.ReleaseMt (packet);
 			if (m_LastSession && m_LastSession->GetState () != eSSU2SessionStateTerminated)
 				m_LastSession->FlushData ();
+			FlushSendQueue ();
 		}
 	}
 
@@ -413,11 +557,55 @@ namespace transport
 			for (auto& packet: packets)
 				ProcessNextPacketFromProxy (packet->buf, packet->len);
 		else
-			for (auto& packet: packets)
-				ProcessNextPacket (packet->buf, packet->len, packet->from);
+		{
+			// decrypt data packets of established sessions at once
+			std::vector<std::shared_ptr<SSU2Session> > sessions (packets.size ());
+			std::vector<uint8_t> nonces (packets.size ()*12);
+			std::vector<i2p::crypto::AEADChaCha20Poly1305Message> msgs;
+			for (size_t i = 0; i < packets.size (); i++)
+			{
+				auto it = m_Sessions.find (packets[i]->connID);
+				if (it == m_Sessions.end ()) continue;
+				auto state = it->second->GetState ();
+				if (state != eSSU2SessionStateEstablished && state != eSSU2SessionStateSessionConfirmedSent) continue;
+				i2p::crypto::AEADChaCha20Poly1305Message msg;
+				if (it->second->PrepareDataDecryption (packets[i]->buf, packets[i]->len, nonces.data () + i*12, msg))
+				{
+					sessions[i] = it->second;
+					msgs.push_back (msg);
+				}
+			}
+			if (!msgs.empty ())
+				i2p::crypto::AEADChaCha20Poly1305Batch (msgs, false);
+			size_t j = 0;
+			for (size_t i = 0; i < packets.size (); i++)
+			{
+				auto packet = packets[i];
+				if (!sessions[i])
+					ProcessNextPacket (packet->buf, packet->len, packet->connID, packet->from);
+				else if (msgs[j++].result)
+					ProcessDecryptedData (sessions[i], packet);
+				else
+					LogPrint (eLogWarning, "SSU2: Data AEAD verification failed ");
+			}
+		}
 		m_PacketsPool.ReleaseMt (packets);
 		if (m_LastSession && m_LastSession->GetState () != eSSU2SessionStateTerminated)
 			m_LastSession->FlushData ();
+		FlushSendQueue ();
+	}
+
+	void SSU2Server::ProcessDecryptedData (std::shared_ptr<SSU2Session> session, const Packet * packet)
+	{
+		// session might be terminated by previous packet
+		auto state = session->GetState ();
+		if (state != eSSU2SessionStateEstablished && state != eSSU2SessionStateSessionConfirmedSent) return;
+		if (m_LastSession != session)
+		{
+			if (m_LastSession) m_LastSession->FlushData ();
+			m_LastSession = session;
+		}
+		session->ProcessDecryptedData (packet->buf, packet->len, packet->from);
 	}
 
 	void SSU2Server::AddSession (std::shared_ptr<SSU2Session> session)
@@ -551,12 +739,23 @@ namespace transport
 		return nullptr;
 	}
 
-	void SSU2Server::ProcessNextPacket (uint8_t * buf, size_t len, const boost::asio::ip::udp::endpoint& senderEndpoint)
+	uint64_t SSU2Server::GetConnID (const uint8_t * buf, size_t len)
 	{
-		if (len < 24) return;
+		if (len < 24) return 0;
 		uint64_t connID;
 		memcpy (&connID, buf, 8);
 		connID ^= CreateHeaderMask (i2p::context.GetSSU2IntroKey (), buf + (len - 24));
+		return connID;
+	}
+
+	void SSU2Server::ProcessNextPacket (uint8_t * buf, size_t len, const boost::asio::ip::udp::endpoint& senderEndpoint)
+	{
+		ProcessNextPacket (buf, len, GetConnID (buf, len), senderEndpoint);
+	}
+
+	void SSU2Server::ProcessNextPacket (uint8_t * buf, size_t len, uint64_t connID, const boost::asio::ip::udp::endpoint& senderEndpoint)
+	{
+		if (len < 24) return;
 		if (!m_LastSession || m_LastSession->GetConnID () != connID)
 		{
 			if (m_LastSession) m_LastSession->FlushData ();
@@ -646,6 +845,8 @@ namespace transport
 			SendThroughProxy (header, headerLen, nullptr, 0, payload, payloadLen, to);
 			return;
 		}
+		if (m_IsBatchIO && QueuePacket (header, headerLen, nullptr, 0, payload, payloadLen, to))
+			return;
 
 		std::vector<boost::asio::const_buffer> bufs
 		{
@@ -682,6 +883,8 @@ namespace transport
 			SendThroughProxy (header, headerLen, headerX, headerXLen, payload, payloadLen, to);
 			return;
 		}
+		if (m_IsBatchIO && QueuePacket (header, headerLen, headerX, headerXLen, payload, payloadLen, to))
+			return;
 
 		std::vector<boost::asio::const_buffer> bufs
 		{
@@ -711,6 +914,151 @@ namespace transport
 		}
 	}
 
+	bool SSU2Server::QueuePacket (const uint8_t * header, size_t headerLen, const uint8_t * headerX, size_t headerXLen,
+		const uint8_t * payload, size_t payloadLen, const boost::asio::ip::udp::endpoint& to)
+	{
+		if (headerLen + headerXLen + payloadLen > SSU2_MAX_PACKET_SIZE) return false;
+		auto packet = m_PacketsPool.AcquireMt ();
+		memcpy (packet->buf, header, headerLen);
+		if (headerXLen) memcpy (packet->buf + headerLen, headerX, headerXLen);
+		memcpy (packet->buf + headerLen + headerXLen, payload, payloadLen);
+		packet->len = headerLen + headerXLen + payloadLen;
+		packet->from = to;
+		bool isV6 = to.address ().is_v6 ();
+		auto& queue = isV6 ? m_SendQueueV6 : m_SendQueueV4;
+		queue.push_back (packet);
+		if (queue.size () >= SSU2_MAX_NUM_SENT_PACKETS)
+		{
+			SendPackets (isV6 ? m_SocketV6 : m_SocketV4, queue);
+			m_PacketsPool.ReleaseMt (queue);
+			queue.clear ();
+		}
+		else if (!m_IsSendQueueFlushPosted)
+		{
+			// send everything queued by current handler at once
+			m_IsSendQueueFlushPosted = true;
+			GetService ().post (std::bind (&SSU2Server::FlushSendQueue, this));
+		}
+		return true;
+	}
+
+	void SSU2Server::FlushSendQueue ()
+	{
+		m_IsSendQueueFlushPosted = false;
+		if (!m_SendQueueV4.empty ())
+		{
+			SendPackets (m_SocketV4, m_SendQueueV4);
+			m_PacketsPool.ReleaseMt (m_SendQueueV4);
+			m_SendQueueV4.clear ();
+		}
+		if (!m_SendQueueV6.empty ())
+		{
+			SendPackets (m_SocketV6, m_SendQueueV6);
+			m_PacketsPool.ReleaseMt (m_SendQueueV6);
+			m_SendQueueV6.clear ();
+		}
+	}
+
+	void SSU2Server::SendPackets (boost::asio::ip::udp::socket& socket, const std::vector<Packet *>& packets)
+	{
+		// packets.size () never exceeds SSU2_MAX_NUM_SENT_PACKETS
+		if (!socket.is_open ()) return;
+		size_t numBytes = 0;
+#ifdef __linux__
+		mmsghdr msgs[SSU2_MAX_NUM_SENT_PACKETS];
+		iovec iovs[SSU2_MAX_NUM_SENT_PACKETS];
+		uint8_t controls[SSU2_MAX_NUM_SENT_PACKETS][CMSG_SPACE(sizeof (uint16_t))];
+		size_t numMsgs = 0;
+		auto isGSO = GetGSOFlag (socket);
+		bool gso = isGSO && *isGSO;
+		for (size_t i = 0; i < packets.size ();)
+		{
+			// coalesce consecutive packets of the same size to the same endpoint, last one can be shorter
+			size_t j = i + 1, segmentSize = packets[i]->len;
+			if (gso)
+				while (j < packets.size () && j - i < SSU2_MAX_NUM_GSO_SEGMENTS &&
+					(j - i + 1)*segmentSize <= SSU2_MAX_GSO_DATAGRAM_SIZE &&
+					packets[j]->len <= segmentSize && packets[j]->from == packets[i]->from)
+				{
+					j++;
+					if (packets[j - 1]->len < segmentSize) break;
+				}
+			for (size_t k = i; k < j; k++)
+			{
+				iovs[k].iov_base = packets[k]->buf;
+				iovs[k].iov_len = packets[k]->len;
+			}
+			auto& msg = msgs[numMsgs].msg_hdr;
+			memset (&msgs[numMsgs], 0, sizeof (mmsghdr));
+			msg.msg_name = packets[i]->from.data ();
+			msg.msg_namelen = packets[i]->from.size ();
+			msg.msg_iov = iovs + i;
+			msg.msg_iovlen = j - i;
+			if (j - i > 1)
+			{
+				msg.msg_control = controls[numMsgs];
+				msg.msg_controllen = sizeof (controls[numMsgs]);
+				auto cmsg = CMSG_FIRSTHDR (&msg);
+				cmsg->cmsg_level = SOL_UDP;
+				cmsg->cmsg_type = UDP_SEGMENT;
+				cmsg->cmsg_len = CMSG_LEN (sizeof (uint16_t));
+				uint16_t gsoSize = segmentSize;
+				memcpy (CMSG_DATA (cmsg), &gsoSize, sizeof (gsoSize));
+			}
+			numMsgs++;
+			i = j;
+		}
+		size_t numSent = 0;
+		while (numSent < numMsgs)
+		{
+			int n = sendmmsg (socket.native_handle (), msgs + numSent, numMsgs - numSent, 0);
+			if (n > 0)
+			{
+				for (int i = 0; i < n; i++)
+					numBytes += msgs[numSent + i].msg_len;
+				numSent += n;
+				continue;
+			}
+			// first message of the rest failed
+			auto& msg = msgs[numSent].msg_hdr;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				LogPrint (eLogInfo, "SSU2: Send would block");
+			else if (msg.msg_control && (errno == EIO || errno == EINVAL))
+			{
+				// GSO is not supported by network interface, send segments one by one
+				LogPrint (eLogWarning, "SSU2: UDP GSO failed: ", strerror (errno), ". Disabled");
+				if (isGSO) *isGSO = false;
+				msg.msg_control = nullptr;
+				msg.msg_controllen = 0;
+				auto iov = msg.msg_iov; size_t iovlen = msg.msg_iovlen;
+				msg.msg_iovlen = 1;
+				for (size_t k = 0; k < iovlen; k++)
+				{
+					msg.msg_iov = iov + k;
+					if (sendmsg (socket.native_handle (), &msg, 0) >= 0)
+						numBytes += iov[k].iov_len;
+				}
+			}
+			else
+				LogPrint (eLogError, "SSU2: sendmmsg error: ", strerror (errno));
+			numSent++;
+		}
+#else
+		for (auto packet: packets)
+		{
+			boost::system::error_code ec;
+			socket.send_to (boost::asio::buffer (packet->buf, packet->len), packet->from, 0, ec);
+			if (!ec)
+				numBytes += packet->len;
+			else
+				LogPrint (ec == boost::asio::error::would_block ? eLogInfo : eLogError,
+					"SSU2: Send exception: ", ec.message (), " to ", packet->from);
+		}
+#endif
+		if (numBytes)
+			i2p::transport::transports.UpdateSentBytes (numBytes);
+	}
+
 	bool SSU2Server::CreateSession (std::shared_ptr<const i2p::data::RouterInfo> router,
 		std::shared_ptr<const i2p::data::RouterInfo::Address> address, bool peerTest)
 	{
@@ -1033,6 +1381,7 @@ namespace transport
 			}
 			for (auto it: m_PendingOutgoingSessions)
 				it.second->Resend (ts);
+			FlushSendQueue ();
 			ScheduleResend (resentPacketsNum > SSU2_MAX_RESEND_PACKETS);
 		}
 	}
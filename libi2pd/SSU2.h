@@ -38,6 +38,11 @@ namespace transport
 	const int SSU2_KEEP_ALIVE_INTERVAL = 15; // in seconds
 	const int SSU2_KEEP_ALIVE_INTERVAL_VARIANCE = 4; // in seconds
 	const int SSU2_PROXY_CONNECT_RETRY_TIMEOUT = 30; // in seconds
+	const size_t SSU2_MAX_NUM_RECEIVED_PACKETS = 32; // to read from socket at the time
+	const size_t SSU2_MAX_NUM_SENT_PACKETS = 64; // in send queue before flush
+	const size_t SSU2_MAX_NUM_GSO_SEGMENTS = 32; // packets to the same endpoint in one datagram
+	const size_t SSU2_MAX_GSO_DATAGRAM_SIZE = 65000;
+	const int SSU2_MAX_NUM_RECEIVE_THREADS = 16; // per address
 
 	class SSU2Server: private i2p::util::RunnableServiceWithWork
 	{
@@ -45,7 +50,8 @@ namespace transport
 		{
 			uint8_t buf[SSU2_MAX_PACKET_SIZE];
 			size_t len;
-			boost::asio::ip::udp::endpoint from;
+			boost::asio::ip::udp::endpoint from; // or destination if queued for send
+			uint64_t connID; // deobfuscated by receive thread
 		};
 
 		class ReceiveService: public i2p::util::RunnableService
@@ -108,18 +114,30 @@ namespace transport
 			void RescheduleIntroducersUpdateTimerV6 ();
 
 			i2p::util::MemoryPool<SSU2SentPacket>& GetSentPacketsPool () { return m_SentPacketsPool; };
+			SSU2CongestionControlType GetCongestionControlType () const { return m_CongestionControlType; };
 			i2p::util::MemoryPool<SSU2IncompleteMessage>& GetIncompleteMessagesPool () { return m_IncompleteMessagesPool; };
 			i2p::util::MemoryPool<SSU2IncompleteMessage::Fragment>& GetFragmentsPool () { return m_FragmentsPool; };
 
 		private:
 
-			boost::asio::ip::udp::socket& OpenSocket (const boost::asio::ip::udp::endpoint& localEndpoint);
+			void OpenSocket (boost::asio::ip::udp::socket& socket, const boost::asio::ip::udp::endpoint& localEndpoint);
+			std::atomic<bool> * GetGSOFlag (const boost::asio::ip::udp::socket& socket); // null for receive only sockets
+			void OpenAdditionalSockets (const boost::asio::ip::udp::endpoint& localEndpoint);
 			void Receive (boost::asio::ip::udp::socket& socket);
 			void HandleReceivedFrom (const boost::system::error_code& ecode, size_t bytes_transferred,
 				Packet * packet, boost::asio::ip::udp::socket& socket);
+			void ReceivePackets (boost::asio::ip::udp::socket& socket, std::vector<Packet *>& packets); // available without blocking
 			void HandleReceivedPacket (Packet * packet);
 			void HandleReceivedPackets (std::vector<Packet *> packets);
+			static uint64_t GetConnID (const uint8_t * buf, size_t len); // remove header obfuscation
 			void ProcessNextPacket (uint8_t * buf, size_t len, const boost::asio::ip::udp::endpoint& senderEndpoint);
+			void ProcessNextPacket (uint8_t * buf, size_t len, uint64_t connID, const boost::asio::ip::udp::endpoint& senderEndpoint);
+			void ProcessDecryptedData (std::shared_ptr<SSU2Session> session, const Packet * packet);
+
+			bool QueuePacket (const uint8_t * header, size_t headerLen, const uint8_t * headerX, size_t headerXLen,
+				const uint8_t * payload, size_t payloadLen, const boost::asio::ip::udp::endpoint& to);
+			void FlushSendQueue ();
+			void SendPackets (boost::asio::ip::udp::socket& socket, const std::vector<Packet *>& packets);
 
 			void ScheduleTermination ();
 			void HandleTerminationTimer (const boost::system::error_code& ecode);
@@ -152,7 +170,10 @@ namespace transport
 		private:
 
 			ReceiveService m_ReceiveService;
+			std::vector<std::unique_ptr<ReceiveService> > m_AdditionalReceiveServices;
 			boost::asio::ip::udp::socket m_SocketV4, m_SocketV6;
+			std::vector<std::unique_ptr<boost::asio::ip::udp::socket> > m_AdditionalSockets; // SO_REUSEPORT, receive only
+			int m_NumReceiveThreads;
 			boost::asio::ip::address m_AddressV4, m_AddressV6;
 			std::unordered_map<uint64_t, std::shared_ptr<SSU2Session> > m_Sessions;
 			std::unordered_map<i2p::data::IdentHash, std::shared_ptr<SSU2Session> > m_SessionsByRouterHash;
@@ -170,10 +191,17 @@ namespace transport
 			std::shared_ptr<SSU2Session> m_LastSession;
 			bool m_IsPublished; // if we maintain introducers
 			bool m_IsSyncClockFromPeers;
+			SSU2CongestionControlType m_CongestionControlType;
 			int64_t m_PendingTimeOffset; // during peer test
 			std::shared_ptr<const i2p::data::IdentityEx> m_PendingTimeOffsetFrom;
 			std::mt19937 m_Rng;
 
+			// batch I/O
+			bool m_IsBatchIO, m_IsSendQueueFlushPosted;
+			std::atomic<bool> m_IsGSOV4, m_IsGSOV6; // cleared if not supported or failed, never set back
+			std::map<const boost::asio::ip::udp::socket *, std::vector<Packet *> > m_ReceivePackets; // preallocated for recvmmsg, by socket, filled before receive threads start
+			std::vector<Packet *> m_SendQueueV4, m_SendQueueV6;
+
 			// proxy
 			bool m_IsThroughProxy;
 			uint8_t m_UDPRequestHeader[SOCKS5_UDP_IPV6_REQUEST_HEADER_SIZE];
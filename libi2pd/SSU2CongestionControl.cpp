@@ -0,0 +1,221 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#include <cmath>
+#include <algorithm>
+#include "SSU2CongestionControl.h"
+
+namespace i2p
+{
+namespace transport
+{
+	void SSU2AIMDCongestionControl::OnPacketsAcked (size_t numPackets, uint64_t ts)
+	{
+		m_WindowSize += numPackets;
+		if (m_WindowSize > SSU2_MAX_WINDOW_SIZE) m_WindowSize = SSU2_MAX_WINDOW_SIZE;
+	}
+
+	void SSU2AIMDCongestionControl::OnPacketsLost (size_t numPackets, uint64_t ts)
+	{
+		m_WindowSize >>= 1; // /2
+		if (m_WindowSize < SSU2_MIN_WINDOW_SIZE) m_WindowSize = SSU2_MIN_WINDOW_SIZE;
+	}
+
+	SSU2CubicCongestionControl::SSU2CubicCongestionControl ():
+		m_WindowSize (SSU2_MIN_WINDOW_SIZE), m_SlowStartThreshold (SSU2_MAX_CONGESTION_WINDOW_SIZE),
+		m_WindowMax (0), m_LastWindowMax (0), m_WindowEst (0), m_K (0),
+		m_EpochStart (0), m_LastLossTime (0), m_SRTT (0)
+	{
+	}
+
+	uint64_t SSU2CubicCongestionControl::GetPacingInterval () const
+	{
+		if (m_SRTT <= 0) return 0;
+		double gain = m_WindowSize < m_SlowStartThreshold ? SSU2_CUBIC_SLOW_START_PACING_GAIN : SSU2_CUBIC_PACING_GAIN;
+		return m_SRTT*1000.0/(m_WindowSize*gain);
+	}
+
+	void SSU2CubicCongestionControl::OnPacketsAcked (size_t numPackets, uint64_t ts)
+	{
+		if (m_WindowSize < m_SlowStartThreshold)
+			m_WindowSize += numPackets; // slow start
+		else
+		{
+			if (!m_EpochStart)
+			{
+				// first ack after loss
+				m_EpochStart = ts;
+				if (m_WindowSize < m_WindowMax)
+					m_K = std::cbrt ((m_WindowMax - m_WindowSize)/SSU2_CUBIC_C);
+				else
+				{
+					m_K = 0;
+					m_WindowMax = m_WindowSize;
+				}
+				m_WindowEst = m_WindowSize;
+			}
+			double t = (ts > m_EpochStart ? ts - m_EpochStart : 0) + m_SRTT; // in milliseconds
+			t /= 1000.0; // in seconds
+			double target = SSU2_CUBIC_C*(t - m_K)*(t - m_K)*(t - m_K) + m_WindowMax;
+			// TCP friendly region
+			m_WindowEst += numPackets*3.0*(1.0 - SSU2_CUBIC_BETA)/(1.0 + SSU2_CUBIC_BETA)/m_WindowSize;
+			if (target > m_WindowSize)
+				m_WindowSize += std::min (numPackets*(target - m_WindowSize)/m_WindowSize, numPackets/2.0); // not more than 1.5 per RTT
+			else
+				m_WindowSize += numPackets*0.01/m_WindowSize;
+			if (m_WindowEst > m_WindowSize) m_WindowSize = m_WindowEst;
+		}
+		if (m_WindowSize > SSU2_MAX_CONGESTION_WINDOW_SIZE) m_WindowSize = SSU2_MAX_CONGESTION_WINDOW_SIZE;
+	}
+
+	void SSU2CubicCongestionControl::OnPacketsLost (size_t numPackets, uint64_t ts)
+	{
+		if (m_SRTT > 0 && ts < m_LastLossTime + m_SRTT) return; // one reduction per RTT
+		m_LastLossTime = ts;
+		m_EpochStart = 0;
+		// fast convergence
+		if (m_WindowSize < m_LastWindowMax)
+			m_WindowMax = m_WindowSize*(1.0 + SSU2_CUBIC_BETA)/2.0;
+		else
+			m_WindowMax = m_WindowSize;
+		m_LastWindowMax = m_WindowSize;
+		m_WindowSize *= SSU2_CUBIC_BETA;
+		if (m_WindowSize < SSU2_MIN_WINDOW_SIZE) m_WindowSize = SSU2_MIN_WINDOW_SIZE;
+		m_SlowStartThreshold = m_WindowSize;
+	}
+
+	SSU2BBRCongestionControl::SSU2BBRCongestionControl ():
+		m_Mode (eModeStartup), m_Bandwidth (0), m_FullBandwidth (0), m_MinRTT (0),
+		m_MinRTTTimestamp (0), m_RoundStartTime (0), m_Delivered (0), m_RoundStartDelivered (0),
+		m_NumRounds (0), m_NumFullBandwidthRounds (0), m_PacingGainCycle (0)
+	{
+		std::fill (m_BandwidthSamples, m_BandwidthSamples + SSU2_BBR_BANDWIDTH_FILTER_LENGTH, 0);
+	}
+
+	size_t SSU2BBRCongestionControl::GetWindowSize () const
+	{
+		if (m_Bandwidth <= 0 || m_MinRTT <= 0) return SSU2_MIN_WINDOW_SIZE;
+		double gain = m_Mode == eModeStartup ? SSU2_BBR_HIGH_GAIN : SSU2_BBR_CWND_GAIN;
+		double windowSize = gain*m_Bandwidth*m_MinRTT; // BDP
+		if (windowSize < SSU2_MIN_WINDOW_SIZE) return SSU2_MIN_WINDOW_SIZE;
+		if (windowSize > SSU2_MAX_CONGESTION_WINDOW_SIZE) return SSU2_MAX_CONGESTION_WINDOW_SIZE;
+		return windowSize;
+	}
+
+	uint64_t SSU2BBRCongestionControl::GetPacingInterval () const
+	{
+		if (m_Bandwidth <= 0) return 0;
+		return 1000.0/(GetPacingGain ()*m_Bandwidth);
+	}
+
+	double SSU2BBRCongestionControl::GetPacingGain () const
+	{
+		switch (m_Mode)
+		{
+			case eModeStartup:
+				return SSU2_BBR_HIGH_GAIN;
+			case eModeDrain:
+				return 1.0/SSU2_BBR_HIGH_GAIN;
+			default:
+				// probe for more, then drain queue created by probing
+				if (!m_PacingGainCycle) return 1.25;
+				if (m_PacingGainCycle == 1) return 0.75;
+				return 1.0;
+		}
+	}
+
+	void SSU2BBRCongestionControl::OnPacketsAcked (size_t numPackets, uint64_t ts)
+	{
+		m_Delivered += numPackets;
+		if (!m_RoundStartTime || ts < m_RoundStartTime)
+		{
+			// first ack or clock went back
+			m_RoundStartTime = ts;
+			m_RoundStartDelivered = m_Delivered;
+			return;
+		}
+		if (m_MinRTT <= 0) return;
+		auto interval = ts - m_RoundStartTime;
+		if (interval >= m_MinRTT)
+		{
+			// round is complete
+			UpdateBandwidth ((double)(m_Delivered - m_RoundStartDelivered)/interval);
+			m_RoundStartTime = ts;
+			m_RoundStartDelivered = m_Delivered;
+			UpdateMode ();
+		}
+	}
+
+	void SSU2BBRCongestionControl::OnRTTSample (double rtt, double srtt, uint64_t ts)
+	{
+		if (m_MinRTT <= 0 || rtt < m_MinRTT || ts > m_MinRTTTimestamp + SSU2_BBR_MIN_RTT_EXPIRATION)
+		{
+			m_MinRTT = rtt;
+			m_MinRTTTimestamp = ts;
+		}
+	}
+
+	void SSU2BBRCongestionControl::UpdateBandwidth (double bandwidth)
+	{
+		m_BandwidthSamples[m_NumRounds % SSU2_BBR_BANDWIDTH_FILTER_LENGTH] = bandwidth;
+		m_NumRounds++;
+		m_Bandwidth = *std::max_element (m_BandwidthSamples,
+			m_BandwidthSamples + std::min (m_NumRounds, SSU2_BBR_BANDWIDTH_FILTER_LENGTH));
+	}
+
+	void SSU2BBRCongestionControl::UpdateMode ()
+	{
+		switch (m_Mode)
+		{
+			case eModeStartup:
+				if (m_Bandwidth >= m_FullBandwidth*SSU2_BBR_FULL_BANDWIDTH_THRESHOLD)
+				{
+					// still growing
+					m_FullBandwidth = m_Bandwidth;
+					m_NumFullBandwidthRounds = 0;
+				}
+				else if (++m_NumFullBandwidthRounds >= SSU2_BBR_FULL_BANDWIDTH_ROUNDS)
+					m_Mode = eModeDrain;
+			break;
+			case eModeDrain: // one round to drain queue created in startup
+				m_Mode = eModeProbeBandwidth;
+				m_PacingGainCycle = 0;
+			break;
+			case eModeProbeBandwidth:
+				m_PacingGainCycle = (m_PacingGainCycle + 1) % SSU2_BBR_NUM_PACING_GAIN_CYCLES;
+			break;
+		}
+	}
+
+	bool GetSSU2CongestionControlType (const std::string& name, SSU2CongestionControlType& type)
+	{
+		if (name == "aimd")
+			type = eSSU2CongestionControlAIMD;
+		else if (name == "cubic")
+			type = eSSU2CongestionControlCubic;
+		else if (name == "bbr")
+			type = eSSU2CongestionControlBBR;
+		else
+			return false;
+		return true;
+	}
+
+	std::unique_ptr<SSU2CongestionControl> CreateSSU2CongestionControl (SSU2CongestionControlType type)
+	{
+		switch (type)
+		{
+			case eSSU2CongestionControlCubic:
+				return std::unique_ptr<SSU2CongestionControl>(new SSU2CubicCongestionControl ());
+			case eSSU2CongestionControlBBR:
+				return std::unique_ptr<SSU2CongestionControl>(new SSU2BBRCongestionControl ());
+			default:
+				return std::unique_ptr<SSU2CongestionControl>(new SSU2AIMDCongestionControl ());
+		}
+	}
+}
+}
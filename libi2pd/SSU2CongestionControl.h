@@ -0,0 +1,146 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#ifndef SSU2_CONGESTION_CONTROL_H__
+#define SSU2_CONGESTION_CONTROL_H__
+
+#include <inttypes.h>
+#include <memory>
+#include <string>
+
+namespace i2p
+{
+namespace transport
+{
+	const size_t SSU2_MIN_WINDOW_SIZE = 16; // in packets
+	const size_t SSU2_MAX_WINDOW_SIZE = 256; // in packets
+	const size_t SSU2_MAX_CONGESTION_WINDOW_SIZE = 512; // in packets, must fit ack ranges
+	// CUBIC
+	const double SSU2_CUBIC_C = 0.4;
+	const double SSU2_CUBIC_BETA = 0.7;
+	const double SSU2_CUBIC_SLOW_START_PACING_GAIN = 2.0;
+	const double SSU2_CUBIC_PACING_GAIN = 1.2;
+	// BBR
+	const int SSU2_BBR_BANDWIDTH_FILTER_LENGTH = 10; // in rounds
+	const uint64_t SSU2_BBR_MIN_RTT_EXPIRATION = 10000; // in milliseconds
+	const double SSU2_BBR_HIGH_GAIN = 2.89; // 2/ln(2)
+	const double SSU2_BBR_CWND_GAIN = 2.0;
+	const int SSU2_BBR_FULL_BANDWIDTH_ROUNDS = 3;
+	const double SSU2_BBR_FULL_BANDWIDTH_THRESHOLD = 1.25;
+	const int SSU2_BBR_NUM_PACING_GAIN_CYCLES = 8;
+
+	enum SSU2CongestionControlType
+	{
+		eSSU2CongestionControlAIMD = 0,
+		eSSU2CongestionControlCubic,
+		eSSU2CongestionControlBBR
+	};
+
+	class SSU2CongestionControl
+	{
+		public:
+
+			virtual ~SSU2CongestionControl () {};
+
+			virtual const char * GetName () const = 0;
+			virtual size_t GetWindowSize () const = 0; // in packets
+			virtual uint64_t GetPacingInterval () const { return 0; }; // between packets in microseconds, 0 if not paced
+
+			virtual void OnPacketsAcked (size_t numPackets, uint64_t ts) = 0; // ts in milliseconds
+			virtual void OnPacketsLost (size_t numPackets, uint64_t ts) = 0; // called once per resend
+			virtual void OnRTTSample (double rtt, double srtt, uint64_t ts) {}; // in milliseconds
+	};
+
+	class SSU2AIMDCongestionControl: public SSU2CongestionControl
+	{
+		// window grows by number of acked packets, halves on loss
+		public:
+
+			SSU2AIMDCongestionControl (): m_WindowSize (SSU2_MIN_WINDOW_SIZE) {};
+
+			const char * GetName () const override { return "aimd"; };
+			size_t GetWindowSize () const override { return m_WindowSize; };
+
+			void OnPacketsAcked (size_t numPackets, uint64_t ts) override;
+			void OnPacketsLost (size_t numPackets, uint64_t ts) override;
+
+		private:
+
+			size_t m_WindowSize;
+	};
+
+	class SSU2CubicCongestionControl: public SSU2CongestionControl
+	{
+		// RFC 8312 in packets
+		public:
+
+			SSU2CubicCongestionControl ();
+
+			const char * GetName () const override { return "cubic"; };
+			size_t GetWindowSize () const override { return m_WindowSize; };
+			uint64_t GetPacingInterval () const override;
+
+			void OnPacketsAcked (size_t numPackets, uint64_t ts) override;
+			void OnPacketsLost (size_t numPackets, uint64_t ts) override;
+			void OnRTTSample (double rtt, double srtt, uint64_t ts) override { m_SRTT = srtt; };
+
+		private:
+
+			double m_WindowSize, m_SlowStartThreshold, m_WindowMax, m_LastWindowMax, m_WindowEst, m_K;
+			uint64_t m_EpochStart, m_LastLossTime; // in milliseconds
+			double m_SRTT; // in milliseconds, 0 if unknown
+	};
+
+	class SSU2BBRCongestionControl: public SSU2CongestionControl
+	{
+		// window and pacing rate from max delivery rate and min RTT, loss is not a signal
+		enum Mode
+		{
+			eModeStartup = 0,
+			eModeDrain,
+			eModeProbeBandwidth
+		};
+
+		public:
+
+			SSU2BBRCongestionControl ();
+
+			const char * GetName () const override { return "bbr"; };
+			size_t GetWindowSize () const override;
+			uint64_t GetPacingInterval () const override;
+
+			void OnPacketsAcked (size_t numPackets, uint64_t ts) override;
+			void OnPacketsLost (size_t numPackets, uint64_t ts) override {};
+			void OnRTTSample (double rtt, double srtt, uint64_t ts) override;
+
+			double GetBandwidth () const { return m_Bandwidth; }; // in packets per millisecond
+			double GetMinRTT () const { return m_MinRTT; };
+
+		private:
+
+			void UpdateBandwidth (double bandwidth);
+			void UpdateMode ();
+			double GetPacingGain () const;
+
+		private:
+
+			Mode m_Mode;
+			double m_BandwidthSamples[SSU2_BBR_BANDWIDTH_FILTER_LENGTH]; // one per round
+			double m_Bandwidth, m_FullBandwidth; // max of samples
+			double m_MinRTT; // 0 if unknown
+			uint64_t m_MinRTTTimestamp, m_RoundStartTime; // in milliseconds
+			uint64_t m_Delivered, m_RoundStartDelivered; // in packets
+			int m_NumRounds, m_NumFullBandwidthRounds, m_PacingGainCycle;
+	};
+
+	bool GetSSU2CongestionControlType (const std::string& name, SSU2CongestionControlType& type);
+	std::unique_ptr<SSU2CongestionControl> CreateSSU2CongestionControl (SSU2CongestionControlType type);
+}
+}
+
+#endif
@@ -78,17 +78,238 @@ namespace transport
 		lastFragmentInsertTime = i2p::util::GetSecondsSinceEpoch ();
 	}
 
+	SSU2SentPackets::SSU2SentPackets (i2p::util::MemoryPool<SSU2SentPacket>& pool):
+		m_Pool (pool), m_Packets (SSU2_MIN_SENT_PACKETS_RING_SIZE, nullptr),
+		m_FirstPacketNum (0), m_EndPacketNum (0), m_Size (0)
+	{
+	}
+
+	void SSU2SentPackets::Insert (uint32_t packetNum, SSU2SentPacket * packet)
+	{
+		if (!packet) return;
+		if (packetNum < m_EndPacketNum)
+		{
+			LogPrint (eLogError, "SSU2: Sent packet ", packetNum, " is less than last ", m_EndPacketNum - 1);
+			Release (packet);
+			return;
+		}
+		if (!m_Size) m_FirstPacketNum = packetNum;
+		size_t numSlots = packetNum - m_FirstPacketNum + 1;
+		if (numSlots > m_Packets.size ())
+		{
+			size_t size = m_Packets.size ();
+			while (size < numSlots) size <<= 1;
+			Resize (size);
+		}
+		m_Packets[packetNum & (m_Packets.size () - 1)] = packet;
+		m_EndPacketNum = packetNum + 1;
+		m_Size++;
+	}
+
+	SSU2SentPacket * SSU2SentPackets::Extract (uint32_t packetNum)
+	{
+		auto packet = Get (packetNum);
+		if (!packet) return nullptr;
+		size_t mask = m_Packets.size () - 1;
+		m_Packets[packetNum & mask] = nullptr;
+		m_Size--;
+		if (!m_Size)
+			m_FirstPacketNum = m_EndPacketNum;
+		else if (packetNum == m_FirstPacketNum)
+		{
+			// move to next not acked
+			do m_FirstPacketNum++;
+			while (!m_Packets[m_FirstPacketNum & mask]);
+		}
+		return packet;
+	}
+
+	void SSU2SentPackets::Clear ()
+	{
+		if (m_Size)
+		{
+			size_t mask = m_Packets.size () - 1;
+			for (auto packetNum = m_FirstPacketNum; packetNum < m_EndPacketNum; packetNum++)
+			{
+				auto& packet = m_Packets[packetNum & mask];
+				if (packet)
+				{
+					Release (packet);
+					packet = nullptr;
+				}
+			}
+			m_Size = 0;
+		}
+		m_FirstPacketNum = m_EndPacketNum;
+		if (m_Packets.size () > SSU2_MIN_SENT_PACKETS_RING_SIZE)
+			std::vector<SSU2SentPacket *>(SSU2_MIN_SENT_PACKETS_RING_SIZE, nullptr).swap (m_Packets);
+	}
+
+	void SSU2SentPackets::Resize (size_t size)
+	{
+		std::vector<SSU2SentPacket *> packets (size, nullptr);
+		size_t mask = m_Packets.size () - 1, newMask = size - 1;
+		for (auto packetNum = m_FirstPacketNum; packetNum < m_EndPacketNum; packetNum++)
+			packets[packetNum & newMask] = m_Packets[packetNum & mask];
+		m_Packets.swap (packets);
+	}
+
+	static inline int GetLowestBit (uint64_t bits) // bits != 0
+	{
+#if defined(__GNUC__)
+		return __builtin_ctzll (bits);
+#else
+		int n = 0;
+		while (!(bits & 1)) { bits >>= 1; n++; }
+		return n;
+#endif
+	}
+
+	static inline int GetHighestBit (uint64_t bits) // bits != 0
+	{
+#if defined(__GNUC__)
+		return 63 - __builtin_clzll (bits);
+#else
+		int n = 63;
+		while (!(bits & 0x8000000000000000ULL)) { bits <<= 1; n--; }
+		return n;
+#endif
+	}
+
+	SSU2OutOfSequencePackets::ReverseIterator::ReverseIterator (const SSU2OutOfSequencePackets * packets, bool isEnd):
+		m_OutOfSequencePackets (packets), m_PacketNum (0), m_IsEnd (isEnd)
+	{
+		if (!m_IsEnd) m_PacketNum = packets->GetLast ();
+	}
+
+	SSU2OutOfSequencePackets::ReverseIterator& SSU2OutOfSequencePackets::ReverseIterator::operator++ ()
+	{
+		if (!m_IsEnd && !m_OutOfSequencePackets->FindPrev (m_PacketNum, m_PacketNum))
+			m_IsEnd = true;
+		return *this;
+	}
+
+	uint32_t SSU2OutOfSequencePackets::GetFirst () const
+	{
+		// first word is never zero if not empty
+		return m_Base + GetLowestBit (m_Bits.front ());
+	}
+
+	uint32_t SSU2OutOfSequencePackets::GetLast () const
+	{
+		// last word is never zero if not empty
+		return m_Base + ((m_Bits.size () - 1) << 6) + GetHighestBit (m_Bits.back ());
+	}
+
+	bool SSU2OutOfSequencePackets::Contains (uint32_t packetNum) const
+	{
+		if (packetNum < m_Base) return false;
+		size_t ind = (packetNum - m_Base) >> 6;
+		if (ind >= m_Bits.size ()) return false;
+		return m_Bits[ind] & (1ULL << ((packetNum - m_Base) & 0x3F));
+	}
+
+	bool SSU2OutOfSequencePackets::Insert (uint32_t packetNum)
+	{
+		if (!m_Size)
+		{
+			m_Bits.clear ();
+			m_Base = packetNum & ~0x3F;
+		}
+		else if (packetNum < m_Base)
+		{
+			uint32_t base = packetNum & ~0x3F;
+			if (GetLast () - base >= SSU2_MAX_NUM_OUT_OF_SEQUENCE_PACKETS) return false;
+			m_Bits.insert (m_Bits.begin (), (m_Base - base) >> 6, 0);
+			m_Base = base;
+		}
+		else if (packetNum - m_Base >= SSU2_MAX_NUM_OUT_OF_SEQUENCE_PACKETS)
+			return false;
+		size_t ind = (packetNum - m_Base) >> 6;
+		if (ind >= m_Bits.size ()) m_Bits.resize (ind + 1, 0);
+		uint64_t bit = 1ULL << ((packetNum - m_Base) & 0x3F);
+		if (!(m_Bits[ind] & bit))
+		{
+			m_Bits[ind] |= bit;
+			m_Size++;
+		}
+		return true;
+	}
+
+	void SSU2OutOfSequencePackets::EraseUntil (uint32_t packetNum)
+	{
+		if (!m_Size || packetNum < m_Base) return;
+		size_t ind = (packetNum - m_Base) >> 6, numWords = ind; // numWords to delete
+		if (ind < m_Bits.size ())
+		{
+			int numBits = ((packetNum - m_Base) & 0x3F) + 1;
+			uint64_t mask = numBits < 64 ? ((1ULL << numBits) - 1) : ~0ULL;
+			uint64_t erased = m_Bits[ind] & mask;
+			while (erased) { erased &= erased - 1; m_Size--; }
+			m_Bits[ind] &= ~mask;
+			if (!m_Bits[ind]) numWords++;
+		}
+		else
+			numWords = m_Bits.size ();
+		for (size_t i = 0; i < numWords && i < ind; i++)
+		{
+			uint64_t bits = m_Bits[i];
+			while (bits) { bits &= bits - 1; m_Size--; }
+		}
+		if (!m_Size)
+		{
+			Clear ();
+			return;
+		}
+		m_Bits.erase (m_Bits.begin (), m_Bits.begin () + numWords);
+		m_Base += numWords << 6;
+		while (!m_Bits.front ()) // can't be empty
+		{
+			m_Bits.erase (m_Bits.begin ());
+			m_Base += 64;
+		}
+	}
+
+	void SSU2OutOfSequencePackets::Clear ()
+	{
+		m_Bits.clear ();
+		m_Base = 0;
+		m_Size = 0;
+	}
+
+	bool SSU2OutOfSequencePackets::FindPrev (uint32_t packetNum, uint32_t& prev) const
+	{
+		if (!m_Size || packetNum <= m_Base) return false;
+		uint32_t offset = packetNum - 1 - m_Base;
+		size_t ind = offset >> 6;
+		int bit = offset & 0x3F;
+		if (ind >= m_Bits.size ())
+		{
+			ind = m_Bits.size () - 1;
+			bit = 63;
+		}
+		uint64_t bits = m_Bits[ind] & (bit < 63 ? ((1ULL << (bit + 1)) - 1) : ~0ULL);
+		while (!bits)
+		{
+			if (!ind) return false;
+			bits = m_Bits[--ind];
+		}
+		prev = m_Base + (ind << 6) + GetHighestBit (bits);
+		return true;
+	}
+
 	SSU2Session::SSU2Session (SSU2Server& server, std::shared_ptr<const i2p::data::RouterInfo> in_RemoteRouter,
 		std::shared_ptr<const i2p::data::RouterInfo::Address> addr):
 		TransportSession (in_RemoteRouter, SSU2_CONNECT_TIMEOUT),
 		m_Server (server), m_Address (addr), m_RemoteTransports (0), m_RemotePeerTestTransports (0),
 		m_DestConnID (0), m_SourceConnID (0), m_State (eSSU2SessionStateUnknown),
 		m_SendPacketNum (0), m_ReceivePacketNum (0), m_LastDatetimeSentPacketNum (0),
-		m_IsDataReceived (false), m_RTT (SSU2_UNKNOWN_RTT),
+		m_SentPackets (server.GetSentPacketsPool ()), m_IsDataReceived (false), m_RTT (SSU2_UNKNOWN_RTT),
 		m_MsgLocalExpirationTimeout (I2NP_MESSAGE_LOCAL_EXPIRATION_TIMEOUT_MAX),
 		m_MsgLocalSemiExpirationTimeout (I2NP_MESSAGE_LOCAL_EXPIRATION_TIMEOUT_MAX / 2),
-		m_WindowSize (SSU2_MIN_WINDOW_SIZE),
-		m_RTO (SSU2_INITIAL_RTO), m_RelayTag (0),m_ConnectTimer (server.GetService ()), 
+		m_RTO (SSU2_INITIAL_RTO), m_CongestionControl (CreateSSU2CongestionControl (server.GetCongestionControlType ())),
+		m_NumLostPackets (0), m_NextPacingTime (0), m_PacingTimer (server.GetService ()), m_IsPacingTimerScheduled (false),
+		m_RelayTag (0),m_ConnectTimer (server.GetService ()), 
 		m_TerminationReason (eSSU2TerminationReasonNormalClose),
 		m_MaxPayloadSize (SSU2_MIN_PACKET_SIZE - IPV6_HEADER_SIZE - UDP_HEADER_SIZE - 32), // min size
 		m_LastResendTime (0)
@@ -234,16 +455,18 @@ namespace transport
 		session->m_DestConnID = ~session->m_SourceConnID;
 		m_Server.AddSession (session);
 		// peer test block
-		auto packet = m_Server.GetSentPacketsPool ().AcquireShared ();
+		auto packet = m_SentPackets.Acquire ();
 		packet->payloadSize = CreatePeerTestBlock (packet->payload, m_MaxPayloadSize, nonce);
 		if (packet->payloadSize > 0)
 		{
 			packet->payloadSize += CreatePaddingBlock (packet->payload + packet->payloadSize, m_MaxPayloadSize - packet->payloadSize);
 			uint32_t packetNum = SendData (packet->payload, packet->payloadSize, SSU2_FLAG_IMMEDIATE_ACK_REQUESTED);
 			packet->sendTime = ts;
-			m_SentPackets.emplace (packetNum, packet);
+			m_SentPackets.Insert (packetNum, packet);
 			LogPrint (eLogDebug, "SSU2: PeerTest msg=1 sent to ", i2p::data::GetIdentHashAbbreviation (GetRemoteIdentity ()->GetIdentHash ()));
 		}
+		else
+			m_SentPackets.Release (packet);
 	}
 
 	void SSU2Session::SendKeepAlive ()
@@ -262,17 +485,16 @@ namespace transport
 		{
 			m_State = eSSU2SessionStateTerminated;
 			m_ConnectTimer.cancel ();
+			m_PacingTimer.cancel ();
 			m_OnEstablished = nullptr;
 			if (m_RelayTag)
 				m_Server.RemoveRelay (m_RelayTag);
 			m_SentHandshakePacket.reset (nullptr);
 			m_SessionConfirmedFragment.reset (nullptr);
 			m_PathChallenge.reset (nullptr);
-			for (auto& it: m_SendQueue)
-				it->Drop ();
-			m_SendQueue.clear ();
+			m_SendQueue.DropAll ();
 			SetSendQueueSize (0);
-			m_SentPackets.clear ();
+			m_SentPackets.Clear ();
 			m_IncompleteMessages.clear ();
 			m_RelaySessions.clear ();
 			m_PeerTests.clear ();
@@ -362,15 +584,15 @@ namespace transport
 		if (m_State == eSSU2SessionStateTerminated) return;
 		uint64_t mts = i2p::util::GetMonotonicMicroseconds ();
 		bool isSemiFull = false;
-		if (m_SendQueue.size ())
+		if (!m_SendQueue.IsEmpty ())
 		{
-			int64_t queueLag = (int64_t)mts - (int64_t)m_SendQueue.front ()->GetEnqueueTime ();
+			int64_t queueLag = m_SendQueue.GetLag (mts);
 			isSemiFull = queueLag > m_MsgLocalSemiExpirationTimeout;
 			if (isSemiFull)
 			{
 				LogPrint (eLogWarning, "SSU2: Outgoing messages queue to ",
 					i2p::data::GetIdentHashAbbreviation (GetRemoteIdentity ()->GetIdentHash ()),
-					" is semi-full (size = ", m_SendQueue.size (), ", lag = ", queueLag / 1000, ", rtt = ", (int)m_RTT, ")");
+					" is semi-full (size = ", m_SendQueue.GetSize (), ", lag = ", queueLag / 1000, ", rtt = ", (int)m_RTT, ")");
 			}
 		}
 		for (auto it: msgs)
@@ -378,71 +600,75 @@ namespace transport
 			if (isSemiFull && it->onDrop)
 				it->Drop (); // drop earlier because we can handle it
 			else
-			{
-				it->SetEnqueueTime (mts);
-				m_SendQueue.push_back (std::move (it));
-			}
+				m_SendQueue.Put (std::move (it), mts);
 		}
 		if (IsEstablished ())
 		{	
 			SendQueue ();
-			if (m_SendQueue.size () > 0) // windows is full
+			if (!m_SendQueue.IsEmpty ()) // windows is full
 				Resend (i2p::util::GetMillisecondsSinceEpoch ());
 		}	
-		SetSendQueueSize (m_SendQueue.size ());
+		SetSendQueueSize (m_SendQueue.GetSize ());
 	}
 
 	void SSU2Session::MoveSendQueue (std::shared_ptr<SSU2Session> other)
 	{
-		if (!other || m_SendQueue.empty ()) return;
-		std::vector<std::shared_ptr<I2NPMessage> > msgs;
+		if (!other || m_SendQueue.IsEmpty ()) return;
+		std::vector<std::shared_ptr<I2NPMessage> > queue, msgs;
+		m_SendQueue.GetAll (queue);
 		auto ts = i2p::util::GetMillisecondsSinceEpoch ();
-		for (auto it: m_SendQueue)
+		for (auto& it: queue)
 			if (!it->IsExpired (ts))
 				msgs.push_back (it);
 			else
 				it->Drop ();
-		m_SendQueue.clear ();
 		if (!msgs.empty ())
 			other->PostI2NPMessages (msgs);
 	}	
 		
 	bool SSU2Session::SendQueue ()
 	{
-		if (!m_SendQueue.empty () && m_SentPackets.size () <= m_WindowSize && IsEstablished ())
+		if (!m_SendQueue.IsEmpty () && m_SentPackets.GetSize () <= GetWindowSize () && IsEstablished ())
 		{
 			auto ts = i2p::util::GetMillisecondsSinceEpoch ();
 			uint64_t mts = i2p::util::GetMonotonicMicroseconds ();
-			auto packet = m_Server.GetSentPacketsPool ().AcquireShared ();
+			if (!IsPacingAllowed (mts))
+			{
+				SchedulePacingTimer (mts);
+				return false;
+			}
+			auto packet = m_SentPackets.Acquire ();
 			size_t ackBlockSize = CreateAckBlock (packet->payload, m_MaxPayloadSize);
 			bool ackBlockSent = false;
 			packet->payloadSize += ackBlockSize;
-			while (!m_SendQueue.empty () && m_SentPackets.size () <= m_WindowSize)
+			while (m_SentPackets.GetSize () <= GetWindowSize () && IsPacingAllowed (mts))
 			{
-				auto msg = m_SendQueue.front ();
-				if (!msg || msg->IsExpired (ts) || msg->GetEnqueueTime() + m_MsgLocalExpirationTimeout < mts)
+				auto msg = m_SendQueue.GetFront (mts);
+				if (!msg) break;
+				if (msg->IsExpired (ts) || msg->GetEnqueueTime() + m_MsgLocalExpirationTimeout < mts)
 				{
-					// drop null or expired message
-					if (msg) msg->Drop ();
-					m_SendQueue.pop_front ();
+					// drop expired message
+					m_SendQueue.DropFront ();
 					continue;
 				}
 				size_t len = msg->GetNTCP2Length () + 3;
 				if (len > m_MaxPayloadSize) // message too long
 				{
-					m_SendQueue.pop_front ();
+					m_SendQueue.PopFront (mts);
+					auto sendPacketNum = m_SendPacketNum;
 					if (SendFragmentedMessage (msg))
 						ackBlockSent = true;
+					UpdatePacingTime (mts, m_SendPacketNum - sendPacketNum);
 				}
 				else if (packet->payloadSize + len <= m_MaxPayloadSize)
 				{
-					m_SendQueue.pop_front ();
+					m_SendQueue.PopFront (mts);
 					packet->payloadSize += CreateI2NPBlock (packet->payload + packet->payloadSize, m_MaxPayloadSize - packet->payloadSize, std::move (msg));
 				}
 				else
 				{
 					// create new packet and copy ack block
-					auto newPacket = m_Server.GetSentPacketsPool ().AcquireShared ();
+					auto newPacket = m_SentPackets.Acquire ();
 					memcpy (newPacket->payload, packet->payload, ackBlockSize);
 					newPacket->payloadSize = ackBlockSize;
 					// complete current packet
@@ -467,13 +693,14 @@ namespace transport
 						else // drop Ack block completely
 							packet->payloadSize = 0;
 						// msg fits single packet
-						m_SendQueue.pop_front ();
+						m_SendQueue.PopFront (mts);
 						packet->payloadSize += CreateI2NPBlock (packet->payload + packet->payloadSize, m_MaxPayloadSize - packet->payloadSize, std::move (msg));
 					}
 					// send right a way
 					uint32_t packetNum = SendData (packet->payload, packet->payloadSize);
 					packet->sendTime = ts;
-					m_SentPackets.emplace (packetNum, packet);
+					m_SentPackets.Insert (packetNum, packet);
+					UpdatePacingTime (mts, 1);
 					packet = newPacket; // just ack block
 				}
 			};
@@ -485,13 +712,54 @@ namespace transport
 					packet->payloadSize += CreatePaddingBlock (packet->payload + packet->payloadSize, m_MaxPayloadSize - packet->payloadSize);
 				uint32_t packetNum = SendData (packet->payload, packet->payloadSize, SSU2_FLAG_IMMEDIATE_ACK_REQUESTED);
 				packet->sendTime = ts;
-				m_SentPackets.emplace (packetNum, packet);
+				m_SentPackets.Insert (packetNum, packet);
+				UpdatePacingTime (mts, 1);
 			}
+			else
+				m_SentPackets.Release (packet); // just ack block
+			if (!m_SendQueue.IsEmpty () && m_SentPackets.GetSize () <= GetWindowSize ())
+				SchedulePacingTimer (mts); // stopped by pacing
 			return ackBlockSent;
 		}
 		return false;
 	}
 
+	bool SSU2Session::IsPacingAllowed (uint64_t mts) const
+	{
+		auto interval = m_CongestionControl->GetPacingInterval ();
+		if (!interval) return true;
+		return m_NextPacingTime <= mts + (SSU2_PACING_MAX_BURST - 1)*interval;
+	}
+
+	void SSU2Session::UpdatePacingTime (uint64_t mts, int numPackets)
+	{
+		auto interval = m_CongestionControl->GetPacingInterval ();
+		if (!interval) return;
+		if (m_NextPacingTime < mts) m_NextPacingTime = mts; // no credit for idle time
+		m_NextPacingTime += numPackets*interval;
+	}
+
+	void SSU2Session::SchedulePacingTimer (uint64_t mts)
+	{
+		if (m_IsPacingTimerScheduled) return;
+		auto interval = m_CongestionControl->GetPacingInterval ();
+		uint64_t allowedTime = m_NextPacingTime > (SSU2_PACING_MAX_BURST - 1)*interval ?
+			m_NextPacingTime - (SSU2_PACING_MAX_BURST - 1)*interval : 0;
+		m_IsPacingTimerScheduled = true;
+		m_PacingTimer.expires_from_now (boost::posix_time::microseconds (allowedTime > mts ? allowedTime - mts : 0));
+		m_PacingTimer.async_wait (std::bind (&SSU2Session::HandlePacingTimer, shared_from_this (), std::placeholders::_1));
+	}
+
+	void SSU2Session::HandlePacingTimer (const boost::system::error_code& ecode)
+	{
+		m_IsPacingTimerScheduled = false;
+		if (ecode != boost::asio::error::operation_aborted && IsEstablished ())
+		{
+			SendQueue ();
+			SetSendQueueSize (m_SendQueue.GetSize ());
+		}
+	}
+
 	bool SSU2Session::SendFragmentedMessage (std::shared_ptr<I2NPMessage> msg)
 	{
 		if (!msg) return false;
@@ -501,7 +769,7 @@ namespace transport
 		uint32_t msgID;
 		memcpy (&msgID, msg->GetHeader () + I2NP_HEADER_MSGID_OFFSET, 4);
 		auto ts = i2p::util::GetMillisecondsSinceEpoch ();
-		auto packet = m_Server.GetSentPacketsPool ().AcquireShared ();
+		auto packet = m_SentPackets.Acquire ();
 		if (extraSize >= 8)
 		{
 			packet->payloadSize = CreateAckBlock (packet->payload, extraSize);
@@ -510,8 +778,8 @@ namespace transport
 			{
 				uint32_t packetNum = SendData (packet->payload, packet->payloadSize);
 				packet->sendTime = ts;
-				m_SentPackets.emplace (packetNum, packet);
-				packet = m_Server.GetSentPacketsPool ().AcquireShared ();
+				m_SentPackets.Insert (packetNum, packet);
+				packet = m_SentPackets.Acquire ();
 			}
 			else
 				extraSize -= packet->payloadSize;
@@ -519,17 +787,21 @@ namespace transport
 		size_t offset = extraSize > 0 ? (m_Server.GetRng ()() % extraSize) : 0;
 		if (offset + packet->payloadSize >= m_MaxPayloadSize) offset = 0;
 		auto size = CreateFirstFragmentBlock (packet->payload + packet->payloadSize, m_MaxPayloadSize - offset - packet->payloadSize, msg);
-		if (!size) return false;
+		if (!size)
+		{
+			m_SentPackets.Release (packet);
+			return false;
+		}
 		extraSize -= offset;
 		packet->payloadSize += size;
 		uint32_t firstPacketNum = SendData (packet->payload, packet->payloadSize);
 		packet->sendTime = ts;
-		m_SentPackets.emplace (firstPacketNum, packet);
+		m_SentPackets.Insert (firstPacketNum, packet);
 		uint8_t fragmentNum = 0;
 		while (msg->offset < msg->len)
 		{
 			offset = extraSize > 0 ? (m_Server.GetRng ()() % extraSize) : 0;
-			packet = m_Server.GetSentPacketsPool ().AcquireShared ();
+			packet = m_SentPackets.Acquire ();
 			packet->payloadSize = CreateFollowOnFragmentBlock (packet->payload, m_MaxPayloadSize - offset, msg, fragmentNum, msgID);
 			extraSize -= offset;
 			uint8_t flags = 0;
@@ -541,13 +813,14 @@ namespace transport
 			}
 			uint32_t followonPacketNum = SendData (packet->payload, packet->payloadSize, flags);
 			packet->sendTime = ts;
-			m_SentPackets.emplace (followonPacketNum, packet);
+			m_SentPackets.Insert (followonPacketNum, packet);
 		}
 		return ackBlockSent;
 	}
 
 	size_t SSU2Session::Resend (uint64_t ts)
 	{
+		UpdateStats (); // called often enough
 		// resend handshake packet
 		if (m_SentHandshakePacket && ts >= m_SentHandshakePacket->sendTime + SSU2_HANDSHAKE_RESEND_INTERVAL)
 		{
@@ -557,41 +830,40 @@ namespace transport
 			return 0;
 		}
 		// resend data packets
-		if (m_SentPackets.empty ()) return 0;
-		std::map<uint32_t, std::shared_ptr<SSU2SentPacket> > resentPackets;
-		for (auto it = m_SentPackets.begin (); it != m_SentPackets.end (); )
-			if (ts >= it->second->sendTime + (it->second->numResends + 1) * m_RTO)
+		if (m_SentPackets.IsEmpty ()) return 0;
+		std::vector<std::pair<uint32_t, SSU2SentPacket *> > resentPackets;
+		for (auto packetNum = m_SentPackets.GetFirstPacketNum (); packetNum < m_SentPackets.GetEndPacketNum (); packetNum++)
+		{
+			auto packet = m_SentPackets.Get (packetNum);
+			if (packet && ts >= packet->sendTime + (packet->numResends + 1) * m_RTO)
 			{
-				if (it->second->numResends > SSU2_MAX_NUM_RESENDS)
+				if (packet->numResends > SSU2_MAX_NUM_RESENDS)
 				{
-					LogPrint (eLogInfo, "SSU2: Packet was not Acked after ", it->second->numResends, " attempts. Terminate session");
-					m_SentPackets.clear ();
-					m_SendQueue.clear ();
+					LogPrint (eLogInfo, "SSU2: Packet was not Acked after ", packet->numResends, " attempts. Terminate session");
+					for (auto& it: resentPackets)
+						m_SentPackets.Release (it.second);
+					m_SentPackets.Clear ();
+					m_SendQueue.DropAll ();
 					SetSendQueueSize (0);
 					RequestTermination (eSSU2TerminationReasonTimeout);
 					return resentPackets.size ();
 				}
 				else
 				{
-					uint32_t packetNum = SendData (it->second->payload, it->second->payloadSize);
-					it->second->numResends++;
-					it->second->sendTime = ts;
-					resentPackets.emplace (packetNum, it->second);
-					it = m_SentPackets.erase (it);
+					uint32_t newPacketNum = SendData (packet->payload, packet->payloadSize);
+					packet->numResends++;
+					packet->sendTime = ts;
+					resentPackets.emplace_back (newPacketNum, m_SentPackets.Extract (packetNum));
 				}
 			}
-			else
-				it++;
+		}
 		if (!resentPackets.empty ())
 		{
 			m_LastResendTime = ts;
-#if (__cplusplus >= 201703L) // C++ 17 or higher
-			m_SentPackets.merge (resentPackets);
-#else
-			m_SentPackets.insert (resentPackets.begin (), resentPackets.end ());
-#endif
-			m_WindowSize >>= 1; // /2
-			if (m_WindowSize < SSU2_MIN_WINDOW_SIZE) m_WindowSize = SSU2_MIN_WINDOW_SIZE;
+			for (auto& it: resentPackets) // new packet nums are greater than any sent before
+				m_SentPackets.Insert (it.first, it.second);
+			m_NumLostPackets += resentPackets.size ();
+			m_CongestionControl->OnPacketsLost (resentPackets.size (), ts);
 			return resentPackets.size ();
 		}
 		return 0;
@@ -1536,12 +1808,7 @@ namespace transport
 				ResendHandshakePacket (); // assume we receive
 			return;
 		}
-		if (from != m_RemoteEndpoint && !i2p::transport::transports.IsInReservedRange (from.address ()))
-		{
-			LogPrint (eLogInfo, "SSU2: Remote endpoint update ", m_RemoteEndpoint, "->", from);
-			m_RemoteEndpoint = from;
-			SendPathChallenge ();
-		}
+		UpdateRemoteEndpoint (from);
 		if (len < 32)
 		{
 			LogPrint (eLogWarning, "SSU2: Data message too short ", len);
@@ -1563,6 +1830,40 @@ namespace transport
 			HandlePayload (payload, payloadSize);
 	}
 
+	bool SSU2Session::PrepareDataDecryption (uint8_t * buf, size_t len, uint8_t * nonce, i2p::crypto::AEADChaCha20Poly1305Message& msg)
+	{
+		if (len < 32) return false;
+		Header header;
+		header.ll[0] = m_SourceConnID;
+		memcpy (header.buf + 8, buf + 8, 8);
+		header.ll[1] ^= CreateHeaderMask (m_KeyDataReceive + 32, buf + (len - 12));
+		if (header.h.type != eSSU2Data) return false; // ProcessData handles it
+		memcpy (buf, header.buf, 16);
+		CreateNonce (be32toh (header.h.packetNum), nonce);
+		size_t payloadSize = len - 32;
+		msg = { buf + 16, payloadSize, buf, 16, m_KeyDataReceive, nonce, buf + 16, payloadSize, false };
+		return true;
+	}
+
+	void SSU2Session::ProcessDecryptedData (const uint8_t * buf, size_t len, const boost::asio::ip::udp::endpoint& from)
+	{
+		UpdateRemoteEndpoint (from);
+		UpdateNumReceivedBytes (len);
+		uint32_t packetNum = bufbe32toh (buf + 8);
+		if (!packetNum || UpdateReceivePacketNum (packetNum))
+			HandlePayload (buf + 16, len - 32);
+	}
+
+	void SSU2Session::UpdateRemoteEndpoint (const boost::asio::ip::udp::endpoint& from)
+	{
+		if (from != m_RemoteEndpoint && !i2p::transport::transports.IsInReservedRange (from.address ()))
+		{
+			LogPrint (eLogInfo, "SSU2: Remote endpoint update ", m_RemoteEndpoint, "->", from);
+			m_RemoteEndpoint = from;
+			SendPathChallenge ();
+		}
+	}
+
 	void SSU2Session::HandlePayload (const uint8_t * buf, size_t len)
 	{
 		size_t offset = 0;
@@ -1783,12 +2084,13 @@ namespace transport
 			Established ();
 			return;
 		}
-		if (m_SentPackets.empty ()) return;
+		if (m_SentPackets.IsEmpty ()) return;
 		if (len < 5) return;
 		// acnt
 		uint32_t ackThrough = bufbe32toh (buf);
 		uint32_t firstPacketNum = ackThrough > buf[4] ? ackThrough - buf[4] : 0;
-		HandleAckRange (firstPacketNum, ackThrough, i2p::util::GetMillisecondsSinceEpoch ()); // acnt
+		auto ts = i2p::util::GetMillisecondsSinceEpoch ();
+		size_t numAcked = HandleAckRange (firstPacketNum, ackThrough, ts); // acnt
 		// ranges
 		len -= 5;
 		const uint8_t * ranges = buf + 5;
@@ -1800,25 +2102,27 @@ namespace transport
 			if (*ranges > lastPacketNum + 1) break;
 			firstPacketNum = lastPacketNum - *ranges + 1; ranges++; // acks
 			len -= 2;
-			HandleAckRange (firstPacketNum, lastPacketNum, 0);
+			numAcked += HandleAckRange (firstPacketNum, lastPacketNum, 0);
 		}
+		if (numAcked > 0)
+			m_CongestionControl->OnPacketsAcked (numAcked, ts);
 	}
 
-	void SSU2Session::HandleAckRange (uint32_t firstPacketNum, uint32_t lastPacketNum, uint64_t ts)
+	size_t SSU2Session::HandleAckRange (uint32_t firstPacketNum, uint32_t lastPacketNum, uint64_t ts)
 	{
-		if (firstPacketNum > lastPacketNum) return;
-		auto it = m_SentPackets.begin ();
-		while (it != m_SentPackets.end () && it->first < firstPacketNum) it++; // find first acked packet
-		if (it == m_SentPackets.end () || it->first > lastPacketNum) return; // not found
-		auto it1 = it;
-		int numPackets = 0;
-		while (it1 != m_SentPackets.end () && it1->first <= lastPacketNum)
+		if (firstPacketNum > lastPacketNum || m_SentPackets.IsEmpty ()) return 0;
+		if (firstPacketNum < m_SentPackets.GetFirstPacketNum ()) firstPacketNum = m_SentPackets.GetFirstPacketNum ();
+		if (lastPacketNum >= m_SentPackets.GetEndPacketNum ()) lastPacketNum = m_SentPackets.GetEndPacketNum () - 1;
+		size_t numPackets = 0;
+		for (auto packetNum = firstPacketNum; packetNum <= lastPacketNum && packetNum < m_SentPackets.GetEndPacketNum (); packetNum++)
 		{
-			if (ts && !it1->second->numResends)
+			auto packet = m_SentPackets.Get (packetNum);
+			if (!packet) continue;
+			if (ts && !packet->numResends)
 			{
-				if (ts > it1->second->sendTime)
+				if (ts > packet->sendTime)
 				{
-					auto rtt = ts - it1->second->sendTime;
+					auto rtt = ts - packet->sendTime;
 					if (m_RTT != SSU2_UNKNOWN_RTT)
 						m_RTT = SSU2_RTT_EWMA_ALPHA * rtt + (1.0 - SSU2_RTT_EWMA_ALPHA) * m_RTT;
 					else
@@ -1830,18 +2134,14 @@ namespace transport
 					m_MsgLocalSemiExpirationTimeout = m_MsgLocalExpirationTimeout / 2;
 					if (m_RTO < SSU2_MIN_RTO) m_RTO = SSU2_MIN_RTO;
 					if (m_RTO > SSU2_MAX_RTO) m_RTO = SSU2_MAX_RTO;
+					m_CongestionControl->OnRTTSample (rtt, m_RTT, ts);
 				}
 				ts = 0; // update RTT one time per range
 			}
-			it1++;
+			m_SentPackets.Remove (packetNum);
 			numPackets++;
 		}
-		m_SentPackets.erase (it, it1);
-		if (numPackets > 0)
-		{
-			m_WindowSize += numPackets;
-			if (m_WindowSize > SSU2_MAX_WINDOW_SIZE) m_WindowSize = SSU2_MAX_WINDOW_SIZE;
-		}
+		return numPackets;
 	}
 
 	void SSU2Session::HandleAddress (const uint8_t * buf, size_t len)
@@ -2203,7 +2503,7 @@ namespace transport
 				if (session) // session with Charlie
 				{
 					session->m_PeerTests.emplace (nonce, std::make_pair (shared_from_this (), i2p::util::GetSecondsSinceEpoch ()));
-					auto packet = m_Server.GetSentPacketsPool ().AcquireShared ();
+					auto packet = session->m_SentPackets.Acquire ();
 					// Alice's RouterInfo
 					auto r = i2p::data::netdb.FindRouter (GetRemoteIdentity ()->GetIdentHash ());
 					if (r && (r->IsUnreachable () || !i2p::data::netdb.PopulateRouterInfoBuffer (r))) r = nullptr;
@@ -2215,8 +2515,8 @@ namespace transport
 						// doesn't fit one message, send RouterInfo in separate message
 						uint32_t packetNum = session->SendData (packet->payload, packet->payloadSize, SSU2_FLAG_IMMEDIATE_ACK_REQUESTED);
 						packet->sendTime = ts;
-						session->m_SentPackets.emplace (packetNum, packet);
-						packet = m_Server.GetSentPacketsPool ().AcquireShared (); // new packet
+						session->m_SentPackets.Insert (packetNum, packet);
+						packet = session->m_SentPackets.Acquire (); // new packet
 					}
 					// PeerTest to Charlie
 					packet->payloadSize += CreatePeerTestBlock (packet->payload + packet->payloadSize, m_MaxPayloadSize - packet->payloadSize, 2,
@@ -2224,7 +2524,7 @@ namespace transport
 					packet->payloadSize += CreatePaddingBlock (packet->payload + packet->payloadSize, m_MaxPayloadSize - packet->payloadSize);
 					uint32_t packetNum = session->SendData (packet->payload, packet->payloadSize, SSU2_FLAG_IMMEDIATE_ACK_REQUESTED);
 					packet->sendTime = ts;
-					session->m_SentPackets.emplace (packetNum, packet);
+					session->m_SentPackets.Insert (packetNum, packet);
 				}
 				else
 				{
@@ -2633,18 +2933,18 @@ namespace transport
 		int maxNumRanges = (len - 8) >> 1;
 		if (maxNumRanges > SSU2_MAX_NUM_ACK_RANGES) maxNumRanges = SSU2_MAX_NUM_ACK_RANGES;
 		buf[0] = eSSU2BlkAck;
-		uint32_t ackThrough = m_OutOfSequencePackets.empty () ? m_ReceivePacketNum : *m_OutOfSequencePackets.rbegin ();
+		uint32_t ackThrough = m_OutOfSequencePackets.IsEmpty () ? m_ReceivePacketNum : m_OutOfSequencePackets.GetLast ();
 		htobe32buf (buf + 3, ackThrough); // Ack Through
 		uint16_t acnt = 0;
 		int numRanges = 0;
 		if (ackThrough)
 		{
-			if (m_OutOfSequencePackets.empty ())
+			if (m_OutOfSequencePackets.IsEmpty ())
 				acnt = std::min ((int)ackThrough, SSU2_MAX_NUM_ACNT); // no gaps
 			else
 			{
-				auto it = m_OutOfSequencePackets.rbegin (); it++; // prev packet num
-				while (it != m_OutOfSequencePackets.rend () && *it == ackThrough - acnt	- 1)
+				auto it = m_OutOfSequencePackets.RBegin (); it++; // prev packet num
+				while (it != m_OutOfSequencePackets.REnd () && *it == ackThrough - acnt	- 1)
 				{
 					acnt++;
 					if (acnt >= SSU2_MAX_NUM_ACK_PACKETS)
@@ -2676,7 +2976,7 @@ namespace transport
 					}
 				}
 				int numPackets = acnt + numRanges*SSU2_MAX_NUM_ACNT;
-				while (it != m_OutOfSequencePackets.rend () &&
+				while (it != m_OutOfSequencePackets.REnd () &&
 					numRanges < maxNumRanges && numPackets < SSU2_MAX_NUM_ACK_PACKETS)
 				{
 					if (lastNum - (*it) > SSU2_MAX_NUM_ACNT)
@@ -2696,7 +2996,7 @@ namespace transport
 					numPackets += buf[8 + numRanges*2];
 					lastNum = *it; it++;
 					int numAcks = 1;
-					while (it != m_OutOfSequencePackets.rend () && lastNum > 0 && *it == lastNum - 1)
+					while (it != m_OutOfSequencePackets.REnd () && lastNum > 0 && *it == lastNum - 1)
 					{
 						numAcks++; lastNum--;
 						it++;
@@ -2716,11 +3016,11 @@ namespace transport
 					numPackets += numAcks;
 					numRanges++;
 				}
-				if (it == m_OutOfSequencePackets.rend () &&
+				if (it == m_OutOfSequencePackets.REnd () &&
 					numRanges < maxNumRanges && numPackets < SSU2_MAX_NUM_ACK_PACKETS)
 				{
 					// add range between out-of-sequence and received
-					int nacks = *m_OutOfSequencePackets.begin () - m_ReceivePacketNum - 1;
+					int nacks = m_OutOfSequencePackets.GetFirst () - m_ReceivePacketNum - 1;
 					if (nacks > 0)
 					{
 						if (nacks > SSU2_MAX_NUM_ACNT) nacks = SSU2_MAX_NUM_ACNT;
@@ -2952,30 +3252,22 @@ namespace transport
 		if (packetNum <= m_ReceivePacketNum) return false; // duplicate
 		if (packetNum == m_ReceivePacketNum + 1)
 		{
-			if (!m_OutOfSequencePackets.empty ())
+			if (!m_OutOfSequencePackets.IsEmpty () && m_OutOfSequencePackets.GetFirst () == packetNum + 1)
 			{
-				auto it = m_OutOfSequencePackets.begin ();
-				if (*it == packetNum + 1)
-				{
-					// first out of sequence packet is in sequence now
-					packetNum++; it++;
-					while (it != m_OutOfSequencePackets.end ())
-					{
-						if (*it == packetNum + 1)
-						{
-							packetNum++;
-							it++;
-						}
-						else // next out of sequence
-							break;
-					}
-					m_OutOfSequencePackets.erase (m_OutOfSequencePackets.begin (), it);
-				}
+				// first out of sequence packet is in sequence now
+				packetNum++;
+				while (m_OutOfSequencePackets.Contains (packetNum + 1)) packetNum++;
+				m_OutOfSequencePackets.EraseUntil (packetNum);
 			}
 			m_ReceivePacketNum = packetNum;
 		}
-		else
-			m_OutOfSequencePackets.insert (packetNum);
+		else if (!m_OutOfSequencePackets.Insert (packetNum))
+		{
+			// too far ahead, seems we have a serious network issue
+			LogPrint (eLogWarning, "SSU2: Out of sequence packet ", packetNum, " is too far from last received ", m_ReceivePacketNum);
+			m_ReceivePacketNum = packetNum;
+			m_OutOfSequencePackets.Clear ();
+		}
 		return true;
 	}
 
@@ -3040,6 +3332,15 @@ namespace transport
 		SendData (payload, len);
 	}
 
+	void SSU2Session::UpdateStats ()
+	{
+		m_Stats.windowSize.store (GetWindowSize (), std::memory_order_relaxed);
+		m_Stats.numSentPackets.store (m_SentPackets.GetSize (), std::memory_order_relaxed);
+		m_Stats.rto.store (m_RTO, std::memory_order_relaxed);
+		m_Stats.rtt.store (m_RTT >= 0 ? (int)m_RTT : -1, std::memory_order_relaxed);
+		m_Stats.numLostPackets.store (m_NumLostPackets, std::memory_order_relaxed);
+	}
+
 	void SSU2Session::CleanUp (uint64_t ts)
 	{
 		for (auto it = m_IncompleteMessages.begin (); it != m_IncompleteMessages.end ();)
@@ -3066,14 +3367,14 @@ namespace transport
 					++it;
 			}
 		}
-		if (!m_OutOfSequencePackets.empty ())
+		if (!m_OutOfSequencePackets.IsEmpty ())
 		{
 			int ranges = 0;
-			while (ranges < 8 && !m_OutOfSequencePackets.empty () &&
-				(m_OutOfSequencePackets.size () > 2*SSU2_MAX_NUM_ACK_RANGES ||
-			    *m_OutOfSequencePackets.rbegin () > m_ReceivePacketNum + SSU2_MAX_NUM_ACK_PACKETS))
+			while (ranges < 8 && !m_OutOfSequencePackets.IsEmpty () &&
+				(m_OutOfSequencePackets.GetSize () > 2*SSU2_MAX_NUM_ACK_RANGES ||
+			    m_OutOfSequencePackets.GetLast () > m_ReceivePacketNum + SSU2_MAX_NUM_ACK_PACKETS))
 			{
-				uint32_t packet = *m_OutOfSequencePackets.begin ();
+				uint32_t packet = m_OutOfSequencePackets.GetFirst ();
 				if (packet > m_ReceivePacketNum + 1)
 				{
 					// like we've just received all packets before first
@@ -3088,11 +3389,11 @@ namespace transport
 					break;
 				}
 			}
-			if (m_OutOfSequencePackets.size () > 255*4)
+			if (m_OutOfSequencePackets.GetSize () > 255*4)
 			{
 				// seems we have a serious network issue
-				m_ReceivePacketNum = *m_OutOfSequencePackets.rbegin ();
-				m_OutOfSequencePackets.clear ();
+				m_ReceivePacketNum = m_OutOfSequencePackets.GetLast ();
+				m_OutOfSequencePackets.Clear ();
 			}
 		}
 
@@ -3124,7 +3425,7 @@ namespace transport
 	{
 		bool sent = SendQueue (); // if we have something to send
 		if (sent)
-			SetSendQueueSize (m_SendQueue.size ());
+			SetSendQueueSize (m_SendQueue.GetSize ());
 		if (m_IsDataReceived)
 		{
 			if (!sent) SendQuickAck ();
@@ -14,11 +14,15 @@
 #include <map>
 #include <set>
 #include <list>
+#include <vector>
+#include <atomic>
 #include <boost/asio.hpp>
+#include "util.h"
 #include "Crypto.h"
 #include "RouterInfo.h"
 #include "RouterContext.h"
 #include "TransportSession.h"
+#include "SSU2CongestionControl.h"
 
 namespace i2p
 {
@@ -41,8 +45,6 @@ namespace transport
 	const int SSU2_MAX_NUM_RECEIVED_I2NP_MSGIDS = 5000; // how many msgID we store for duplicates check
 	const int SSU2_RECEIVED_I2NP_MSGIDS_CLEANUP_TIMEOUT = 10; // in seconds
 	const int SSU2_DECAY_INTERVAL = 20; // in seconds
-	const size_t SSU2_MIN_WINDOW_SIZE = 16; // in packets
-	const size_t SSU2_MAX_WINDOW_SIZE = 256; // in packets
 	const size_t SSU2_MIN_RTO = 100; // in milliseconds
 	const size_t SSU2_INITIAL_RTO = 540; // in milliseconds
 	const size_t SSU2_MAX_RTO = 2500; // in milliseconds
@@ -54,6 +56,9 @@ namespace transport
 	const int SSU2_MAX_NUM_ACK_RANGES = 32; // to send
 	const uint8_t SSU2_MAX_NUM_FRAGMENTS = 64;
 	const int SSU2_SEND_DATETIME_NUM_PACKETS = 256;
+	const int SSU2_PACING_MAX_BURST = 4; // in packets sent without waiting after idle
+	const size_t SSU2_MIN_SENT_PACKETS_RING_SIZE = 32; // must be power of 2
+	const uint32_t SSU2_MAX_NUM_OUT_OF_SEQUENCE_PACKETS = 8192; // ahead of receive packet num
 
 	// flags
 	const uint8_t SSU2_FLAG_IMMEDIATE_ACK_REQUESTED = 0x01;
@@ -198,6 +203,100 @@ namespace transport
 		int numResends = 0;
 	};
 
+	class SSU2SentPackets
+	{
+		// not acked packets in a ring indexed by packet number, from first not acked to last sent
+		public:
+
+			SSU2SentPackets (i2p::util::MemoryPool<SSU2SentPacket>& pool);
+			~SSU2SentPackets () { Clear (); };
+
+			SSU2SentPacket * Acquire () { return m_Pool.Acquire (); };
+			void Release (SSU2SentPacket * packet) { m_Pool.Release (packet); };
+
+			bool IsEmpty () const { return !m_Size; };
+			size_t GetSize () const { return m_Size; };
+			uint32_t GetFirstPacketNum () const { return m_FirstPacketNum; };
+			uint32_t GetEndPacketNum () const { return m_EndPacketNum; }; // last + 1
+			SSU2SentPacket * Get (uint32_t packetNum) const
+			{
+				if (packetNum < m_FirstPacketNum || packetNum >= m_EndPacketNum) return nullptr;
+				return m_Packets[packetNum & (m_Packets.size () - 1)];
+			}
+
+			void Insert (uint32_t packetNum, SSU2SentPacket * packet); // packetNum must be greater than any before
+			SSU2SentPacket * Extract (uint32_t packetNum); // caller owns it after
+			void Remove (uint32_t packetNum) { Release (Extract (packetNum)); };
+			void Clear ();
+
+		private:
+
+			void Resize (size_t size);
+
+		private:
+
+			i2p::util::MemoryPool<SSU2SentPacket>& m_Pool;
+			std::vector<SSU2SentPacket *> m_Packets; // size is power of 2
+			uint32_t m_FirstPacketNum, m_EndPacketNum;
+			size_t m_Size;
+	};
+
+	class SSU2OutOfSequencePackets
+	{
+		// bitmap of received packet numbers after a gap
+		public:
+
+			class ReverseIterator // from last to first
+			{
+				public:
+
+					ReverseIterator (const SSU2OutOfSequencePackets * packets, bool isEnd);
+					uint32_t operator* () const { return m_PacketNum; };
+					ReverseIterator& operator++ ();
+					ReverseIterator operator++ (int) { auto it = *this; ++(*this); return it; };
+					bool operator== (const ReverseIterator& other) const { return m_IsEnd == other.m_IsEnd && (m_IsEnd || m_PacketNum == other.m_PacketNum); };
+					bool operator!= (const ReverseIterator& other) const { return !(*this == other); };
+
+				private:
+
+					const SSU2OutOfSequencePackets * m_OutOfSequencePackets;
+					uint32_t m_PacketNum;
+					bool m_IsEnd;
+			};
+
+			SSU2OutOfSequencePackets (): m_Base (0), m_Size (0) {};
+
+			bool IsEmpty () const { return !m_Size; };
+			size_t GetSize () const { return m_Size; };
+			uint32_t GetFirst () const; // must be not empty
+			uint32_t GetLast () const; // must be not empty
+			bool Contains (uint32_t packetNum) const;
+			bool Insert (uint32_t packetNum); // false if too far ahead
+			void EraseUntil (uint32_t packetNum); // inclusive
+			void Clear ();
+			ReverseIterator RBegin () const { return ReverseIterator (this, IsEmpty ()); };
+			ReverseIterator REnd () const { return ReverseIterator (this, true); };
+
+		private:
+
+			bool FindPrev (uint32_t packetNum, uint32_t& prev) const; // highest less than packetNum
+
+		private:
+
+			std::vector<uint64_t> m_Bits;
+			uint32_t m_Base; // packet num of first bit, multiple of 64
+			size_t m_Size;
+	};
+
+	struct SSU2SessionStats // congestion control snapshot, written in session's thread, read by others
+	{
+		std::atomic<size_t> windowSize, numSentPackets, rto;
+		std::atomic<int> rtt; // in milliseconds, negative if unknown
+		std::atomic<uint64_t> numLostPackets;
+
+		SSU2SessionStats (): windowSize (0), numSentPackets (0), rto (0), rtt (-1), numLostPackets (0) {};
+	};
+
 	// RouterInfo flags
 	const uint8_t SSU2_ROUTER_INFO_FLAG_REQUEST_FLOOD = 0x01;
 	const uint8_t SSU2_ROUTER_INFO_FLAG_GZIP = 0x02;
@@ -263,6 +362,10 @@ namespace transport
 			uint64_t GetConnID () const { return m_SourceConnID; };
 			SSU2SessionState GetState () const { return m_State; };
 			void SetState (SSU2SessionState state) { m_State = state; };
+			// congestion control stats
+			const char * GetCongestionControlName () const { return m_CongestionControl->GetName (); };
+			size_t GetWindowSize () const { return m_CongestionControl->GetWindowSize (); };
+			const SSU2SessionStats& GetStats () const { return m_Stats; }; // thread safe
 
 			bool ProcessFirstIncomingMessage (uint64_t connID, uint8_t * buf, size_t len);
 			bool ProcessSessionCreated (uint8_t * buf, size_t len);
@@ -271,6 +374,9 @@ namespace transport
 			bool ProcessHolePunch (uint8_t * buf, size_t len);
 			bool ProcessPeerTest (uint8_t * buf, size_t len);
 			void ProcessData (uint8_t * buf, size_t len, const boost::asio::ip::udp::endpoint& from);
+			// batch decryption, header is decrypted in place, payload is decrypted in place with msg by caller
+			bool PrepareDataDecryption (uint8_t * buf, size_t len, uint8_t * nonce, i2p::crypto::AEADChaCha20Poly1305Message& msg);
+			void ProcessDecryptedData (const uint8_t * buf, size_t len, const boost::asio::ip::udp::endpoint& from);
 
 		private:
 
@@ -280,8 +386,13 @@ namespace transport
 			void HandleConnectTimer (const boost::system::error_code& ecode);
 			void PostI2NPMessages (std::vector<std::shared_ptr<I2NPMessage> > msgs);
 			bool SendQueue (); // returns true if ack block was sent
+			bool IsPacingAllowed (uint64_t mts) const;
+			void UpdatePacingTime (uint64_t mts, int numPackets);
+			void SchedulePacingTimer (uint64_t mts);
+			void HandlePacingTimer (const boost::system::error_code& ecode);
 			bool SendFragmentedMessage (std::shared_ptr<I2NPMessage> msg);
 			void ResendHandshakePacket ();
+			void UpdateStats ();
 			void ConnectAfterIntroduction ();
 
 			void ProcessSessionRequest (Header& header, uint8_t * buf, size_t len);
@@ -300,12 +411,13 @@ namespace transport
 			void SendPeerTest (uint8_t msg, const uint8_t * signedData, size_t signedDataLen, const uint8_t * introKey); // PeerTest message
 			void SendPathResponse (const uint8_t * data, size_t len);
 			void SendPathChallenge ();
+			void UpdateRemoteEndpoint (const boost::asio::ip::udp::endpoint& from);
 
 			void HandlePayload (const uint8_t * buf, size_t len);
 			void HandleDateTime (const uint8_t * buf, size_t len);
 			void HandleRouterInfo (const uint8_t * buf, size_t len);
 			void HandleAck (const uint8_t * buf, size_t len);
-			void HandleAckRange (uint32_t firstPacketNum, uint32_t lastPacketNum, uint64_t ts);
+			size_t HandleAckRange (uint32_t firstPacketNum, uint32_t lastPacketNum, uint64_t ts); // returns number of acked packets
 			void HandleAddress (const uint8_t * buf, size_t len);
 			bool ExtractEndpoint (const uint8_t * buf, size_t size, boost::asio::ip::udp::endpoint& ep);
 			size_t CreateEndpoint (uint8_t * buf, size_t len, const boost::asio::ip::udp::endpoint& ep);
@@ -354,18 +466,24 @@ namespace transport
 			SSU2SessionState m_State;
 			uint8_t m_KeyDataSend[64], m_KeyDataReceive[64];
 			uint32_t m_SendPacketNum, m_ReceivePacketNum, m_LastDatetimeSentPacketNum;
-			std::set<uint32_t> m_OutOfSequencePackets; // packet nums > receive packet num
-			std::map<uint32_t, std::shared_ptr<SSU2SentPacket> > m_SentPackets; // packetNum -> packet
+			SSU2OutOfSequencePackets m_OutOfSequencePackets; // packet nums > receive packet num
+			SSU2SentPackets m_SentPackets; // packetNum -> packet
 			std::unordered_map<uint32_t, std::shared_ptr<SSU2IncompleteMessage> > m_IncompleteMessages; // msgID -> I2NP
 			std::map<uint32_t, std::pair <std::shared_ptr<SSU2Session>, uint64_t > > m_RelaySessions; // nonce->(Alice, timestamp) for Bob or nonce->(Charlie, timestamp) for Alice
 			std::map<uint32_t, std::pair <std::shared_ptr<SSU2Session>, uint64_t > > m_PeerTests; // same as for relay sessions
-			std::list<std::shared_ptr<I2NPMessage> > m_SendQueue;
+			TransportSendQueue m_SendQueue;
 			i2p::I2NPMessagesHandler m_Handler;
 			bool m_IsDataReceived;
 			double m_RTT;
 			int m_MsgLocalExpirationTimeout;
 			int m_MsgLocalSemiExpirationTimeout;
-			size_t m_WindowSize, m_RTO;
+			size_t m_RTO;
+			std::unique_ptr<SSU2CongestionControl> m_CongestionControl;
+			uint64_t m_NumLostPackets;
+			SSU2SessionStats m_Stats;
+			uint64_t m_NextPacingTime; // in microseconds
+			boost::asio::deadline_timer m_PacingTimer;
+			bool m_IsPacingTimerScheduled;
 			uint32_t m_RelayTag; // between Bob and Charlie
 			OnEstablished m_OnEstablished; // callback from Established
 			boost::asio::deadline_timer m_ConnectTimer;
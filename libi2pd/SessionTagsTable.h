@@ -0,0 +1,164 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#ifndef SESSION_TAGS_TABLE_H__
+#define SESSION_TAGS_TABLE_H__
+
+#include <inttypes.h>
+#include <vector>
+#include <random>
+#include <utility>
+
+namespace i2p
+{
+namespace garlic
+{
+	// flat open addressing table of 64 bits session tags, not thread safe
+	// linear probing over contiguous array of tags, deletion by backward shift without tombstones.
+	// Tag 0 is reserved for empty slot
+	template<typename Value>
+	class SessionTagsTable
+	{
+		static const size_t MIN_CAPACITY = 16; // power of 2
+		static const uint64_t HASH_MULTIPLIER = 0x9E3779B97F4A7C15ULL; // golden ratio
+
+		public:
+
+			SessionTagsTable (): m_Size (0), m_Bits (0)
+			{
+				std::random_device rd;
+				m_Seed = ((uint64_t)rd () << 32) | rd (); // tags might come from peers
+				Rehash (MIN_CAPACITY);
+			}
+
+			size_t GetSize () const { return m_Size; };
+			bool IsEmpty () const { return !m_Size; };
+			size_t GetCapacity () const { return m_Tags.size (); };
+			size_t GetMemoryUsage () const { return m_Tags.size ()*(sizeof (uint64_t) + sizeof (Value)); }; // in bytes
+
+			bool Insert (uint64_t tag, const Value& value) // false if tag is 0 or exists already
+			{
+				if (!tag) return false;
+				if ((m_Size + 1)*8 > m_Tags.size ()*7) Rehash (m_Tags.size ()*2); // load factor 7/8
+				size_t mask = m_Tags.size () - 1;
+				for (size_t i = GetHome (tag);; i = (i + 1) & mask)
+				{
+					if (!m_Tags[i])
+					{
+						m_Tags[i] = tag;
+						m_Values[i] = value;
+						m_Size++;
+						return true;
+					}
+					if (m_Tags[i] == tag) return false;
+				}
+			}
+
+			Value * Find (uint64_t tag) // nullptr if not found, valid until next Insert or Erase
+			{
+				auto i = FindSlot (tag);
+				return i < m_Tags.size () ? &m_Values[i] : nullptr;
+			}
+
+			bool Erase (uint64_t tag)
+			{
+				auto i = FindSlot (tag);
+				if (i >= m_Tags.size ()) return false;
+				EraseSlot (i);
+				return true;
+			}
+
+			template<typename Predicate>
+			size_t EraseIf (Predicate pred) // pred (tag, value), might be called twice for remaining tags
+			{
+				size_t numErased = 0;
+				for (size_t i = 0; i < m_Tags.size (); i++)
+					while (m_Tags[i] && pred (m_Tags[i], m_Values[i]))
+					{
+						EraseSlot (i); // next tag of cluster might be moved to i
+						numErased++;
+					}
+				if (m_Tags.size () > MIN_CAPACITY && m_Size*8 < m_Tags.size ())
+				{
+					// shrink after sessions are gone
+					auto capacity = m_Tags.size ();
+					while (capacity > MIN_CAPACITY && m_Size*8 < capacity) capacity /= 2;
+					Rehash (capacity);
+				}
+				return numErased;
+			}
+
+			void Clear ()
+			{
+				m_Tags.clear ();
+				m_Values.clear ();
+				Rehash (MIN_CAPACITY);
+			}
+
+		private:
+
+			size_t GetHome (uint64_t tag) const
+			{
+				return ((tag ^ m_Seed)*HASH_MULTIPLIER) >> (64 - m_Bits);
+			}
+
+			size_t FindSlot (uint64_t tag) const // size of table if not found
+			{
+				if (!tag) return m_Tags.size ();
+				size_t mask = m_Tags.size () - 1;
+				for (size_t i = GetHome (tag);; i = (i + 1) & mask)
+				{
+					if (m_Tags[i] == tag) return i;
+					if (!m_Tags[i]) return m_Tags.size ();
+				}
+			}
+
+			void EraseSlot (size_t i)
+			{
+				// move following tags of cluster back if their home is not between hole and them
+				size_t mask = m_Tags.size () - 1;
+				for (size_t j = (i + 1) & mask; m_Tags[j]; j = (j + 1) & mask)
+				{
+					auto home = GetHome (m_Tags[j]);
+					if (((j - home) & mask) >= ((j - i) & mask))
+					{
+						m_Tags[i] = m_Tags[j];
+						m_Values[i] = std::move (m_Values[j]);
+						i = j;
+					}
+				}
+				m_Tags[i] = 0;
+				m_Values[i] = Value ();
+				m_Size--;
+			}
+
+			void Rehash (size_t capacity)
+			{
+				std::vector<uint64_t> tags (capacity, 0);
+				std::vector<Value> values (capacity);
+				std::swap (tags, m_Tags);
+				std::swap (values, m_Values);
+				m_Bits = 0;
+				while (((size_t)1 << m_Bits) < capacity) m_Bits++;
+				m_Size = 0;
+				for (size_t i = 0; i < tags.size (); i++)
+					if (tags[i]) Insert (tags[i], std::move (values[i]));
+			}
+
+		private:
+
+			std::vector<uint64_t> m_Tags; // 8 tags per cache line
+			std::vector<Value> m_Values;
+			size_t m_Size;
+			int m_Bits; // capacity is 2^bits
+			uint64_t m_Seed;
+	};
+}
+}
+
+#endif
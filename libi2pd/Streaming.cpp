@@ -66,12 +66,134 @@ namespace stream
 		}
 	}
 
+	bool PacketsRing::Insert (Packet * packet)
+	{
+		if (!packet) return false;
+		uint32_t seqn = packet->GetSeqn ();
+		if (!m_Size)
+		{
+			m_FirstSeqn = seqn;
+			m_EndSeqn = seqn + 1;
+		}
+		else
+		{
+			if (Get (seqn)) return false;
+			auto firstSeqn = std::min (m_FirstSeqn, seqn), endSeqn = std::max (m_EndSeqn, seqn + 1);
+			size_t numSlots = endSeqn - firstSeqn;
+			if (numSlots > m_Packets.size ())
+			{
+				size_t size = m_Packets.size ();
+				while (size < numSlots) size <<= 1;
+				Resize (size);
+			}
+			m_FirstSeqn = firstSeqn;
+			m_EndSeqn = endSeqn;
+		}
+		m_Packets[seqn & (m_Packets.size () - 1)] = packet;
+		m_Size++;
+		return true;
+	}
+
+	Packet * PacketsRing::Extract (uint32_t seqn)
+	{
+		auto packet = Get (seqn);
+		if (!packet) return nullptr;
+		size_t mask = m_Packets.size () - 1;
+		m_Packets[seqn & mask] = nullptr;
+		m_Size--;
+		if (!m_Size)
+			m_FirstSeqn = m_EndSeqn;
+		else if (seqn == m_FirstSeqn)
+		{
+			do m_FirstSeqn++;
+			while (!m_Packets[m_FirstSeqn & mask]);
+		}
+		else if (seqn == m_EndSeqn - 1)
+		{
+			do m_EndSeqn--;
+			while (!m_Packets[(m_EndSeqn - 1) & mask]);
+		}
+		return packet;
+	}
+
+	void PacketsRing::Clear ()
+	{
+		std::vector<Packet *>(MIN_PACKETS_RING_SIZE, nullptr).swap (m_Packets);
+		m_FirstSeqn = m_EndSeqn;
+		m_Size = 0;
+	}
+
+	void PacketsRing::Resize (size_t size)
+	{
+		std::vector<Packet *> packets (size, nullptr);
+		size_t mask = m_Packets.size () - 1, newMask = size - 1;
+		for (auto seqn = m_FirstSeqn; seqn < m_EndSeqn; seqn++)
+			packets[seqn & newMask] = m_Packets[seqn & mask];
+		m_Packets.swap (packets);
+	}
+
+	size_t SentPacketsScoreboard::DetectLosses (uint64_t ts, int rtt)
+	{
+		if (!m_RackSendTime) return 0; // nothing delivered yet
+		size_t numLost = 0;
+		uint64_t timeout = rtt + rtt/RACK_REORDERING_WINDOW_FRACTION;
+		for (auto seqn = GetFirstSeqn (); seqn < GetEndSeqn (); seqn++)
+		{
+			auto packet = Get (seqn);
+			if (!packet || packet->isLost) continue;
+			// sent before delivered packet and not acked in time
+			if ((packet->sendTime < m_RackSendTime || (packet->sendTime == m_RackSendTime && seqn < m_RackSeqn)) &&
+				ts >= packet->sendTime + timeout)
+			{
+				MarkLost (packet);
+				numLost++;
+			}
+		}
+		return numLost;
+	}
+
+	Packet * SentPacketsScoreboard::GetFirstLost () const
+	{
+		if (!m_NumLost) return nullptr;
+		for (auto seqn = GetFirstSeqn (); seqn < GetEndSeqn (); seqn++)
+		{
+			auto packet = Get (seqn);
+			if (packet && packet->isLost) return packet;
+		}
+		return nullptr;
+	}
+
+	void SentPacketsScoreboard::MarkLost (Packet * packet)
+	{
+		if (packet->isLost) return;
+		packet->isLost = true;
+		m_NumLost++;
+	}
+
+	void SentPacketsScoreboard::ClearLost (Packet * packet)
+	{
+		if (packet->isLost)
+		{
+			packet->isLost = false;
+			m_NumLost--;
+		}
+		packet->numNACKs = 0;
+	}
+
+	void SentPacketsScoreboard::Clear ()
+	{
+		PacketsRing::Clear ();
+		m_NumLost = 0;
+		m_RackSendTime = 0;
+		m_RackSeqn = 0;
+	}
+
 	Stream::Stream (boost::asio::io_service& service, StreamingDestination& local,
 		std::shared_ptr<const i2p::data::LeaseSet> remote, int port): m_Service (service),
 		m_SendStreamID (0), m_SequenceNumber (0),
 		m_TunnelsChangeSequenceNumber (0), m_LastReceivedSequenceNumber (-1), m_PreviousReceivedSequenceNumber (-1),
 		m_Status (eStreamStatusNew), m_IsAckSendScheduled (false), m_IsNAcked (false), m_IsSendTime (true), m_IsWinDropped (true),
-		m_IsTimeOutResend (false), m_LocalDestination (local),
+		m_IsTimeOutResend (false), m_IsInRecovery (false), m_RecoverySeqn (0), m_LocalDestination (local),
 		m_RemoteLeaseSet (remote), m_ReceiveTimer (m_Service), m_SendTimer (m_Service), m_ResendTimer (m_Service),
 		m_AckSendTimer (m_Service), m_NumSentBytes (0), m_NumReceivedBytes (0), m_Port (port),
 		m_RTT (INITIAL_RTT), m_WindowSize (INITIAL_WINDOW_SIZE), m_RTO (INITIAL_RTO),
@@ -90,7 +212,7 @@ namespace stream
 		m_Service (service), m_SendStreamID (0), m_SequenceNumber (0),
 		m_TunnelsChangeSequenceNumber (0), m_LastReceivedSequenceNumber (-1), m_PreviousReceivedSequenceNumber (-1),
 		m_Status (eStreamStatusNew), m_IsAckSendScheduled (false), m_IsNAcked (false), m_IsSendTime (true), m_IsWinDropped (true),
-		m_IsTimeOutResend (false), m_LocalDestination (local),
+		m_IsTimeOutResend (false), m_IsInRecovery (false), m_RecoverySeqn (0), m_LocalDestination (local),
 		m_ReceiveTimer (m_Service), m_SendTimer (m_Service), m_ResendTimer (m_Service), m_AckSendTimer (m_Service),
 		m_NumSentBytes (0), m_NumReceivedBytes (0), m_Port (0), m_RTT (INITIAL_RTT),
 		m_WindowSize (INITIAL_WINDOW_SIZE), m_RTO (INITIAL_RTO), m_AckDelay (local.GetOwner ()->GetStreamingAckDelay ()),
@@ -131,13 +253,13 @@ namespace stream
 			m_LocalDestination.DeletePacket (packet);
 		}
 
-		for (auto it: m_SentPackets)
-			m_LocalDestination.DeletePacket (it);
-		m_SentPackets.clear ();
+		while (!m_SentPackets.IsEmpty ())
+			m_LocalDestination.DeletePacket (m_SentPackets.Extract (m_SentPackets.GetFirstSeqn ()));
+		m_SentPackets.Clear ();
 
-		for (auto it: m_SavedPackets)
-			m_LocalDestination.DeletePacket (it);
-		m_SavedPackets.clear ();
+		while (!m_SavedPackets.IsEmpty ())
+			m_LocalDestination.DeletePacket (m_SavedPackets.Extract (m_SavedPackets.GetFirstSeqn ()));
+		m_SavedPackets.Clear ();
 	}
 
 	void Stream::HandleNextPacket (Packet * packet)
@@ -180,18 +302,10 @@ namespace stream
 			if (m_Status == eStreamStatusTerminated) return;
 			
 			// we should also try stored messages if any
-			for (auto it = m_SavedPackets.begin (); it != m_SavedPackets.end ();)
+			while (auto savedPacket = m_SavedPackets.Extract (m_LastReceivedSequenceNumber + 1))
 			{
-				if ((*it)->GetSeqn () == (uint32_t)(m_LastReceivedSequenceNumber + 1))
-				{
-					Packet * savedPacket = *it;
-					m_SavedPackets.erase (it++);
-
-					ProcessPacket (savedPacket);
-					if (m_Status == eStreamStatusTerminated) return;
-				}
-				else
-					break;
+				ProcessPacket (savedPacket);
+				if (m_Status == eStreamStatusTerminated) return;
 			}
 
 			// schedule ack for last message
@@ -233,7 +347,7 @@ namespace stream
 					if (!m_IsAckSendScheduled)
 					{	
 						// send NACKs for missing messages 
-						int ackTimeout = MIN_SEND_ACK_TIMEOUT*m_SavedPackets.size ();
+						int ackTimeout = MIN_SEND_ACK_TIMEOUT*m_SavedPackets.GetSize ();
 						if (ackTimeout > m_AckDelay) ackTimeout = m_AckDelay;
 						ScheduleAck (ackTimeout);
 					}	
@@ -247,7 +361,12 @@ namespace stream
 
 	void Stream::SavePacket (Packet * packet)
 	{
-		if (!m_SavedPackets.insert (packet).second)
+		if (packet->GetSeqn () - (uint32_t)(m_LastReceivedSequenceNumber + 1) >= MAX_SAVED_PACKETS_SPAN)
+		{
+			LogPrint (eLogWarning, "Streaming: Packet ", packet->GetSeqn (), " is too far ahead of ", m_LastReceivedSequenceNumber, ", dropped");
+			m_LocalDestination.DeletePacket (packet);
+		}
+		else if (!m_SavedPackets.Insert (packet))
 			m_LocalDestination.DeletePacket (packet);
 	}
 
@@ -427,31 +546,11 @@ namespace stream
 		}
 		int rttSample = INT_MAX;
 		bool firstRttSample = false;
-		m_IsNAcked = false;
-		int nackCount = packet->GetNACKCount ();
-		for (auto it = m_SentPackets.begin (); it != m_SentPackets.end ();)
-		{
-			auto seqn = (*it)->GetSeqn ();
-			if (seqn <= ackThrough)
+		m_IsNAcked = packet->GetNACKCount () > 0;
+		auto numAcked = m_SentPackets.ProcessAck (*packet,
+			[this, ts, &rttSample, &firstRttSample](Packet * sentPacket)
 			{
-				if (nackCount > 0)
-				{
-					bool nacked = false;
-					for (int i = 0; i < nackCount; i++)
-						if (seqn == packet->GetNACK (i))
-						{
-							m_IsNAcked = true;
-							nacked = true;
-							break;
-						}
-					if (nacked)
-					{
-						LogPrint (eLogDebug, "Streaming: Packet ", seqn, " NACK");
-						++it;
-						continue;
-					}
-				}
-				auto sentPacket = *it;
+				auto seqn = sentPacket->GetSeqn ();
 				int64_t rtt = (int64_t)ts - (int64_t)sentPacket->sendTime;
 				if (rtt < 0)
 					LogPrint (eLogError, "Streaming: Packet ", seqn, "sent from the future, sendTime=", sentPacket->sendTime);
@@ -463,14 +562,13 @@ namespace stream
 				else if (!sentPacket->resent && seqn > m_TunnelsChangeSequenceNumber && rtt >= 0)
 					rttSample = std::min (rttSample, (int)rtt);
 				LogPrint (eLogDebug, "Streaming: Packet ", seqn, " acknowledged rtt=", rtt, " sentTime=", sentPacket->sendTime);
-				m_SentPackets.erase (it++);
 				m_LocalDestination.DeletePacket (sentPacket);
-				acknowledged = true;
-				if (m_WindowSize < MAX_WINDOW_SIZE)
-					m_WindowSize++;
-			}
-			else
-				break;
+			});
+		if (numAcked > 0)
+		{
+			acknowledged = true;
+			if (!m_IsInRecovery) // don't grow window until lost packets are delivered
+				m_WindowSize = std::min (m_WindowSize + (int)numAcked, MAX_WINDOW_SIZE);
 		}
 		if (rttSample != INT_MAX)
 		{
@@ -508,20 +606,27 @@ namespace stream
 			if (wasInitial)
 				ScheduleResend ();
 		}
-		if (m_WindowSize > int(m_SentPackets.size ()))
+		auto numLost = m_SentPackets.DetectLosses (ts, m_RTT);
+		if (numLost)
+			LogPrint (eLogDebug, "Streaming: ", numLost, " packets lost, sSID=", m_SendStreamID);
+		if (m_IsInRecovery && (m_SentPackets.IsEmpty () || m_SentPackets.GetFirstSeqn () >= m_RecoverySeqn))
+			m_IsInRecovery = false; // all packets sent before loss are acked
+		if (m_SentPackets.GetNumLost ())
+			m_IsNAcked = true; // fast retransmit
+		if (m_WindowSize > int(m_SentPackets.GetSize ()))
 			m_IsWinDropped = false;
 		if (acknowledged || m_IsNAcked)
 		{
 			ScheduleResend ();
 		}
-		if ((m_SendBuffer.IsEmpty () && m_SentPackets.size () > 0) // tail loss
-			|| int(m_SentPackets.size ()) > m_WindowSize) // or we drop window
+		if ((m_SendBuffer.IsEmpty () && m_SentPackets.GetSize () > 0) // tail loss
+			|| int(m_SentPackets.GetSize ()) > m_WindowSize) // or we drop window
 			m_IsNAcked = true;
 		if (firstRttSample && m_RoutingSession)
 			m_RoutingSession->SetSharedRoutingPath (
 				std::make_shared<i2p::garlic::GarlicRoutingPath> (
 					i2p::garlic::GarlicRoutingPath{m_CurrentOutboundTunnel, m_CurrentRemoteLease, (int)m_RTT, 0, 0}));
-		if (m_SentPackets.empty () && m_SendBuffer.IsEmpty ())
+		if (m_SentPackets.IsEmpty () && m_SendBuffer.IsEmpty ())
 		{
 			m_ResendTimer.cancel ();
 			m_SendTimer.cancel ();
@@ -604,7 +709,7 @@ namespace stream
 	void Stream::SendBuffer ()
 	{
 		ScheduleSend ();
-		int numMsgs = m_WindowSize - m_SentPackets.size ();
+		int numMsgs = m_WindowSize - m_SentPackets.GetSize ();
 		if (numMsgs <= 0 || !m_IsSendTime) return; // window is full
 		else numMsgs = 1;
 		bool isNoAck = m_LastReceivedSequenceNumber < 0; // first packet
@@ -694,17 +799,17 @@ namespace stream
 		}
 		if (packets.size () > 0)
 		{
-			if (m_SavedPackets.empty ()) // no NACKS
+			if (m_SavedPackets.IsEmpty ()) // no NACKS
 			{
 				m_IsAckSendScheduled = false;
 				m_AckSendTimer.cancel ();
 			}
-			bool isEmpty = m_SentPackets.empty ();
+			bool isEmpty = m_SentPackets.IsEmpty ();
 			auto ts = i2p::util::GetMillisecondsSinceEpoch ();
 			for (auto& it: packets)
 			{
 				it->sendTime = ts;
-				m_SentPackets.insert (it);
+				m_SentPackets.Insert (it);
 			}
 			SendPackets (packets);
 			m_IsSendTime = false;
@@ -718,9 +823,9 @@ namespace stream
 	void Stream::SendQuickAck ()
 	{
 		int32_t lastReceivedSeqn = m_LastReceivedSequenceNumber;
-		if (!m_SavedPackets.empty ())
+		if (!m_SavedPackets.IsEmpty ())
 		{
-			int32_t seqn = (*m_SavedPackets.rbegin ())->GetSeqn ();
+			int32_t seqn = m_SavedPackets.GetEndSeqn () - 1;
 			if (seqn > lastReceivedSeqn) lastReceivedSeqn = seqn;
 		}
 		if (lastReceivedSeqn < 0)
@@ -746,24 +851,27 @@ namespace stream
 		{
 			// fill NACKs
 			uint8_t * nacks = packet + size + 1;
-			auto nextSeqn = m_LastReceivedSequenceNumber + 1;
-			for (auto it: m_SavedPackets)
+			int32_t lastSavedSeqn = m_LastReceivedSequenceNumber; // NACKs before it are complete
+			uint8_t numCompleteNacks = 0;
+			for (int32_t seqn = m_LastReceivedSequenceNumber + 1; seqn < lastReceivedSeqn; seqn++)
 			{
-				auto seqn = it->GetSeqn ();
-				if (numNacks + (seqn - nextSeqn) >= 256)
+				if (m_SavedPackets.Get (seqn))
 				{
-					LogPrint (eLogError, "Streaming: Number of NACKs exceeds 256. seqn=", seqn, " nextSeqn=", nextSeqn);
-					htobe32buf (packet + 12, nextSeqn - 1); // change ack Through back
-					choking = true;
-					break;
+					lastSavedSeqn = seqn;
+					numCompleteNacks = numNacks;
+					continue;
 				}
-				for (uint32_t i = nextSeqn; i < seqn; i++)
+				if (numNacks == 255)
 				{
-					htobe32buf (nacks, i);
-					nacks += 4;
-					numNacks++;
+					LogPrint (eLogError, "Streaming: Number of NACKs exceeds 256. seqn=", seqn, " nextSeqn=", lastSavedSeqn + 1);
+					htobe32buf (packet + 12, lastSavedSeqn); // change ack Through back
+					numNacks = numCompleteNacks;
+					choking = true;
+					break;
 				}
-				nextSeqn = seqn + 1;
+				htobe32buf (nacks, seqn);
+				nacks += 4;
+				numNacks++;
 			}
 			packet[size] = numNacks;
 			size++; // NACK count
@@ -846,7 +954,7 @@ namespace stream
 				Terminate ();
 			break;
 			case eStreamStatusClosing:
-				if (m_SentPackets.empty () && m_SendBuffer.IsEmpty ()) // nothing to send
+				if (m_SentPackets.IsEmpty () && m_SendBuffer.IsEmpty ()) // nothing to send
 				{
 					m_Status = eStreamStatusClosed;
 					SendClose();
@@ -923,8 +1031,8 @@ namespace stream
 			}
 			if (!packet->sendTime) packet->sendTime = i2p::util::GetMillisecondsSinceEpoch ();
 			SendPackets (std::vector<Packet *> { packet });
-			bool isEmpty = m_SentPackets.empty ();
-			m_SentPackets.insert (packet);
+			bool isEmpty = m_SentPackets.IsEmpty ();
+			m_SentPackets.Insert (packet);
 			if (isEmpty)
 				ScheduleResend ();
 			return true;
@@ -1053,17 +1161,19 @@ namespace stream
 		if (ecode != boost::asio::error::operation_aborted)
 		{
 			m_IsSendTime = true;
-			if (m_IsNAcked) // || m_WindowSize < int(m_SentPackets.size ())) // resend one packet
+			if (m_SentPackets.DetectLosses (i2p::util::GetMillisecondsSinceEpoch (), m_RTT)) // no ack in time
+				m_IsNAcked = true;
+			if (m_IsNAcked) // || m_WindowSize < int(m_SentPackets.GetSize ())) // resend one packet
 				ResendPacket ();
 			// delay-based CC
-			else if (!m_IsWinDropped && int(m_SentPackets.size ()) == m_WindowSize) // we sending packets too fast, early detection
+			else if (!m_IsWinDropped && int(m_SentPackets.GetSize ()) == m_WindowSize) // we sending packets too fast, early detection
 			{
 				m_WindowSize >>= 1; // /2
 				m_IsWinDropped = true; // don't drop window twice
 				if (m_WindowSize < MIN_WINDOW_SIZE) m_WindowSize = MIN_WINDOW_SIZE;
 				UpdatePacingTime ();
 			}
-			else if (m_WindowSize > int(m_SentPackets.size ())) // send one packet
+			else if (m_WindowSize > int(m_SentPackets.GetSize ())) // send one packet
 				SendBuffer ();
 			else // pass
 				ScheduleSend ();
@@ -1092,6 +1202,7 @@ namespace stream
 			m_SendTimer.cancel (); // if no ack's in RTO, disable fast retransmit
 			m_IsTimeOutResend = true;
 			m_IsNAcked = false;
+			m_IsInRecovery = false;
 			ResendPacket (); // send one packet per RTO, waiting for ack
 		}
 	}
@@ -1107,37 +1218,43 @@ namespace stream
 				return;
 			}
 
-			// collect packets to resend
+			// lost packets first, then one not acked for RTO
 			auto ts = i2p::util::GetMillisecondsSinceEpoch ();
-			std::vector<Packet *> packets;
-			for (auto it : m_SentPackets)
+			auto packet = m_SentPackets.GetFirstLost ();
+			bool isLost = packet != nullptr;
+			for (auto seqn = m_SentPackets.GetFirstSeqn (); !packet && seqn < m_SentPackets.GetEndSeqn (); seqn++)
 			{
-				if (ts >= it->sendTime + m_RTO)
-				{
-					if (ts < it->sendTime + m_RTO*2)
-						it->resent = true;
-					else
-						it->resent = false;
-					it->sendTime = ts;
-					packets.push_back (it);
-					if (packets.size () >= 1) break;
-				}
+				auto it = m_SentPackets.Get (seqn);
+				if (it && ts >= it->sendTime + m_RTO) packet = it;
 			}
-			
+
 			// select tunnels if necessary and send
-			if (packets.size () > 0 && m_IsSendTime)
+			if (packet && m_IsSendTime)
 			{
+				if (isLost)
+					packet->resent = true;
+				else
+					packet->resent = ts < packet->sendTime + m_RTO*2;
+				packet->sendTime = ts;
+				m_SentPackets.ClearLost (packet);
+				std::vector<Packet *> packets { packet };
+
 				if (m_IsNAcked) m_NumResendAttempts = 1;
 				else if (m_IsTimeOutResend) m_NumResendAttempts++;
 				if (m_NumResendAttempts == 1 && m_RTO != INITIAL_RTO)
 				{
-					// loss-based CC
-					if (!m_IsWinDropped)
+					// loss-based CC, once per recovery
+					if (!m_IsInRecovery)
 					{
-						m_WindowSize >>= 1; // /2
-						m_IsWinDropped = true; // don't drop window twice
-						if (m_WindowSize < MIN_WINDOW_SIZE) m_WindowSize = MIN_WINDOW_SIZE;
-						UpdatePacingTime ();
+						m_IsInRecovery = true;
+						m_RecoverySeqn = m_SequenceNumber;
+						if (!m_IsWinDropped)
+						{
+							m_WindowSize >>= 1; // /2
+							m_IsWinDropped = true; // don't drop window twice
+							if (m_WindowSize < MIN_WINDOW_SIZE) m_WindowSize = MIN_WINDOW_SIZE;
+							UpdatePacingTime ();
+						}
 					}
 				}
 				else if (m_IsTimeOutResend)
@@ -1305,6 +1422,7 @@ namespace stream
 	void Stream::UpdatePacingTime ()
 	{
 		m_PacingTime = std::round (m_RTT*1000/m_WindowSize);
+		if (m_PacingTime > INITIAL_PACING_TIME) m_PacingTime = INITIAL_PACING_TIME; // not slower than before first RTT sample
 		if (m_MinPacingTime && m_PacingTime < m_MinPacingTime)
 			m_PacingTime = m_MinPacingTime;
 	}	
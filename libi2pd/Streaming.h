@@ -12,7 +12,8 @@
 #include <inttypes.h>
 #include <string>
 #include <unordered_map>
-#include <set>
+#include <vector>
+#include <algorithm>
 #include <queue>
 #include <functional>
 #include <memory>
@@ -67,15 +68,20 @@ namespace stream
 	const int PENDING_INCOMING_TIMEOUT = 10; // in seconds
 	const int MAX_RECEIVE_TIMEOUT = 20; // in seconds
 	const uint16_t DELAY_CHOKING = 60000; // in milliseconds
+	const int FAST_RETRANSMIT_NACK_THRESHOLD = 3; // packet is lost after being NACKed that many times
+	const int RACK_REORDERING_WINDOW_FRACTION = 4; // of RTT, later sent packet is delivered and it's not
+	const size_t MIN_PACKETS_RING_SIZE = 32; // power of 2
+	const uint32_t MAX_SAVED_PACKETS_SPAN = 1024; // max distance of out of sequence packet from last received
 
 	struct Packet
 	{
 		size_t len, offset;
 		uint8_t buf[MAX_PACKET_SIZE];
 		uint64_t sendTime;
-		bool resent;
+		bool resent, isLost;
+		int numNACKs;
 
-		Packet (): len (0), offset (0), sendTime (0), resent (false) {};
+		Packet (): len (0), offset (0), sendTime (0), resent (false), isLost (false), numNACKs (0) {};
 		uint8_t * GetBuffer () { return buf + offset; };
 		size_t GetLength () const { return len - offset; };
 
@@ -97,14 +103,106 @@ namespace stream
 		bool IsEcho () const { return GetFlags () & PACKET_FLAG_ECHO; };
 	};
 
-	struct PacketCmp
+	class PacketsRing
 	{
-		bool operator() (const Packet * p1, const Packet * p2) const
-		{
-			return p1->GetSeqn () < p2->GetSeqn ();
-		};
+		// packets in a ring indexed by sequence number, from first to last, might have gaps
+		public:
+
+			PacketsRing (): m_Packets (MIN_PACKETS_RING_SIZE, nullptr), m_FirstSeqn (0), m_EndSeqn (0), m_Size (0) {};
+
+			bool IsEmpty () const { return !m_Size; };
+			size_t GetSize () const { return m_Size; };
+			uint32_t GetFirstSeqn () const { return m_FirstSeqn; };
+			uint32_t GetEndSeqn () const { return m_EndSeqn; }; // last + 1
+			Packet * Get (uint32_t seqn) const
+			{
+				if (!m_Size || seqn < m_FirstSeqn || seqn >= m_EndSeqn) return nullptr;
+				return m_Packets[seqn & (m_Packets.size () - 1)];
+			}
+
+			bool Insert (Packet * packet); // false if sequence number exists already
+			Packet * Extract (uint32_t seqn); // nullptr if not found
+			void Clear (); // packets must be extracted and deleted before
+
+		private:
+
+			void Resize (size_t size);
+
+		private:
+
+			std::vector<Packet *> m_Packets; // size is power of 2
+			uint32_t m_FirstSeqn, m_EndSeqn;
+			size_t m_Size;
+	};
+
+	class SentPacketsScoreboard: public PacketsRing
+	{
+		// sent not acked packets, lost are detected by NACKs or by time (RACK)
+		public:
+
+			SentPacketsScoreboard (): m_NumLost (0), m_RackSendTime (0), m_RackSeqn (0) {};
+
+			size_t GetNumLost () const { return m_NumLost; };
+			template<typename Acked>
+			size_t ProcessAck (const Packet& ack, Acked acked); // calls acked for extracted packets, returns number of them
+			size_t DetectLosses (uint64_t ts, int rtt); // by time, returns number of newly lost
+			Packet * GetFirstLost () const;
+			void ClearLost (Packet * packet); // before resend
+			void Clear ();
+
+		private:
+
+			void MarkLost (Packet * packet);
+
+		private:
+
+			size_t m_NumLost;
+			uint64_t m_RackSendTime; // of most recently sent delivered packet
+			uint32_t m_RackSeqn;
 	};
 
+	template<typename Acked>
+	size_t SentPacketsScoreboard::ProcessAck (const Packet& ack, Acked acked)
+	{
+		uint32_t ackThrough = ack.GetAckThrough ();
+		std::vector<uint32_t> nacks;
+		for (int i = 0; i < ack.GetNACKCount (); i++)
+			nacks.push_back (ack.GetNACK (i));
+		std::sort (nacks.begin (), nacks.end ());
+		size_t numAcked = 0;
+		std::vector<Packet *> nacked;
+		for (auto seqn = GetFirstSeqn (); seqn <= ackThrough && seqn < GetEndSeqn (); seqn++)
+		{
+			auto packet = Get (seqn);
+			if (!packet) continue;
+			if (std::binary_search (nacks.begin (), nacks.end (), seqn))
+			{
+				nacked.push_back (packet);
+				continue;
+			}
+			if (!packet->resent && (packet->sendTime > m_RackSendTime ||
+				(packet->sendTime == m_RackSendTime && seqn > m_RackSeqn)))
+			{
+				// ack of resent packet might be for previous transmission
+				m_RackSendTime = packet->sendTime;
+				m_RackSeqn = seqn;
+			}
+			if (packet->isLost) m_NumLost--;
+			Extract (seqn);
+			numAcked++;
+			acked (packet);
+		}
+		for (auto packet: nacked)
+		{
+			// count NACK only if ack was generated after last transmission of the packet,
+			// i.e. a packet sent later has been delivered
+			if (m_RackSendTime <= packet->sendTime) continue;
+			packet->numNACKs++;
+			if (packet->numNACKs >= FAST_RETRANSMIT_NACK_THRESHOLD) MarkLost (packet);
+		}
+		return numAcked;
+	}
+
 	typedef std::function<void (const boost::system::error_code& ecode)> SendHandler;
 	struct SendBuffer
 	{
@@ -201,7 +299,7 @@ namespace stream
 
 			size_t GetNumSentBytes () const { return m_NumSentBytes; };
 			size_t GetNumReceivedBytes () const { return m_NumReceivedBytes; };
-			size_t GetSendQueueSize () const { return m_SentPackets.size (); };
+			size_t GetSendQueueSize () const { return m_SentPackets.GetSize (); };
 			size_t GetReceiveQueueSize () const { return m_ReceiveQueue.size (); };
 			size_t GetSendBufferSize () const { return m_SendBuffer.GetSize (); };
 			int GetWindowSize () const { return m_WindowSize; };
@@ -254,6 +352,8 @@ namespace stream
 			bool m_IsSendTime;
 			bool m_IsWinDropped;
 			bool m_IsTimeOutResend;
+			bool m_IsInRecovery; // window is reduced once until packets sent before loss are acked
+			uint32_t m_RecoverySeqn;
 			StreamingDestination& m_LocalDestination;
 			std::shared_ptr<const i2p::data::IdentityEx> m_RemoteIdentity;
 			std::shared_ptr<const i2p::crypto::Verifier> m_TransientVerifier; // in case of offline key
@@ -262,8 +362,8 @@ namespace stream
 			std::shared_ptr<const i2p::data::Lease> m_CurrentRemoteLease;
 			std::shared_ptr<i2p::tunnel::OutboundTunnel> m_CurrentOutboundTunnel;
 			std::queue<Packet *> m_ReceiveQueue;
-			std::set<Packet *, PacketCmp> m_SavedPackets;
-			std::set<Packet *, PacketCmp> m_SentPackets;
+			PacketsRing m_SavedPackets; // received out of sequence
+			SentPacketsScoreboard m_SentPackets;
 			boost::asio::deadline_timer m_ReceiveTimer, m_SendTimer, m_ResendTimer, m_AckSendTimer;
 			size_t m_NumSentBytes, m_NumReceivedBytes;
 			uint16_t m_Port;
@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#ifndef TIMER_WHEEL_H__
+#define TIMER_WHEEL_H__
+
+#include <inttypes.h>
+#include <list>
+#include <vector>
+#include <utility>
+#include <iterator>
+
+namespace i2p
+{
+namespace util
+{
+	// hashed timer wheel with one slot per tick, not thread safe
+	// Expire costs O(expired) if called at least once per NumSlots ticks and timers are within NumSlots ticks ahead,
+	// timers further ahead stay in their slot for next rounds.
+	// If time goes back by more than MaxStepBack ticks all timers expire, callback should check expiration itself
+	template<typename Element, size_t NumSlots = 1024, uint64_t MaxStepBack = NumSlots>
+	class TimerWheel
+	{
+		struct Timer
+		{
+			uint64_t expiration;
+			Element element;
+		};
+		typedef std::list<Timer> Slot;
+
+		public:
+
+			typedef std::pair<size_t, typename Slot::iterator> Handle; // slot and position, valid until expired or removed
+
+			TimerWheel (): m_Slots (NumSlots), m_CurrentTick (0), m_Size (0) {};
+
+			Handle Add (uint64_t expiration, const Element& element)
+			{
+				auto slot = expiration % NumSlots;
+				m_Slots[slot].push_back ({ expiration, element });
+				m_Size++;
+				return { slot, std::prev (m_Slots[slot].end ()) };
+			}
+
+			void Remove (const Handle& handle)
+			{
+				m_Slots[handle.first].erase (handle.second);
+				m_Size--;
+			}
+
+			template<typename Callback>
+			size_t Expire (uint64_t tick, Callback callback) // calls callback (element, expiration) for timers with expiration <= tick
+			{
+				std::vector<Timer> expired;
+				if (tick + MaxStepBack < m_CurrentTick)
+				{
+					// clock went back, timers would be late by more than MaxStepBack
+					for (auto& slot: m_Slots)
+						for (auto& it: slot) expired.push_back (std::move (it));
+					Clear ();
+				}
+				else if (tick >= m_CurrentTick)
+				{
+					auto numTicks = tick - m_CurrentTick + 1;
+					if (numTicks > NumSlots) numTicks = NumSlots; // first call or jump forward, check every slot once
+					for (uint64_t i = 0; i < numTicks; i++)
+					{
+						auto& slot = m_Slots[(tick - i) % NumSlots];
+						for (auto it = slot.begin (); it != slot.end ();)
+						{
+							if (it->expiration <= tick)
+							{
+								expired.push_back (std::move (*it));
+								it = slot.erase (it);
+								m_Size--;
+							}
+							else
+								it++;
+						}
+					}
+					m_CurrentTick = tick + 1;
+				}
+				else
+					m_CurrentTick = tick + 1; // small step back, revisit slots when time goes forward
+				// callbacks might add new timers
+				for (auto& it: expired)
+					callback (it.element, it.expiration);
+				return expired.size ();
+			}
+
+			void Clear ()
+			{
+				for (auto& it: m_Slots) it.clear ();
+				m_Size = 0;
+			}
+
+			size_t GetSize () const { return m_Size; };
+			bool IsEmpty () const { return !m_Size; };
+
+		private:
+
+			std::vector<Slot> m_Slots;
+			uint64_t m_CurrentTick; // next tick to process
+			size_t m_Size;
+	};
+}
+}
+
+#endif
@@ -1,5 +1,5 @@
 /*
-* Copyright (c) 2013-2022, The PurpleI2P Project
+* Copyright (c) 2013-2024, The PurpleI2P Project
 *
 * This file is part of Purple i2pd project and licensed under BSD3
 *
@@ -23,39 +23,102 @@ namespace tunnel
 		const i2p::data::IdentHash& nextIdent, uint32_t nextTunnelID,
 		const i2p::crypto::AESKey& layerKey, const i2p::crypto::AESKey& ivKey):
 			TunnelBase (receiveTunnelID, nextTunnelID, nextIdent),
-			m_LayerKey (layerKey), m_IVKey (ivKey)
+			m_LayerKey (layerKey), m_IVKey (ivKey), m_BandwidthUpdateTime (0),
+			m_BandwidthTokens (0), m_NumDroppedBytes (0)
 	{
 	}
 
-	void TransitTunnel::EncryptTunnelMsg (std::shared_ptr<const I2NPMessage> in, std::shared_ptr<I2NPMessage> out)
+	i2p::crypto::TunnelEncryption& TransitTunnel::GetEncryption ()
 	{
 		if (!m_Encryption)
 		{
 			m_Encryption.reset (new i2p::crypto::TunnelEncryption);
 			m_Encryption->SetKeys (m_LayerKey, m_IVKey);
 		}
-		m_Encryption->Encrypt (in->GetPayload () + 4, out->GetPayload () + 4);
+		return *m_Encryption;
+	}
+
+	void TransitTunnel::EncryptTunnelMsg (std::shared_ptr<const I2NPMessage> in, std::shared_ptr<I2NPMessage> out)
+	{
+		GetEncryption ().Encrypt (in->GetPayload () + 4, out->GetPayload () + 4);
 		i2p::transport::transports.UpdateTotalTransitTransmittedBytes (TUNNEL_DATA_MSG_SIZE);
 	}
 
+	void TransitTunnel::EncryptTunnelMsgs (const std::vector<std::shared_ptr<I2NPMessage> >& msgs)
+	{
+		auto num = msgs.size ();
+		if (!num) return;
+		if (num == 1)
+		{
+			EncryptTunnelMsg (msgs[0], msgs[0]);
+			return;
+		}
+		std::vector<uint8_t *> bufs (num);
+		for (size_t i = 0; i < num; i++)
+			bufs[i] = msgs[i]->GetPayload () + 4;
+		GetEncryption ().Encrypt (bufs.data (), bufs.data (), num);
+		i2p::transport::transports.UpdateTotalTransitTransmittedBytes (num*TUNNEL_DATA_MSG_SIZE);
+	}
+
+	bool TransitTunnel::ConsumeBandwidth (size_t len)
+	{
+		auto ts = i2p::util::GetMillisecondsSinceEpoch ();
+		if (ts/1000 != m_BandwidthUpdateTime/1000)
+			i2p::tunnel::tunnels.TransitTunnelActive (); // first traffic during this second
+		auto limit = i2p::tunnel::tunnels.GetTransitTunnelBandwidthLimit ();
+		if (!limit)
+		{
+			// not congested, keep bucket full
+			m_BandwidthUpdateTime = ts;
+			m_BandwidthTokens = UINT32_MAX;
+			return true;
+		}
+		if (ts > m_BandwidthUpdateTime)
+			m_BandwidthTokens += (ts - m_BandwidthUpdateTime)*limit/1000;
+		if (m_BandwidthTokens > limit) m_BandwidthTokens = limit; // burst of one second
+		m_BandwidthUpdateTime = ts;
+		if (m_BandwidthTokens < len)
+		{
+			m_NumDroppedBytes += len;
+			return false;
+		}
+		m_BandwidthTokens -= len;
+		return true;
+	}
+
 	TransitTunnelParticipant::~TransitTunnelParticipant ()
 	{
 	}
 
 	void TransitTunnelParticipant::HandleTunnelDataMsg (std::shared_ptr<i2p::I2NPMessage>&& tunnelMsg)
 	{
-		EncryptTunnelMsg (tunnelMsg, tunnelMsg);
-
-		m_NumTransmittedBytes += tunnelMsg->GetLength ();
-		htobe32buf (tunnelMsg->GetPayload (), GetNextTunnelID ());
-		tunnelMsg->FillI2NPMessageHeader (eI2NPTunnelData);
-		m_TunnelDataMsgs.push_back (tunnelMsg);
+		// encrypted in FlushTunnelDataMsgs, all at once
+		m_TunnelDataMsgs.push_back (std::move (tunnelMsg));
 	}
 
 	void TransitTunnelParticipant::FlushTunnelDataMsgs ()
 	{
 		if (!m_TunnelDataMsgs.empty ())
 		{
+			// drop excess before encryption
+			size_t numAllowed = 0;
+			while (numAllowed < m_TunnelDataMsgs.size () && ConsumeBandwidth (m_TunnelDataMsgs[numAllowed]->GetLength ()))
+				numAllowed++;
+			if (numAllowed < m_TunnelDataMsgs.size ())
+			{
+				LogPrint (eLogDebug, "TransitTunnel: ", GetTunnelID (), " exceeds bandwidth share, ",
+					m_TunnelDataMsgs.size () - numAllowed, " messages dropped");
+				m_TunnelDataMsgs.resize (numAllowed);
+				if (m_TunnelDataMsgs.empty ()) return;
+			}
+			EncryptTunnelMsgs (m_TunnelDataMsgs);
+			for (auto& it: m_TunnelDataMsgs)
+			{
+				m_NumTransmittedBytes += it->GetLength ();
+				htobe32buf (it->GetPayload (), GetNextTunnelID ());
+				it->FillI2NPMessageHeader (eI2NPTunnelData);
+				it->isTransit = true;
+			}
 			auto num = m_TunnelDataMsgs.size ();
 			if (num > 1)
 				LogPrint (eLogDebug, "TransitTunnel: ", GetTunnelID (), "->", GetNextTunnelID (), " ", num);
@@ -76,6 +139,11 @@ namespace tunnel
 
 	void TransitTunnelGateway::SendTunnelDataMsg (std::shared_ptr<i2p::I2NPMessage> msg)
 	{
+		if (!ConsumeBandwidth (msg->GetLength ()))
+		{
+			LogPrint (eLogDebug, "TransitTunnel: Gateway ", GetTunnelID (), " exceeds bandwidth share, message dropped");
+			return;
+		}
 		TunnelMessageBlock block;
 		block.deliveryType = eDeliveryTypeLocal;
 		block.data = msg;
@@ -91,6 +159,11 @@ namespace tunnel
 
 	void TransitTunnelEndpoint::HandleTunnelDataMsg (std::shared_ptr<i2p::I2NPMessage>&& tunnelMsg)
 	{
+		if (!ConsumeBandwidth (tunnelMsg->GetLength ()))
+		{
+			LogPrint (eLogDebug, "TransitTunnel: Endpoint ", GetTunnelID (), " exceeds bandwidth share, message dropped");
+			return;
+		}
 		auto newMsg = CreateEmptyTunnelDataMsg (true);
 		EncryptTunnelMsg (tunnelMsg, newMsg);
 
@@ -23,6 +23,10 @@ namespace i2p
 {
 namespace tunnel
 {
+	const int TRANSIT_TUNNELS_CONGESTION_THRESHOLD = 80; // in percents of transit bandwidth, tunnels are limited above it
+	const int TRANSIT_TUNNEL_BANDWIDTH_SHARE_FACTOR = 2; // multiples of fair share
+	const uint32_t TRANSIT_TUNNEL_MIN_BANDWIDTH = 16*1024; // in bytes per second
+
 	class TransitTunnel: public TunnelBase
 	{
 		public:
@@ -32,15 +36,30 @@ namespace tunnel
 				const i2p::crypto::AESKey& layerKey, const i2p::crypto::AESKey& ivKey);
 
 			virtual size_t GetNumTransmittedBytes () const { return 0; };
+			size_t GetNumDroppedBytes () const { return m_NumDroppedBytes; };
 
 			// implements TunnelBase
 			void SendTunnelDataMsg (std::shared_ptr<i2p::I2NPMessage> msg) override;
 			void HandleTunnelDataMsg (std::shared_ptr<i2p::I2NPMessage>&& tunnelMsg) override;
 			void EncryptTunnelMsg (std::shared_ptr<const I2NPMessage> in, std::shared_ptr<I2NPMessage> out) override;
+
+		protected:
+
+			void EncryptTunnelMsgs (const std::vector<std::shared_ptr<I2NPMessage> >& msgs); // in place
+			bool ConsumeBandwidth (size_t len); // false if tunnel exceeds its share of transit bandwidth
+
+		private:
+
+			i2p::crypto::TunnelEncryption& GetEncryption ();
+
 		private:
 
 			i2p::crypto::AESKey m_LayerKey, m_IVKey;
 			std::unique_ptr<i2p::crypto::TunnelEncryption> m_Encryption;
+			// token bucket
+			uint64_t m_BandwidthUpdateTime; // in milliseconds
+			uint64_t m_BandwidthTokens; // in bytes
+			size_t m_NumDroppedBytes;
 	};
 
 	class TransitTunnelParticipant: public TransitTunnel
@@ -72,7 +91,7 @@ namespace tunnel
 				const i2p::data::IdentHash& nextIdent, uint32_t nextTunnelID,
 				const i2p::crypto::AESKey& layerKey, const i2p::crypto::AESKey& ivKey):
 				TransitTunnel (receiveTunnelID, nextIdent, nextTunnelID,
-				layerKey, ivKey), m_Gateway(this) {};
+				layerKey, ivKey), m_Gateway(this, true) {};
 
 			void SendTunnelDataMsg (std::shared_ptr<i2p::I2NPMessage> msg) override;
 			void FlushTunnelDataMsgs () override;
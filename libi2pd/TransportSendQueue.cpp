@@ -0,0 +1,178 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#include <cmath>
+#include "Transports.h"
+#include "TransportSendQueue.h"
+
+namespace i2p
+{
+namespace transport
+{
+	TransportPriority GetTransportPriority (const I2NPMessage& msg)
+	{
+		switch (msg.GetTypeID ())
+		{
+			case eI2NPDatabaseStore:
+			case eI2NPDatabaseLookup:
+			case eI2NPDatabaseSearchReply:
+			case eI2NPVariableTunnelBuild:
+			case eI2NPVariableTunnelBuildReply:
+			case eI2NPShortTunnelBuild:
+			case eI2NPShortTunnelBuildReply:
+			case eI2NPTunnelBuild:
+			case eI2NPTunnelBuildReply:
+				return eTransportPriorityControl;
+			default:
+				return msg.isTransit ? eTransportPriorityTransit : eTransportPriorityLocal;
+		}
+	}
+
+	QueueDelayHistogram::QueueDelayHistogram (): m_NumDropped (0)
+	{
+		for (auto& it: m_Buckets) it = 0;
+	}
+
+	void QueueDelayHistogram::Add (uint64_t delay)
+	{
+		delay /= 1000; // to milliseconds
+		int bucket = 0;
+		while (bucket < QUEUE_DELAY_HISTOGRAM_NUM_BUCKETS - 1 && delay >= GetBucketUpperBound (bucket))
+			bucket++;
+		m_Buckets[bucket]++;
+	}
+
+	uint64_t TransportSendQueue::GetLag (uint64_t mts) const
+	{
+		uint64_t lag = 0;
+		for (const auto& it: m_Queues)
+			if (!it.empty () && mts > it.front ()->GetEnqueueTime () && mts - it.front ()->GetEnqueueTime () > lag)
+				lag = mts - it.front ()->GetEnqueueTime ();
+		return lag;
+	}
+
+	void TransportSendQueue::Put (std::shared_ptr<I2NPMessage> msg, uint64_t mts)
+	{
+		if (!msg) return;
+		msg->SetEnqueueTime (mts);
+		m_Queues[GetTransportPriority (*msg)].push_back (std::move (msg));
+		m_Size++;
+	}
+
+	std::shared_ptr<I2NPMessage> TransportSendQueue::GetFront (uint64_t mts)
+	{
+		for (int i = 0; i < eNumTransportPriorities; i++)
+		{
+			auto& queue = m_Queues[i];
+			while (!queue.empty ())
+			{
+				auto msg = queue.front ();
+				if (i == eTransportPriorityControl) return msg; // never dropped by CoDel
+				auto& codel = m_CoDels[i];
+				uint64_t sojourn = mts > msg->GetEnqueueTime () ? mts - msg->GetEnqueueTime () : 0;
+				bool okToDrop = ShouldDrop (codel, sojourn, queue.size (), mts), drop = false;
+				if (codel.dropping)
+				{
+					if (!okToDrop)
+						codel.dropping = false; // sojourn time is below target again
+					else if (mts >= codel.dropNext)
+					{
+						drop = true;
+						codel.count++;
+						codel.dropNext += TRANSPORT_CODEL_INTERVAL/std::sqrt (codel.count);
+					}
+				}
+				else if (okToDrop)
+				{
+					drop = true;
+					codel.dropping = true;
+					// continue with previous drop rate if we were dropping recently
+					auto delta = codel.count - codel.lastCount;
+					codel.count = (delta > 1 && mts < codel.dropNext + 16*TRANSPORT_CODEL_INTERVAL) ? delta : 1;
+					codel.lastCount = codel.count;
+					codel.dropNext = mts + TRANSPORT_CODEL_INTERVAL/std::sqrt (codel.count);
+				}
+				if (!drop) return msg;
+				msg->Drop ();
+				queue.pop_front ();
+				m_Size--;
+				transports.GetQueueDelayHistogram ((TransportPriority)i).AddDropped ();
+			}
+		}
+		return nullptr;
+	}
+
+	void TransportSendQueue::PopFront (uint64_t mts)
+	{
+		for (int i = 0; i < eNumTransportPriorities; i++)
+		{
+			auto& queue = m_Queues[i];
+			if (!queue.empty ())
+			{
+				auto enqueueTime = queue.front ()->GetEnqueueTime ();
+				transports.GetQueueDelayHistogram ((TransportPriority)i).Add (mts > enqueueTime ? mts - enqueueTime : 0);
+				queue.pop_front ();
+				m_Size--;
+				return;
+			}
+		}
+	}
+
+	void TransportSendQueue::DropFront ()
+	{
+		for (auto& queue: m_Queues)
+		{
+			if (!queue.empty ())
+			{
+				if (queue.front ()) queue.front ()->Drop ();
+				queue.pop_front ();
+				m_Size--;
+				return;
+			}
+		}
+	}
+
+	void TransportSendQueue::GetAll (std::vector<std::shared_ptr<I2NPMessage> >& msgs)
+	{
+		for (auto& queue: m_Queues)
+		{
+			for (auto& it: queue)
+				msgs.push_back (std::move (it));
+			queue.clear ();
+		}
+		m_Size = 0;
+	}
+
+	void TransportSendQueue::DropAll ()
+	{
+		for (auto& queue: m_Queues)
+		{
+			for (auto& it: queue)
+				if (it) it->Drop ();
+			queue.clear ();
+		}
+		m_Size = 0;
+	}
+
+	bool TransportSendQueue::ShouldDrop (CoDel& codel, uint64_t sojourn, size_t queueSize, uint64_t mts)
+	{
+		// sojourn time must stay above target for at least interval
+		if (sojourn < TRANSPORT_CODEL_TARGET || queueSize < TRANSPORT_CODEL_MIN_QUEUE_SIZE)
+		{
+			codel.firstAboveTime = 0;
+			return false;
+		}
+		if (!codel.firstAboveTime)
+		{
+			codel.firstAboveTime = mts + TRANSPORT_CODEL_INTERVAL;
+			return false;
+		}
+		return mts >= codel.firstAboveTime;
+	}
+}
+}
@@ -0,0 +1,90 @@
+/*
+* Copyright (c) 2024, The PurpleI2P Project
+*
+* This file is part of Purple i2pd project and licensed under BSD3
+*
+* See full license text in LICENSE file at top of project tree
+*/
+
+#ifndef TRANSPORT_SEND_QUEUE_H__
+#define TRANSPORT_SEND_QUEUE_H__
+
+#include <inttypes.h>
+#include <deque>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <memory>
+#include "I2NPProtocol.h"
+
+namespace i2p
+{
+namespace transport
+{
+	enum TransportPriority
+	{
+		eTransportPriorityControl = 0, // tunnel build and NetDb
+		eTransportPriorityLocal, // own tunnels
+		eTransportPriorityTransit, // transit tunnels
+		eNumTransportPriorities
+	};
+	TransportPriority GetTransportPriority (const I2NPMessage& msg);
+
+	const int QUEUE_DELAY_HISTOGRAM_NUM_BUCKETS = 12; // <1ms, <2ms, <4ms ... <1024ms, >=1024ms
+	class QueueDelayHistogram // of sent messages
+	{
+		public:
+
+			QueueDelayHistogram ();
+			void Add (uint64_t delay); // in microseconds
+			void AddDropped () { m_NumDropped++; };
+			uint64_t GetCount (int bucket) const { return m_Buckets[bucket]; };
+			uint64_t GetNumDropped () const { return m_NumDropped; };
+			static uint64_t GetBucketUpperBound (int bucket) { return 1 << bucket; }; // in milliseconds, last is unbounded
+
+		private:
+
+			std::array<std::atomic<uint64_t>, QUEUE_DELAY_HISTOGRAM_NUM_BUCKETS> m_Buckets;
+			std::atomic<uint64_t> m_NumDropped; // by CoDel
+	};
+
+	const uint64_t TRANSPORT_CODEL_TARGET = 20000; // in microseconds
+	const uint64_t TRANSPORT_CODEL_INTERVAL = 200000; // in microseconds
+	const size_t TRANSPORT_CODEL_MIN_QUEUE_SIZE = 4; // don't drop if less messages
+	class TransportSendQueue
+	{
+		struct CoDel
+		{
+			uint64_t firstAboveTime = 0, dropNext = 0; // monotonic microseconds
+			uint32_t count = 0, lastCount = 0;
+			bool dropping = false;
+		};
+
+		public:
+
+			TransportSendQueue (): m_Size (0) {};
+
+			bool IsEmpty () const { return !m_Size; };
+			size_t GetSize () const { return m_Size; };
+			uint64_t GetLag (uint64_t mts) const; // sojourn time of oldest message, in microseconds
+			void Put (std::shared_ptr<I2NPMessage> msg, uint64_t mts); // mts is monotonic microseconds
+			std::shared_ptr<I2NPMessage> GetFront (uint64_t mts); // highest priority first, drops by CoDel, nullptr if empty
+			void PopFront (uint64_t mts); // removes message returned by GetFront
+			void DropFront (); // drops message returned by GetFront, not sent, no delay sample
+			void GetAll (std::vector<std::shared_ptr<I2NPMessage> >& msgs); // and clear
+			void DropAll ();
+
+		private:
+
+			bool ShouldDrop (CoDel& codel, uint64_t sojourn, size_t queueSize, uint64_t mts);
+
+		private:
+
+			std::array<std::deque<std::shared_ptr<I2NPMessage> >, eNumTransportPriorities> m_Queues;
+			std::array<CoDel, eNumTransportPriorities> m_CoDels;
+			size_t m_Size;
+	};
+}
+}
+
+#endif
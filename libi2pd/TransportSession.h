@@ -19,6 +19,7 @@
 #include "RouterInfo.h"
 #include "I2NPProtocol.h"
 #include "Timestamp.h"
+#include "TransportSendQueue.h"
 
 namespace i2p
 {
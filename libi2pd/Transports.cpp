@@ -6,6 +6,7 @@
 * See full license text in LICENSE file at top of project tree
 */
 
+#include <cmath>
 #include "Log.h"
 #include "Crypto.h"
 #include "RouterContext.h"
@@ -23,8 +24,10 @@ namespace i2p
 namespace transport
 {
 	template<typename Keys>
-	EphemeralKeysSupplier<Keys>::EphemeralKeysSupplier (int size):
-		m_QueueSize (size), m_IsRunning (false), m_Thread (nullptr)
+	EphemeralKeysSupplier<Keys>::EphemeralKeysSupplier (int minSize, int maxSize):
+		m_MinQueueSize (minSize), m_MaxQueueSize (maxSize), m_QueueSize (minSize), m_NumInProgress (0),
+		m_RateUpdateTime (0), m_NumAcquiredSinceUpdate (0), m_Rate (0), m_NumAcquired (0), m_NumStarved (0),
+		m_IsRunning (false)
 	{
 	}
 
@@ -35,10 +38,13 @@ namespace transport
 	}
 
 	template<typename Keys>
-	void EphemeralKeysSupplier<Keys>::Start ()
+	void EphemeralKeysSupplier<Keys>::Start (int numThreads)
 	{
 		m_IsRunning = true;
-		m_Thread = new std::thread (std::bind (&EphemeralKeysSupplier<Keys>::Run, this));
+		if (numThreads < 1) numThreads = 1;
+		if (numThreads > EPHEMERAL_KEYS_MAX_NUM_THREADS) numThreads = EPHEMERAL_KEYS_MAX_NUM_THREADS;
+		for (int i = 0; i < numThreads; i++)
+			m_Threads.emplace_back (new std::thread (std::bind (&EphemeralKeysSupplier<Keys>::Run, this)));
 	}
 
 	template<typename Keys>
@@ -47,14 +53,11 @@ namespace transport
 		{
 			std::unique_lock<std::mutex> l(m_AcquiredMutex);
 			m_IsRunning = false;
-			m_Acquired.notify_one ();
-		}
-		if (m_Thread)
-		{
-			m_Thread->join ();
-			delete m_Thread;
-			m_Thread = 0;
+			m_Acquired.notify_all ();
 		}
+		for (auto& it: m_Threads)
+			it->join ();
+		m_Threads.clear ();
 	}
 
 	template<typename Keys>
@@ -62,48 +65,56 @@ namespace transport
 	{
 		i2p::util::SetThreadName("Ephemerals");
 
+		std::unique_lock<std::mutex> l(m_AcquiredMutex);
 		while (m_IsRunning)
 		{
-			int num, total = 0;
-			while ((num = m_QueueSize - (int)m_Queue.size ()) > 0 && total < 10)
+			UpdateQueueSize (i2p::util::GetMonotonicMilliseconds ());
+			if ((int)m_Queue.size () + m_NumInProgress < m_QueueSize)
 			{
-				CreateEphemeralKeys (num);
-				total += num;
-			}
-			if (total >= 10)
-			{
-				LogPrint (eLogWarning, "Transports: ", total, " ephemeral keys generated at the time");
-				std::this_thread::sleep_for (std::chrono::seconds(1)); // take a break
+				// generate one key without lock, other threads might generate too
+				m_NumInProgress++;
+				l.unlock ();
+				auto pair = std::make_shared<Keys> ();
+				pair->GenerateKeys ();
+				l.lock ();
+				m_NumInProgress--;
+				m_Queue.push (pair);
 			}
 			else
-			{
-				std::unique_lock<std::mutex> l(m_AcquiredMutex);
-				if (!m_IsRunning) break;
-				m_Acquired.wait (l); // wait for element gets acquired
-			}
+				m_Acquired.wait_for (l, std::chrono::milliseconds (EPHEMERAL_KEYS_RATE_UPDATE_INTERVAL)); // wait for element gets acquired
 		}
 	}
 
 	template<typename Keys>
-	void EphemeralKeysSupplier<Keys>::CreateEphemeralKeys (int num)
+	void EphemeralKeysSupplier<Keys>::UpdateQueueSize (uint64_t ts)
 	{
-		if (num > 0)
+		if (ts < m_RateUpdateTime + EPHEMERAL_KEYS_RATE_UPDATE_INTERVAL) return;
+		if (m_RateUpdateTime)
 		{
-			for (int i = 0; i < num; i++)
-			{
-				auto pair = std::make_shared<Keys> ();
-				pair->GenerateKeys ();
-				std::unique_lock<std::mutex> l(m_AcquiredMutex);
-				m_Queue.push (pair);
-			}
+			double rate = m_NumAcquiredSinceUpdate*1000.0/(ts - m_RateUpdateTime);
+			// follow bursts immediately, forget them slowly
+			if (rate > m_Rate)
+				m_Rate = rate;
+			else
+				m_Rate += (rate - m_Rate)/EPHEMERAL_KEYS_RATE_DECAY;
+			int queueSize = std::ceil (m_Rate*EPHEMERAL_KEYS_LOOKAHEAD);
+			if (queueSize < m_MinQueueSize) queueSize = m_MinQueueSize;
+			if (queueSize > m_MaxQueueSize) queueSize = m_MaxQueueSize;
+			if (queueSize > m_QueueSize*2)
+				LogPrint (eLogInfo, "Transports: Ephemeral keys queue size increased from ", (int)m_QueueSize, " to ", queueSize);
+			m_QueueSize = queueSize;
 		}
+		m_RateUpdateTime = ts;
+		m_NumAcquiredSinceUpdate = 0;
 	}
 
 	template<typename Keys>
 	std::shared_ptr<Keys> EphemeralKeysSupplier<Keys>::Acquire ()
 	{
+		m_NumAcquired++;
 		{
 			std::unique_lock<std::mutex> l(m_AcquiredMutex);
+			m_NumAcquiredSinceUpdate++;
 			if (!m_Queue.empty ())
 			{
 				auto pair = m_Queue.front ();
@@ -111,8 +122,10 @@ namespace transport
 				m_Acquired.notify_one ();
 				return pair;
 			}
+			m_Acquired.notify_all (); // starved, all threads should generate
 		}
 		// queue is empty, create new
+		m_NumStarved++;
 		auto pair = std::make_shared<Keys> ();
 		pair->GenerateKeys ();
 		return pair;
@@ -137,7 +150,7 @@ namespace transport
 		m_IsOnline (true), m_IsRunning (false), m_IsNAT (true), m_CheckReserved(true), m_Thread (nullptr),
 		m_Service (nullptr), m_Work (nullptr), m_PeerCleanupTimer (nullptr), m_PeerTestTimer (nullptr),
 		m_UpdateBandwidthTimer (nullptr), m_SSU2Server (nullptr), m_NTCP2Server (nullptr),
-		m_X25519KeysPairSupplier (15), // 15 pre-generated keys
+		m_X25519KeysPairSupplier (EPHEMERAL_KEYS_MIN_QUEUE_SIZE), // at least 15 pre-generated keys
 		m_TotalSentBytes (0), m_TotalReceivedBytes (0), m_TotalTransitTransmittedBytes (0),
 		m_InBandwidth (0), m_OutBandwidth (0), m_TransitBandwidth (0),
 		m_InBandwidth15s (0), m_OutBandwidth15s (0), m_TransitBandwidth15s (0),
@@ -172,7 +185,8 @@ namespace transport
 		bool ipv4; i2p::config::GetOption("ipv4", ipv4);
 		bool ipv6; i2p::config::GetOption("ipv6", ipv6);
 		i2p::config::GetOption("nat", m_IsNAT);
-		m_X25519KeysPairSupplier.Start ();
+		uint16_t ephemeralThreads; i2p::config::GetOption("limits.ephemeralthreads", ephemeralThreads);
+		m_X25519KeysPairSupplier.Start (ephemeralThreads);
 		m_IsRunning = true;
 		m_Thread = new std::thread (std::bind (&Transports::Run, this));
 		std::string ntcp2proxy; i2p::config::GetOption("ntcp2.proxy", ntcp2proxy);
@@ -410,7 +424,7 @@ namespace transport
 		}
 	}
 
-	int Transports::GetCongestionLevel (bool longTerm) const
+	int Transports::GetCongestionLevel (bool longTerm, uint32_t numActiveTransitTunnels) const
 	{
 		auto bwLimit = i2p::context.GetBandwidthLimit () * 1024; // convert to bytes
 		auto tbwLimit = i2p::context.GetTransitBandwidthLimit () * 1024; // convert to bytes
@@ -430,8 +444,10 @@ namespace transport
 			bw = std::max (m_InBandwidth15s, m_OutBandwidth15s);
 			tbw = m_TransitBandwidth;
 		}
+		// bandwidth headroom for one more tunnel as busy as an average active one
+		uint64_t tbwRequired = numActiveTransitTunnels ? tbw + tbw/numActiveTransitTunnels : tbw;
 		auto bwCongestionLevel = CONGESTION_LEVEL_FULL * bw / bwLimit;
-		auto tbwCongestionLevel = CONGESTION_LEVEL_FULL * tbw / tbwLimit;
+		auto tbwCongestionLevel = CONGESTION_LEVEL_FULL * tbwRequired / tbwLimit;
 		return std::max (bwCongestionLevel, tbwCongestionLevel);
 	}
 
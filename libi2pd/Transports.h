@@ -31,31 +31,47 @@ namespace i2p
 {
 namespace transport
 {
+	const int EPHEMERAL_KEYS_MIN_QUEUE_SIZE = 15;
+	const int EPHEMERAL_KEYS_MAX_QUEUE_SIZE = 1000;
+	const int EPHEMERAL_KEYS_RATE_UPDATE_INTERVAL = 1000; // in milliseconds
+	const int EPHEMERAL_KEYS_LOOKAHEAD = 2; // keep keys for 2 seconds of peak acquisition rate
+	const int EPHEMERAL_KEYS_RATE_DECAY = 16; // number of intervals to forget a burst
+	const int EPHEMERAL_KEYS_MAX_NUM_THREADS = 8;
 	template<typename Keys>
 	class EphemeralKeysSupplier
 	{
 	// called from this file only, so implementation is in Transports.cpp
 		public:
 
-			EphemeralKeysSupplier (int size);
+			EphemeralKeysSupplier (int minSize, int maxSize = EPHEMERAL_KEYS_MAX_QUEUE_SIZE);
 			~EphemeralKeysSupplier ();
-			void Start ();
+			void Start (int numThreads = 1);
 			void Stop ();
 			std::shared_ptr<Keys> Acquire ();
 			void Return (std::shared_ptr<Keys> pair);
 
+			int GetQueueSize () const { return m_QueueSize; }; // current target
+			uint64_t GetNumAcquired () const { return m_NumAcquired; };
+			uint64_t GetNumStarved () const { return m_NumStarved; }; // generated by caller because queue was empty
+
 		private:
 
 			void Run ();
-			void CreateEphemeralKeys (int num);
+			void UpdateQueueSize (uint64_t ts); // with mutex locked
 
 		private:
 
-			const int m_QueueSize;
+			const int m_MinQueueSize, m_MaxQueueSize;
+			std::atomic<int> m_QueueSize; // adjusted to acquisition rate
 			std::queue<std::shared_ptr<Keys> > m_Queue;
+			int m_NumInProgress; // being generated by threads
+			uint64_t m_RateUpdateTime; // monotonic milliseconds
+			int m_NumAcquiredSinceUpdate;
+			double m_Rate; // per second, peak with slow decay
+			std::atomic<uint64_t> m_NumAcquired, m_NumStarved;
 
 			bool m_IsRunning;
-			std::thread * m_Thread;
+			std::vector<std::unique_ptr<std::thread> > m_Threads;
 			std::condition_variable m_Acquired;
 			std::mutex m_AcquiredMutex;
 	};
@@ -145,6 +161,7 @@ namespace transport
 			boost::asio::io_service& GetService () { return *m_Service; };
 			std::shared_ptr<i2p::crypto::X25519Keys> GetNextX25519KeysPair ();
 			void ReuseX25519KeysPair (std::shared_ptr<i2p::crypto::X25519Keys> pair);
+			const X25519KeysPairSupplier& GetX25519KeysPairSupplier () const { return m_X25519KeysPairSupplier; };
 
 			void SendMessage (const i2p::data::IdentHash& ident, std::shared_ptr<i2p::I2NPMessage> msg);
 			void SendMessages (const i2p::data::IdentHash& ident, const std::vector<std::shared_ptr<i2p::I2NPMessage> >& msgs);
@@ -165,7 +182,8 @@ namespace transport
 			uint32_t GetInBandwidth15s () const { return m_InBandwidth15s; };
 			uint32_t GetOutBandwidth15s () const { return m_OutBandwidth15s; };
 			uint32_t GetTransitBandwidth15s () const { return m_TransitBandwidth15s; };
-			int GetCongestionLevel (bool longTerm) const;
+			int GetCongestionLevel (bool longTerm, uint32_t numActiveTransitTunnels = 0) const; // with headroom for one more active transit tunnel
+			QueueDelayHistogram& GetQueueDelayHistogram (TransportPriority priority) { return m_QueueDelayHistograms[priority]; };
 			size_t GetNumPeers () const { return m_Peers.size (); };
 			std::shared_ptr<const i2p::data::RouterInfo> GetRandomPeer (bool isHighBandwidth) const;
 
@@ -231,6 +249,8 @@ namespace transport
 			uint32_t m_InBandwidth15s, m_OutBandwidth15s, m_TransitBandwidth15s;
 			// Bandwidth during last 5 minutes
 			uint32_t m_InBandwidth5m, m_OutBandwidth5m, m_TransitBandwidth5m;
+			// send queues of all sessions
+			QueueDelayHistogram m_QueueDelayHistograms[eNumTransportPriorities];
 
 			/** which router families to trust for first hops */
 			std::vector<i2p::data::FamilyID> m_TrustedFamilies;
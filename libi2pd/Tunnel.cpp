@@ -335,9 +335,22 @@ namespace tunnel
 		}
 	}
 
+	static uint64_t GetNextTransitTunnelTimer (std::shared_ptr<TransitTunnel> tunnel, uint64_t ts, bool cleanup)
+	{
+		uint64_t expiration = tunnel->GetCreationTime () + TUNNEL_EXPIRATION_TIMEOUT + 1;
+		// only endpoints have something to clean up
+		if (cleanup && ts + TUNNEL_MANAGE_INTERVAL < expiration && std::dynamic_pointer_cast<TransitTunnelEndpoint>(tunnel))
+			return ts + TUNNEL_MANAGE_INTERVAL;
+		return expiration;
+	}
+
 	Tunnels tunnels;
 
-	Tunnels::Tunnels (): m_IsRunning (false), m_Thread (nullptr), m_MaxNumTransitTunnels (DEFAULT_MAX_NUM_TRANSIT_TUNNELS),
+	Tunnels::Tunnels (): m_IsRunning (false), m_Thread (nullptr),
+		m_I2NPTunnelEndpointMessagesMemoryPool ("Tunnel endpoint messages"),
+		m_I2NPTunnelMessagesMemoryPool ("Tunnel messages"),
+		m_MaxNumTransitTunnels (DEFAULT_MAX_NUM_TRANSIT_TUNNELS),
+		m_NumActiveTransitTunnels (0), m_TransitTunnelBandwidthLimit (0), m_NumLastActiveTransitTunnels (0),
 		m_TotalNumSuccesiveTunnelCreations (0), m_TotalNumFailedTunnelCreations (0), // for normal average
 		m_TunnelCreationSuccessRate (TCSR_START_VALUE), m_TunnelCreationAttemptsNum(0)
 	{
@@ -444,7 +457,13 @@ namespace tunnel
 	bool Tunnels::AddTransitTunnel (std::shared_ptr<TransitTunnel> tunnel)
 	{
 		if (m_Tunnels.emplace (tunnel->GetTunnelID (), tunnel).second)
+		{
 			m_TransitTunnels.push_back (tunnel);
+			m_TransitTunnelsTimers.Add (GetNextTransitTunnelTimer (tunnel, i2p::util::GetSecondsSinceEpoch (), m_TransitTunnelsWorkers.empty ()),
+				std::prev (m_TransitTunnels.end ()));
+			if (!m_TransitTunnelsWorkers.empty ())
+				m_TransitTunnelsWorkers[tunnel->GetTunnelID () % m_TransitTunnelsWorkers.size ()]->AddTransitTunnel (tunnel);
+		}
 		else
 		{
 			LogPrint (eLogError, "Tunnel: Tunnel with id ", tunnel->GetTunnelID (), " already exists");
@@ -456,11 +475,15 @@ namespace tunnel
 	void Tunnels::Start ()
 	{
 		m_IsRunning = true;
+		for (auto& it: m_TransitTunnelsWorkers)
+			it->Start ();
 		m_Thread = new std::thread (std::bind (&Tunnels::Run, this));
 	}
 
 	void Tunnels::Stop ()
 	{
+		for (auto& it: m_TransitTunnelsWorkers)
+			it->Stop ();
 		m_IsRunning = false;
 		m_Queue.WakeUp ();
 		if (m_Thread)
@@ -476,34 +499,34 @@ namespace tunnel
 		i2p::util::SetThreadName("Tunnels");
 		std::this_thread::sleep_for (std::chrono::seconds(1)); // wait for other parts are ready
 
-		uint64_t lastTs = 0, lastPoolsTs = 0, lastMemoryPoolTs = 0;
+		uint64_t lastTs = 0, lastPoolsTs = 0, lastMemoryPoolTs = 0, lastBandwidthTs = 0;
+		std::vector<std::shared_ptr<I2NPMessage> > msgs;
 		while (m_IsRunning)
 		{
 			try
 			{
-				auto msg = m_Queue.GetNextWithTimeout (1000); // 1 sec
-				if (msg)
+				m_Queue.GetAllWithTimeout (msgs, 1000); // 1 sec
+				if (!msgs.empty ())
 				{
-					int numMsgs = 0;
-					uint32_t prevTunnelID = 0, tunnelID = 0;
+					uint32_t prevTunnelID = 0;
 					std::shared_ptr<TunnelBase> prevTunnel;
-					do
+					for (auto& msg: msgs)
 					{
-						std::shared_ptr<TunnelBase> tunnel;
 						uint8_t typeID = msg->GetTypeID ();
 						switch (typeID)
 						{
 							case eI2NPTunnelData:
 							case eI2NPTunnelGateway:
 							{
-								tunnelID = bufbe32toh (msg->GetPayload ());
-								if (tunnelID == prevTunnelID)
+								uint32_t tunnelID = bufbe32toh (msg->GetPayload ());
+								std::shared_ptr<TunnelBase> tunnel;
+								if (prevTunnel && tunnelID == prevTunnelID)
 									tunnel = prevTunnel;
-								else if (prevTunnel)
-									prevTunnel->FlushTunnelDataMsgs ();
-
-								if (!tunnel)
+								else
+								{
+									if (prevTunnel) prevTunnel->FlushTunnelDataMsgs ();
 									tunnel = GetTunnel (tunnelID);
+								}
 								if (tunnel)
 								{
 									if (typeID == eI2NPTunnelData)
@@ -513,7 +536,8 @@ namespace tunnel
 								}
 								else
 									LogPrint (eLogWarning, "Tunnel: Tunnel not found, tunnelID=", tunnelID, " previousTunnelID=", prevTunnelID, " type=", (int)typeID);
-
+								prevTunnelID = tunnelID;
+								prevTunnel = tunnel;
 								break;
 							}
 							case eI2NPVariableTunnelBuild:
@@ -527,23 +551,20 @@ namespace tunnel
 							default:
 								LogPrint (eLogWarning, "Tunnel: Unexpected message type ", (int) typeID);
 						}
-
-						msg = (numMsgs <= MAX_TUNNEL_MSGS_BATCH_SIZE) ? m_Queue.Get () : nullptr;
-						if (msg)
-						{
-							prevTunnelID = tunnelID;
-							prevTunnel = tunnel;
-							numMsgs++;
-						}
-						else if (tunnel)
-							tunnel->FlushTunnelDataMsgs ();
 					}
-					while (msg);
+					if (prevTunnel) prevTunnel->FlushTunnelDataMsgs ();
+					msgs.clear ();
 				}
 
 				if (i2p::transport::transports.IsOnline())
 				{
 					uint64_t ts = i2p::util::GetSecondsSinceEpoch ();
+					ManageTransitTunnels (ts); // due timers only
+					if (ts != lastBandwidthTs)
+					{
+						UpdateTransitTunnelBandwidthLimit ();
+						lastBandwidthTs = ts;
+					}
 					if (ts - lastTs >= TUNNEL_MANAGE_INTERVAL || // manage tunnels every 15 seconds
 					    ts + TUNNEL_MANAGE_INTERVAL < lastTs)
 					{
@@ -568,6 +589,7 @@ namespace tunnel
 			catch (std::exception& ex)
 			{
 				LogPrint (eLogError, "Tunnel: Runtime exception: ", ex.what ());
+				msgs.clear ();
 			}
 		}
 	}
@@ -600,7 +622,6 @@ namespace tunnel
 		ManagePendingTunnels (ts);
 		ManageInboundTunnels (ts);
 		ManageOutboundTunnels (ts);
-		ManageTransitTunnels (ts);
 	}
 
 	void Tunnels::ManagePendingTunnels (uint64_t ts)
@@ -791,21 +812,44 @@ namespace tunnel
 
 	void Tunnels::ManageTransitTunnels (uint64_t ts)
 	{
-		for (auto it = m_TransitTunnels.begin (); it != m_TransitTunnels.end ();)
-		{
-			auto tunnel = *it;
-			if (ts > tunnel->GetCreationTime () + TUNNEL_EXPIRATION_TIMEOUT ||
-			    ts + TUNNEL_EXPIRATION_TIMEOUT < tunnel->GetCreationTime ())
-			{
-				LogPrint (eLogDebug, "Tunnel: Transit tunnel with id ", tunnel->GetTunnelID (), " expired");
-				m_Tunnels.erase (tunnel->GetTunnelID ());
-				it = m_TransitTunnels.erase (it);
-			}
-			else
+		bool cleanup = m_TransitTunnelsWorkers.empty (); // otherwise cleaned up by worker's thread
+		m_TransitTunnelsTimers.Expire (ts, [this, ts, cleanup](std::list<std::shared_ptr<TransitTunnel> >::iterator it, uint64_t)
 			{
-				tunnel->Cleanup ();
-				it++;
-			}
+				auto tunnel = *it;
+				if (ts > tunnel->GetCreationTime () + TUNNEL_EXPIRATION_TIMEOUT ||
+				    ts + TUNNEL_EXPIRATION_TIMEOUT < tunnel->GetCreationTime ())
+				{
+					LogPrint (eLogDebug, "Tunnel: Transit tunnel with id ", tunnel->GetTunnelID (), " expired");
+					m_Tunnels.erase (tunnel->GetTunnelID ());
+					m_TransitTunnels.erase (it);
+				}
+				else
+				{
+					if (cleanup) tunnel->Cleanup ();
+					m_TransitTunnelsTimers.Add (GetNextTransitTunnelTimer (tunnel, ts, cleanup), it);
+				}
+			});
+	}
+
+	void Tunnels::UpdateTransitTunnelBandwidthLimit ()
+	{
+		uint32_t numActive = m_NumActiveTransitTunnels.exchange (0);
+		m_NumLastActiveTransitTunnels = numActive;
+		uint64_t limit = i2p::context.GetTransitBandwidthLimit () * 1024; // convert to bytes
+		// 15 seconds average keeps tunnels limited for a while after drops
+		uint64_t bw = std::max (i2p::transport::transports.GetTransitBandwidth (), i2p::transport::transports.GetTransitBandwidth15s ());
+		if (!limit || bw * 100 < limit * TRANSIT_TUNNELS_CONGESTION_THRESHOLD)
+			m_TransitTunnelBandwidthLimit = 0; // enough headroom
+		else
+		{
+			// active tunnels share transit bandwidth, idle ones don't need it
+			uint64_t share = TRANSIT_TUNNEL_BANDWIDTH_SHARE_FACTOR * limit / (numActive ? numActive : 1);
+			if (share > limit) share = limit;
+			if (share < TRANSIT_TUNNEL_MIN_BANDWIDTH) share = TRANSIT_TUNNEL_MIN_BANDWIDTH;
+			if (!m_TransitTunnelBandwidthLimit)
+				LogPrint (eLogInfo, "Tunnel: Transit bandwidth per tunnel is limited to ", share/1024, " KBps for ",
+					numActive, " active tunnels");
+			m_TransitTunnelBandwidthLimit = share;
 		}
 	}
 
@@ -821,12 +865,45 @@ namespace tunnel
 
 	void Tunnels::PostTunnelData (std::shared_ptr<I2NPMessage> msg)
 	{
-		if (msg) m_Queue.Put (msg);
+		if (!msg) return;
+		if (!m_TransitTunnelsWorkers.empty ())
+		{
+			auto typeID = msg->GetTypeID ();
+			if (typeID == eI2NPTunnelData || typeID == eI2NPTunnelGateway)
+			{
+				// messages of the same tunnel always go to the same worker
+				m_TransitTunnelsWorkers[bufbe32toh (msg->GetPayload ()) % m_TransitTunnelsWorkers.size ()]->PostTunnelData (msg);
+				return;
+			}
+		}
+		m_Queue.Put (msg);
 	}
 
 	void Tunnels::PostTunnelData (const std::vector<std::shared_ptr<I2NPMessage> >& msgs)
 	{
-		m_Queue.Put (msgs);
+		if (m_TransitTunnelsWorkers.empty ())
+			m_Queue.Put (msgs);
+		else
+			PostTunnelDataToWorkers (msgs);
+	}
+
+	void Tunnels::PostTunnelDataToWorkers (const std::vector<std::shared_ptr<I2NPMessage> >& msgs)
+	{
+		auto numWorkers = m_TransitTunnelsWorkers.size ();
+		std::vector<std::vector<std::shared_ptr<I2NPMessage> > > workersMsgs (numWorkers);
+		std::vector<std::shared_ptr<I2NPMessage> > otherMsgs;
+		for (const auto& it: msgs)
+		{
+			if (!it) continue;
+			auto typeID = it->GetTypeID ();
+			if (typeID == eI2NPTunnelData || typeID == eI2NPTunnelGateway)
+				workersMsgs[bufbe32toh (it->GetPayload ()) % numWorkers].push_back (it);
+			else
+				otherMsgs.push_back (it);
+		}
+		for (size_t i = 0; i < numWorkers; i++)
+			m_TransitTunnelsWorkers[i]->PostTunnelData (workersMsgs[i]);
+		m_Queue.Put (otherMsgs);
 	}
 
 	template<class TTunnel>
@@ -957,6 +1034,22 @@ namespace tunnel
 		return timeout;
 	}
 
+	int Tunnels::GetQueueSize ()
+	{
+		int size = m_Queue.GetSize ();
+		for (auto& it: m_TransitTunnelsWorkers)
+			size += it->GetQueueSize ();
+		return size;
+	}
+
+	size_t Tunnels::GetQueueMaxSize ()
+	{
+		size_t size = m_Queue.GetMaxSize ();
+		for (auto& it: m_TransitTunnelsWorkers)
+			size = std::max (size, it->GetQueueMaxSize ());
+		return size;
+	}
+
 	size_t Tunnels::CountTransitTunnels() const
 	{
 		// TODO: locking
@@ -983,5 +1076,154 @@ namespace tunnel
 			m_MaxNumTransitTunnels = maxNumTransitTunnels;
 		}
 	}
+
+	void Tunnels::SetNumTransitTunnelsThreads (int numThreads)
+	{
+		if (m_IsRunning) return;
+		if (numThreads > MAX_NUM_TRANSIT_TUNNELS_THREADS) numThreads = MAX_NUM_TRANSIT_TUNNELS_THREADS;
+		m_TransitTunnelsWorkers.clear ();
+		if (numThreads > 1)
+		{
+			LogPrint (eLogInfo, "Tunnel: Transit tunnels are handled by ", numThreads, " threads");
+			for (int i = 0; i < numThreads; i++)
+				m_TransitTunnelsWorkers.emplace_back (new TransitTunnelsWorker (*this, i));
+		}
+	}
+
+	TransitTunnelsWorker::TransitTunnelsWorker (Tunnels& owner, int index):
+		m_Owner (owner), m_Index (index), m_IsRunning (false), m_HasPendingTunnels (false)
+	{
+	}
+
+	TransitTunnelsWorker::~TransitTunnelsWorker ()
+	{
+		Stop ();
+	}
+
+	void TransitTunnelsWorker::Start ()
+	{
+		if (!m_IsRunning)
+		{
+			m_IsRunning = true;
+			m_Thread.reset (new std::thread (std::bind (&TransitTunnelsWorker::Run, this)));
+		}
+	}
+
+	void TransitTunnelsWorker::Stop ()
+	{
+		if (m_IsRunning)
+		{
+			m_IsRunning = false;
+			m_Queue.WakeUp ();
+			if (m_Thread)
+			{
+				m_Thread->join ();
+				m_Thread = nullptr;
+			}
+			m_TransitTunnels.clear ();
+			m_TransitTunnelsTimers.Clear ();
+		}
+	}
+
+	void TransitTunnelsWorker::AddTransitTunnel (std::shared_ptr<TransitTunnel> tunnel)
+	{
+		std::unique_lock<std::mutex> l(m_PendingTunnelsMutex);
+		m_PendingTunnels.push_back (tunnel);
+		m_HasPendingTunnels = true;
+	}
+
+	void TransitTunnelsWorker::AddPendingTunnels ()
+	{
+		std::vector<std::shared_ptr<TransitTunnel> > tunnels;
+		{
+			std::unique_lock<std::mutex> l(m_PendingTunnelsMutex);
+			m_PendingTunnels.swap (tunnels);
+			m_HasPendingTunnels = false;
+		}
+		auto ts = i2p::util::GetSecondsSinceEpoch ();
+		for (auto& it: tunnels)
+			if (m_TransitTunnels.emplace (it->GetTunnelID (), it).second)
+				m_TransitTunnelsTimers.Add (GetNextTransitTunnelTimer (it, ts, true), it);
+	}
+
+	void TransitTunnelsWorker::Run ()
+	{
+		i2p::util::SetThreadName (("Transit" + std::to_string (m_Index)).c_str ());
+
+		std::vector<std::shared_ptr<I2NPMessage> > msgs, otherMsgs; // otherMsgs are for tunnels thread
+		while (m_IsRunning)
+		{
+			try
+			{
+				m_Queue.GetAllWithTimeout (msgs, 1000); // 1 sec
+				if (m_HasPendingTunnels) AddPendingTunnels ();
+				if (!msgs.empty ())
+				{
+					uint32_t prevTunnelID = 0;
+					std::shared_ptr<TransitTunnel> prevTunnel;
+					for (auto& msg: msgs)
+					{
+						uint32_t tunnelID = bufbe32toh (msg->GetPayload ());
+						std::shared_ptr<TransitTunnel> tunnel;
+						if (prevTunnel && tunnelID == prevTunnelID)
+							tunnel = prevTunnel;
+						else
+						{
+							if (prevTunnel) prevTunnel->FlushTunnelDataMsgs ();
+							auto it = m_TransitTunnels.find (tunnelID);
+							if (it == m_TransitTunnels.end () && m_HasPendingTunnels)
+							{
+								// tunnel might be added after we started this batch
+								AddPendingTunnels ();
+								it = m_TransitTunnels.find (tunnelID);
+							}
+							if (it != m_TransitTunnels.end ())
+								tunnel = it->second;
+						}
+						if (tunnel)
+						{
+							if (msg->GetTypeID () == eI2NPTunnelData)
+								tunnel->HandleTunnelDataMsg (std::move (msg));
+							else // tunnel gateway assumed
+								Tunnels::HandleTunnelGatewayMsg (tunnel, msg);
+						}
+						else
+							otherMsgs.push_back (std::move (msg)); // not a transit tunnel or unknown
+						prevTunnelID = tunnelID;
+						prevTunnel = tunnel;
+					}
+					if (prevTunnel) prevTunnel->FlushTunnelDataMsgs ();
+					msgs.clear ();
+					if (!otherMsgs.empty ())
+					{
+						m_Owner.m_Queue.Put (otherMsgs);
+						otherMsgs.clear ();
+					}
+				}
+
+				ManageTransitTunnels (i2p::util::GetSecondsSinceEpoch ()); // due timers only
+			}
+			catch (std::exception& ex)
+			{
+				LogPrint (eLogError, "Tunnel: Transit tunnels worker ", m_Index, " runtime exception: ", ex.what ());
+				msgs.clear (); otherMsgs.clear ();
+			}
+		}
+	}
+
+	void TransitTunnelsWorker::ManageTransitTunnels (uint64_t ts)
+	{
+		m_TransitTunnelsTimers.Expire (ts, [this, ts](std::shared_ptr<TransitTunnel> tunnel, uint64_t)
+			{
+				if (ts > tunnel->GetCreationTime () + TUNNEL_EXPIRATION_TIMEOUT ||
+					ts + TUNNEL_EXPIRATION_TIMEOUT < tunnel->GetCreationTime ())
+					m_TransitTunnels.erase (tunnel->GetTunnelID ()); // removed from m_Tunnels by tunnels thread
+				else
+				{
+					tunnel->Cleanup ();
+					m_TransitTunnelsTimers.Add (GetNextTransitTunnelTimer (tunnel, ts, true), tunnel);
+				}
+			});
+	}
 }
 }
@@ -18,8 +18,10 @@
 #include <thread>
 #include <mutex>
 #include <memory>
+#include <atomic>
 #include "util.h"
 #include "Queue.h"
+#include "TimerWheel.h"
 #include "Crypto.h"
 #include "TunnelConfig.h"
 #include "TunnelPool.h"
@@ -41,11 +43,11 @@ namespace tunnel
 	const int MAX_NUM_RECORDS = 8;
 	const int UNKNOWN_LATENCY = -1;
 	const int HIGH_LATENCY_PER_HOP = 250000; // in microseconds
-	const int MAX_TUNNEL_MSGS_BATCH_SIZE = 100; // handle messages without interrupt
 	const uint16_t DEFAULT_MAX_NUM_TRANSIT_TUNNELS = 5000;
 	const int TUNNEL_MANAGE_INTERVAL = 15; // in seconds
 	const int TUNNEL_POOLS_MANAGE_INTERVAL = 5; // in seconds
 	const int TUNNEL_MEMORY_POOL_MANAGE_INTERVAL = 120; // in seconds
+	const int MAX_NUM_TRANSIT_TUNNELS_THREADS = 64;
 
 	const size_t I2NP_TUNNEL_MESSAGE_SIZE = TUNNEL_DATA_MSG_SIZE + I2NP_HEADER_SIZE + 34; // reserved for alignment and NTCP 16 + 6 + 12
 	const size_t I2NP_TUNNEL_ENPOINT_MESSAGE_SIZE = 2*TUNNEL_DATA_MSG_SIZE + I2NP_HEADER_SIZE + TUNNEL_GATEWAY_HEADER_SIZE + 28; // reserved for alignment and NTCP 16 + 6 + 6
@@ -207,6 +209,42 @@ namespace tunnel
 			size_t m_NumSentBytes;
 	};
 
+	class Tunnels;
+	class TransitTunnelsWorker
+	{
+		public:
+
+			TransitTunnelsWorker (Tunnels& owner, int index);
+			~TransitTunnelsWorker ();
+			void Start ();
+			void Stop ();
+
+			void AddTransitTunnel (std::shared_ptr<TransitTunnel> tunnel);
+			void PostTunnelData (std::shared_ptr<I2NPMessage> msg) { m_Queue.Put (msg); };
+			void PostTunnelData (const std::vector<std::shared_ptr<I2NPMessage> >& msgs) { m_Queue.Put (msgs); };
+			int GetQueueSize () { return m_Queue.GetSize (); };
+			size_t GetQueueMaxSize () const { return m_Queue.GetMaxSize (); };
+
+		private:
+
+			void Run ();
+			void AddPendingTunnels ();
+			void ManageTransitTunnels (uint64_t ts);
+
+		private:
+
+			Tunnels& m_Owner;
+			int m_Index;
+			volatile bool m_IsRunning;
+			std::unique_ptr<std::thread> m_Thread;
+			i2p::util::Queue<std::shared_ptr<I2NPMessage> > m_Queue;
+			std::unordered_map<uint32_t, std::shared_ptr<TransitTunnel> > m_TransitTunnels; // accessed from worker's thread only
+			i2p::util::TimerWheel<std::shared_ptr<TransitTunnel>, 1024, TUNNEL_EXPIRATION_TIMEOUT> m_TransitTunnelsTimers; // expiration and endpoints cleanup
+			std::mutex m_PendingTunnelsMutex;
+			std::vector<std::shared_ptr<TransitTunnel> > m_PendingTunnels; // added but not picked up by worker yet
+			std::atomic<bool> m_HasPendingTunnels;
+	};
+
 	class Tunnels
 	{
 		public:
@@ -240,8 +278,12 @@ namespace tunnel
 			std::shared_ptr<I2NPMessage> NewI2NPTunnelMessage (bool endpoint);
 
 			void SetMaxNumTransitTunnels (uint32_t maxNumTransitTunnels);
+			void SetNumTransitTunnelsThreads (int numThreads); // must be called before Start
 			uint32_t GetMaxNumTransitTunnels () const { return m_MaxNumTransitTunnels; };
 			int GetCongestionLevel() const { return m_MaxNumTransitTunnels ? CONGESTION_LEVEL_FULL * m_TransitTunnels.size() / m_MaxNumTransitTunnels : CONGESTION_LEVEL_FULL; }
+			uint32_t GetNumLastActiveTransitTunnels () const { return m_NumLastActiveTransitTunnels; }; // during previous second
+			uint32_t GetTransitTunnelBandwidthLimit () const { return m_TransitTunnelBandwidthLimit; }; // per tunnel, 0 if unlimited
+			void TransitTunnelActive () { m_NumActiveTransitTunnels++; }; // called by transit tunnel once per second of traffic
 
 		private:
 
@@ -252,13 +294,15 @@ namespace tunnel
 			template<class TTunnel>
 			std::shared_ptr<TTunnel> GetPendingTunnel (uint32_t replyMsgID, const std::map<uint32_t, std::shared_ptr<TTunnel> >& pendingTunnels);
 
-			void HandleTunnelGatewayMsg (std::shared_ptr<TunnelBase> tunnel, std::shared_ptr<I2NPMessage> msg);
+			static void HandleTunnelGatewayMsg (std::shared_ptr<TunnelBase> tunnel, std::shared_ptr<I2NPMessage> msg);
+			void PostTunnelDataToWorkers (const std::vector<std::shared_ptr<I2NPMessage> >& msgs);
 
 			void Run ();
 			void ManageTunnels (uint64_t ts);
 			void ManageOutboundTunnels (uint64_t ts);
 			void ManageInboundTunnels (uint64_t ts);
 			void ManageTransitTunnels (uint64_t ts);
+			void UpdateTransitTunnelBandwidthLimit ();
 			void ManagePendingTunnels (uint64_t ts);
 			template<class PendingTunnels>
 			void ManagePendingTunnels (PendingTunnels& pendingTunnels, uint64_t ts);
@@ -294,14 +338,18 @@ namespace tunnel
 			std::list<std::shared_ptr<InboundTunnel> > m_InboundTunnels;
 			std::list<std::shared_ptr<OutboundTunnel> > m_OutboundTunnels;
 			std::list<std::shared_ptr<TransitTunnel> > m_TransitTunnels;
+			i2p::util::TimerWheel<std::list<std::shared_ptr<TransitTunnel> >::iterator, 1024, TUNNEL_EXPIRATION_TIMEOUT> m_TransitTunnelsTimers; // expiration and endpoints cleanup
 			std::unordered_map<uint32_t, std::shared_ptr<TunnelBase> > m_Tunnels; // tunnelID->tunnel known by this id
 			std::mutex m_PoolsMutex;
 			std::list<std::shared_ptr<TunnelPool>> m_Pools;
 			std::shared_ptr<TunnelPool> m_ExploratoryPool;
 			i2p::util::Queue<std::shared_ptr<I2NPMessage> > m_Queue;
+			std::vector<std::unique_ptr<TransitTunnelsWorker> > m_TransitTunnelsWorkers; // transit tunnels data by tunnelID, empty if handled by tunnels thread
 			i2p::util::MemoryPoolMt<I2NPMessageBuffer<I2NP_TUNNEL_ENPOINT_MESSAGE_SIZE> > m_I2NPTunnelEndpointMessagesMemoryPool;
 			i2p::util::MemoryPoolMt<I2NPMessageBuffer<I2NP_TUNNEL_MESSAGE_SIZE> > m_I2NPTunnelMessagesMemoryPool;
 			uint32_t m_MaxNumTransitTunnels;
+			std::atomic<uint32_t> m_NumActiveTransitTunnels, m_TransitTunnelBandwidthLimit;
+			std::atomic<uint32_t> m_NumLastActiveTransitTunnels; // during previous second
 			// count of tunnels for total TCSR algorithm
 			int m_TotalNumSuccesiveTunnelCreations, m_TotalNumFailedTunnelCreations;
 			double m_TunnelCreationSuccessRate;
@@ -318,7 +366,8 @@ namespace tunnel
 			size_t CountInboundTunnels() const;
 			size_t CountOutboundTunnels() const;
 
-			int GetQueueSize () { return m_Queue.GetSize (); };
+			int GetQueueSize ();
+			size_t GetQueueMaxSize ();
 			int GetTunnelCreationSuccessRate () const { return std::round(m_TunnelCreationSuccessRate * 100); } // in percents
 			double GetPreciseTunnelCreationSuccessRate () const { return m_TunnelCreationSuccessRate * 100; } // in percents
 			int GetTotalTunnelCreationSuccessRate () const // in percents
@@ -326,6 +375,8 @@ namespace tunnel
 				int totalNum = m_TotalNumSuccesiveTunnelCreations + m_TotalNumFailedTunnelCreations;
 				return totalNum ? m_TotalNumSuccesiveTunnelCreations*100/totalNum : 0;
 			}
+
+		friend class TransitTunnelsWorker;
 	};
 
 	extern Tunnels tunnels;
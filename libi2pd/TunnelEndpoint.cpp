@@ -331,13 +331,20 @@ namespace tunnel
 			break;
 			case eDeliveryTypeTunnel:
 				if (!m_IsInbound) // outbound transit tunnel
-					i2p::transport::transports.SendMessage (msg.hash, i2p::CreateTunnelGatewayMsg (msg.tunnelID, msg.data));
+				{
+					auto tunnelGatewayMsg = i2p::CreateTunnelGatewayMsg (msg.tunnelID, msg.data);
+					tunnelGatewayMsg->isTransit = true;
+					i2p::transport::transports.SendMessage (msg.hash, tunnelGatewayMsg);
+				}
 				else
 					LogPrint (eLogError, "TunnelMessage: Delivery type 'tunnel' arrived from an inbound tunnel, dropped");
 			break;
 			case eDeliveryTypeRouter:
 				if (!m_IsInbound) // outbound transit tunnel
+				{
+					msg.data->isTransit = true;
 					i2p::transport::transports.SendMessage (msg.hash, msg.data);
+				}
 				else // we shouldn't send this message. possible leakage
 					LogPrint (eLogError, "TunnelMessage: Delivery type 'router' arrived from an inbound tunnel, dropped");
 			break;
@@ -45,8 +45,8 @@ namespace tunnel
 	{
 		public:
 
-			TunnelGateway (TunnelBase * tunnel):
-				m_Tunnel (tunnel), m_NumSentBytes (0) {};
+			TunnelGateway (TunnelBase * tunnel, bool isTransit = false):
+				m_Tunnel (tunnel), m_IsTransit (isTransit), m_NumSentBytes (0) {};
 			void SendTunnelDataMsg (const TunnelMessageBlock& block);
 			void PutTunnelDataMsg (const TunnelMessageBlock& block);
 			void SendBuffer ();
@@ -55,6 +55,7 @@ namespace tunnel
 		private:
 
 			TunnelBase * m_Tunnel;
+			bool m_IsTransit;
 			TunnelGatewayBuffer m_Buffer;
 			size_t m_NumSentBytes;
 	};
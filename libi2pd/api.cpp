@@ -16,6 +16,7 @@
 #include "RouterContext.h"
 #include "Identity.h"
 #include "Destination.h"
+#include "Garlic.h"
 #include "Crypto.h"
 #include "FS.h"
 #include "api.h"
@@ -71,11 +72,14 @@ namespace api
 		i2p::tunnel::tunnels.Start();
 		LogPrint(eLogInfo, "API: Starting Router context");
 		i2p::context.Start();
+		uint16_t garlicThreads; i2p::config::GetOption("limits.garlicthreads", garlicThreads);
+		i2p::garlic::workers.Start (garlicThreads);
 	}
 
 	void StopI2P ()
 	{
 		LogPrint(eLogInfo, "API: Shutting down");
+		i2p::garlic::workers.Stop ();
 		LogPrint(eLogInfo, "API: Stopping Router context");
 		i2p::context.Stop();
 		LogPrint(eLogInfo, "API: Stopping Tunnels");
@@ -1,5 +1,5 @@
 /*
-* Copyright (c) 2013-2023, The PurpleI2P Project
+* Copyright (c) 2013-2024, The PurpleI2P Project
 *
 * This file is part of Purple i2pd project and licensed under BSD3
 *
@@ -9,6 +9,8 @@
 #include <cstdlib>
 #include <string>
 #include <unordered_set>
+#include <list>
+#include <atomic>
 #include <boost/asio.hpp>
 
 #include "util.h"
@@ -131,6 +133,48 @@ namespace i2p
 namespace util
 {
 
+	struct MemoryPoolsRegistry
+	{
+		std::mutex mutex;
+		std::list<std::pair<std::string, MemoryPoolStatsProvider *> > pools;
+	};
+
+	static MemoryPoolsRegistry& GetMemoryPoolsRegistry ()
+	{
+		static MemoryPoolsRegistry registry; // pools are members of global objects
+		return registry;
+	}
+
+	void RegisterMemoryPool (const std::string& name, MemoryPoolStatsProvider * pool)
+	{
+		auto& registry = GetMemoryPoolsRegistry ();
+		std::lock_guard<std::mutex> l(registry.mutex);
+		registry.pools.emplace_back (name, pool);
+	}
+
+	void UnregisterMemoryPool (MemoryPoolStatsProvider * pool)
+	{
+		auto& registry = GetMemoryPoolsRegistry ();
+		std::lock_guard<std::mutex> l(registry.mutex);
+		registry.pools.remove_if ([pool](const std::pair<std::string, MemoryPoolStatsProvider *>& it)
+			{ return it.second == pool; });
+	}
+
+	void VisitMemoryPools (std::function<void (const std::string& name, const MemoryPoolStats& stats)> v)
+	{
+		auto& registry = GetMemoryPoolsRegistry ();
+		std::lock_guard<std::mutex> l(registry.mutex);
+		for (auto& it: registry.pools)
+			v (it.first, it.second->GetStats ());
+	}
+
+	int GetMemoryPoolShardIndex ()
+	{
+		static std::atomic<int> numThreads (0);
+		static thread_local int index = (numThreads++) % MEMORY_POOL_NUM_SHARDS;
+		return index;
+	}
+
 	void RunnableService::StartIOService ()
 	{
 		if (!m_IsRunning)
@@ -171,6 +215,93 @@ namespace util
 		}
 	}
 
+	void ThreadPool::Start (int numThreads)
+	{
+		if (m_IsRunning || numThreads <= 0) return;
+		m_IsRunning = true;
+		for (int i = 0; i < numThreads; i++)
+			m_Threads.emplace_back (new std::thread (std::bind (&ThreadPool::RunWorker, this)));
+	}
+
+	void ThreadPool::Stop ()
+	{
+		if (!m_IsRunning) return;
+		{
+			std::unique_lock<std::mutex> l(m_Mutex);
+			m_IsRunning = false;
+		}
+		m_JobsAvailable.notify_all ();
+		for (auto& it: m_Threads)
+			it->join ();
+		m_Threads.clear ();
+	}
+
+	void ThreadPool::Run (const std::vector<Job>& jobs)
+	{
+		if (jobs.empty ()) return;
+		if (!m_IsRunning || jobs.size () == 1)
+		{
+			for (auto& it: jobs) it ();
+			return;
+		}
+		std::unique_lock<std::mutex> runLock(m_RunMutex);
+		{
+			std::unique_lock<std::mutex> l(m_Mutex);
+			m_Jobs = &jobs;
+			m_Generation++;
+			m_NextJob = 0;
+			m_NumCompletedJobs = 0;
+		}
+		m_JobsAvailable.notify_all ();
+		RunJobs (jobs);
+		std::unique_lock<std::mutex> l(m_Mutex);
+		// workers might still hold pointer to jobs
+		m_JobsComplete.wait (l, [this, &jobs]() { return m_NumCompletedJobs >= jobs.size () && !m_NumActive; });
+		m_Jobs = nullptr;
+	}
+
+	void ThreadPool::RunJobs (const std::vector<Job>& jobs)
+	{
+		for (;;)
+		{
+			size_t ind = m_NextJob++;
+			if (ind >= jobs.size ()) break;
+			try
+			{
+				jobs[ind] ();
+			}
+			catch (std::exception& ex)
+			{
+				LogPrint (eLogError, m_Name, ": Runtime exception: ", ex.what ());
+			}
+			m_NumCompletedJobs++;
+		}
+	}
+
+	void ThreadPool::RunWorker ()
+	{
+		SetThreadName (m_Name.c_str ());
+		uint64_t generation = 0;
+		for (;;)
+		{
+			const std::vector<Job> * jobs = nullptr;
+			{
+				std::unique_lock<std::mutex> l(m_Mutex);
+				m_JobsAvailable.wait (l, [this, generation]() { return !m_IsRunning || (m_Jobs && m_Generation != generation); });
+				if (!m_IsRunning) break;
+				generation = m_Generation;
+				jobs = m_Jobs;
+				m_NumActive++;
+			}
+			RunJobs (*jobs);
+			{
+				std::unique_lock<std::mutex> l(m_Mutex);
+				m_NumActive--;
+			}
+			m_JobsComplete.notify_all ();
+		}
+	}
+
 	void SetThreadName (const char *name) {
 #if defined(__APPLE__)
 # if (!defined(MAC_OS_X_VERSION_10_6) || \
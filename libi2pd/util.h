@@ -1,5 +1,5 @@
 /*
-* Copyright (c) 2013-2022, The PurpleI2P Project
+* Copyright (c) 2013-2024, The PurpleI2P Project
 *
 * This file is part of Purple i2pd project and licensed under BSD3
 *
@@ -9,11 +9,15 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <inttypes.h>
 #include <string>
+#include <vector>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <condition_variable>
+#include <atomic>
 #include <utility>
 #include <boost/asio.hpp>
 
@@ -111,32 +115,108 @@ namespace util
 			T * m_Head;
 	};
 
+	const int MEMORY_POOL_NUM_SHARDS = 8; // threads are spread among shards
+	const size_t MEMORY_POOL_MAGAZINE_SIZE = 64; // objects moved between shards at once
+	const size_t MEMORY_POOL_THREAD_CACHE_SIZE = 16; // objects moved between thread cache and shard at once
+	const size_t MEMORY_POOL_CACHE_LINE_SIZE = 64;
+
+	struct MemoryPoolStats
+	{
+		size_t objectSize;
+		size_t numLive; // acquired but not released yet
+		size_t numCached; // free objects kept by pool
+		uint64_t numHits, numMisses; // acquired from pool or allocated
+	};
+
+	class MemoryPoolStatsProvider
+	{
+		public:
+
+			virtual ~MemoryPoolStatsProvider () {};
+			virtual MemoryPoolStats GetStats () = 0;
+	};
+
+	// named pools for web console
+	void RegisterMemoryPool (const std::string& name, MemoryPoolStatsProvider * pool);
+	void UnregisterMemoryPool (MemoryPoolStatsProvider * pool);
+	void VisitMemoryPools (std::function<void (const std::string& name, const MemoryPoolStats& stats)> v);
+	int GetMemoryPoolShardIndex (); // of current thread
+
 	template<class T>
-	class MemoryPoolMt: private MemoryPool<T>
+	class MemoryPoolMt: public MemoryPoolStatsProvider
 	{
+		// each thread takes and puts free objects to own small cache without locking,
+		// cache is refilled from and drained to thread's shard by MEMORY_POOL_THREAD_CACHE_SIZE objects,
+		// full magazines of free objects are moved through depot from releasing to acquiring shards
+		struct alignas(MEMORY_POOL_CACHE_LINE_SIZE) Shard // shards of different threads don't share cache lines
+		{
+			Shard (): head (nullptr), count (0), numAcquired (0), numReleased (0), numHits (0) {};
+
+			std::mutex mutex;
+			T * head;
+			size_t count;
+			std::atomic<uint64_t> numAcquired, numReleased, numHits;
+		};
+
+		struct ThreadCache
+		{
+			// objects of the same type are interchangeable, so cache is shared by all pools of T
+			// and doesn't depend on pool's lifetime
+			ThreadCache (): head (nullptr), count (0) {};
+			~ThreadCache () { CleanUp (head); };
+
+			T * head;
+			size_t count;
+		};
+
 		public:
 
-			MemoryPoolMt () {}
+			MemoryPoolMt (): m_IsRegistered (false) {}
+			MemoryPoolMt (const std::string& name): m_IsRegistered (true) { RegisterMemoryPool (name, this); }
+			~MemoryPoolMt ()
+			{
+				if (m_IsRegistered) UnregisterMemoryPool (this);
+				CleanUpMt ();
+			}
+
 			template<typename... TArgs>
 			T * AcquireMt (TArgs&&... args)
 			{
-				if (!this->m_Head) return new T(std::forward<TArgs>(args)...);
-				std::lock_guard<std::mutex> l(m_Mutex);
-				return this->Acquire (std::forward<TArgs>(args)...);
+				auto& shard = m_Shards[GetMemoryPoolShardIndex ()];
+				shard.numAcquired.fetch_add (1, std::memory_order_relaxed);
+				auto& cache = GetThreadCache ();
+				if (!cache.head) Refill (shard, cache);
+				if (!cache.head) return new T(std::forward<TArgs>(args)...);
+				T * t = cache.head;
+				cache.head = Next (t);
+				cache.count--;
+				shard.numHits.fetch_add (1, std::memory_order_relaxed);
+				return new (t)T(std::forward<TArgs>(args)...);
 			}
 
 			void ReleaseMt (T * t)
 			{
-				std::lock_guard<std::mutex> l(m_Mutex);
-				this->Release (t);
+				if (!t) return;
+				t->~T ();
+				auto& shard = m_Shards[GetMemoryPoolShardIndex ()];
+				shard.numReleased.fetch_add (1, std::memory_order_relaxed);
+				PutToThreadCache (shard, GetThreadCache (), t);
 			}
 
 			template<template<typename, typename...>class C, typename... R>
 			void ReleaseMt(const C<T *, R...>& c)
 			{
-				std::lock_guard<std::mutex> l(m_Mutex);
+				auto& shard = m_Shards[GetMemoryPoolShardIndex ()];
+				auto& cache = GetThreadCache ();
+				uint64_t numReleased = 0;
 				for (auto& it: c)
-					this->Release (it);
+				{
+					if (!it) continue;
+					it->~T ();
+					numReleased++;
+					PutToThreadCache (shard, cache, it);
+				}
+				shard.numReleased.fetch_add (numReleased, std::memory_order_relaxed);
 			}
 
 			template<typename... TArgs>
@@ -148,18 +228,139 @@ namespace util
 
 			void CleanUpMt ()
 			{
-				T * head;
+				// threads' caches are not touched, they are small and freed at thread exit
+				for (auto& shard: m_Shards)
+				{
+					T * head;
+					{
+						std::lock_guard<std::mutex> l(shard.mutex);
+						head = shard.head;
+						shard.head = nullptr;
+						shard.count = 0;
+					}
+					CleanUp (head);
+				}
+				std::vector<T *> magazines;
+				{
+					std::lock_guard<std::mutex> l(m_DepotMutex);
+					m_Magazines.swap (magazines);
+				}
+				for (auto it: magazines)
+					CleanUp (it);
+			}
+
+			MemoryPoolStats GetStats () override
+			{
+				// objects in threads' caches are not counted as cached
+				MemoryPoolStats stats{sizeof (T), 0, 0, 0, 0};
+				uint64_t numAcquired = 0, numReleased = 0;
+				for (auto& shard: m_Shards)
+				{
+					numAcquired += shard.numAcquired.load (std::memory_order_relaxed);
+					numReleased += shard.numReleased.load (std::memory_order_relaxed);
+					stats.numHits += shard.numHits.load (std::memory_order_relaxed);
+					std::lock_guard<std::mutex> l(shard.mutex);
+					stats.numCached += shard.count;
+				}
 				{
-					std::lock_guard<std::mutex> l(m_Mutex);
-					head = this->m_Head;
-					this->m_Head = nullptr;
+					std::lock_guard<std::mutex> l(m_DepotMutex);
+					stats.numCached += m_Magazines.size ()*MEMORY_POOL_MAGAZINE_SIZE;
 				}
-				if (head) this->CleanUp (head);
+				stats.numLive = numAcquired > numReleased ? numAcquired - numReleased : 0;
+				stats.numMisses = numAcquired > stats.numHits ? numAcquired - stats.numHits : 0;
+				return stats;
 			}
 
 		private:
 
-			std::mutex m_Mutex;
+			static T * Next (T * t) { return static_cast<T*>(*(void * *)t); };
+
+			static ThreadCache& GetThreadCache ()
+			{
+				static thread_local ThreadCache cache;
+				return cache;
+			}
+
+			void Refill (Shard& shard, ThreadCache& cache)
+			{
+				std::lock_guard<std::mutex> l(shard.mutex);
+				if (!shard.head)
+				{
+					// try to get magazine from depot
+					std::lock_guard<std::mutex> l1(m_DepotMutex);
+					if (!m_Magazines.empty ())
+					{
+						shard.head = m_Magazines.back ();
+						shard.count = MEMORY_POOL_MAGAZINE_SIZE;
+						m_Magazines.pop_back ();
+					}
+				}
+				while (shard.head && cache.count < MEMORY_POOL_THREAD_CACHE_SIZE)
+				{
+					T * t = shard.head;
+					shard.head = Next (t);
+					shard.count--;
+					*(void * *)t = cache.head; // next
+					cache.head = t;
+					cache.count++;
+				}
+			}
+
+			void PutToThreadCache (Shard& shard, ThreadCache& cache, T * t)
+			{
+				*(void * *)t = cache.head; // next
+				cache.head = t;
+				cache.count++;
+				if (cache.count >= 2*MEMORY_POOL_THREAD_CACHE_SIZE)
+				{
+					// keep half, move another half to shard
+					std::lock_guard<std::mutex> l(shard.mutex);
+					for (size_t i = 0; i < MEMORY_POOL_THREAD_CACHE_SIZE; i++)
+					{
+						T * t1 = cache.head;
+						cache.head = Next (t1);
+						PutToShard (shard, t1);
+					}
+					cache.count -= MEMORY_POOL_THREAD_CACHE_SIZE;
+				}
+			}
+
+			void PutToShard (Shard& shard, T * t)
+			{
+				*(void * *)t = shard.head; // next
+				shard.head = t;
+				shard.count++;
+				if (shard.count >= 2*MEMORY_POOL_MAGAZINE_SIZE)
+				{
+					// keep one magazine, move another to depot
+					T * last = shard.head;
+					for (size_t i = 1; i < MEMORY_POOL_MAGAZINE_SIZE; i++)
+						last = Next (last);
+					T * magazine = shard.head;
+					shard.head = Next (last);
+					*(void * *)last = nullptr;
+					shard.count -= MEMORY_POOL_MAGAZINE_SIZE;
+					std::lock_guard<std::mutex> l(m_DepotMutex);
+					m_Magazines.push_back (magazine);
+				}
+			}
+
+			static void CleanUp (T * head)
+			{
+				while (head)
+				{
+					auto tmp = head;
+					head = Next (head);
+					::operator delete ((void *)tmp);
+				}
+			}
+
+		private:
+
+			bool m_IsRegistered;
+			Shard m_Shards[MEMORY_POOL_NUM_SHARDS];
+			std::mutex m_DepotMutex;
+			std::vector<T *> m_Magazines; // full magazines, MEMORY_POOL_MAGAZINE_SIZE objects each
 	};
 
 	class RunnableService
@@ -199,6 +400,42 @@ namespace util
 			boost::asio::io_service::work m_Work;
 	};
 
+	class ThreadPool
+	{
+		// runs batches of jobs on own threads and caller's thread
+		public:
+
+			typedef std::function<void ()> Job;
+
+			ThreadPool (const std::string& name): m_Name (name), m_IsRunning (false),
+				m_Jobs (nullptr), m_Generation (0), m_NumActive (0), m_NextJob (0), m_NumCompletedJobs (0) {};
+			~ThreadPool () { Stop (); };
+
+			void Start (int numThreads);
+			void Stop ();
+			size_t GetNumThreads () const { return m_Threads.size (); };
+
+			void Run (const std::vector<Job>& jobs); // returns when all jobs are complete
+
+		private:
+
+			void RunWorker ();
+			void RunJobs (const std::vector<Job>& jobs);
+
+		private:
+
+			std::string m_Name;
+			bool m_IsRunning;
+			std::vector<std::unique_ptr<std::thread> > m_Threads;
+			std::mutex m_RunMutex; // one batch at the time
+			std::mutex m_Mutex;
+			std::condition_variable m_JobsAvailable, m_JobsComplete;
+			const std::vector<Job> * m_Jobs; // current batch
+			uint64_t m_Generation; // of batch
+			int m_NumActive; // workers in current batch
+			std::atomic<size_t> m_NextJob, m_NumCompletedJobs;
+	};
+
 	void SetThreadName (const char *name);
 
 	template<typename T>
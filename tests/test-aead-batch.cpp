@@ -0,0 +1,158 @@
+#include <cassert>
+#include <inttypes.h>
+#include <string.h>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include "Crypto.h"
+
+using namespace i2p::crypto;
+
+struct Packet
+{
+	uint8_t key[32], nonce[12], ad[32];
+	std::vector<uint8_t> plain, encrypted, decrypted;
+};
+
+std::vector<Packet> CreatePackets (int num, size_t size)
+{
+	std::vector<Packet> packets (num);
+	for (auto& it: packets)
+	{
+		RAND_bytes (it.key, 32); RAND_bytes (it.nonce, 12); RAND_bytes (it.ad, 32);
+		it.plain.resize (size); RAND_bytes (it.plain.data (), size);
+		it.encrypted.resize (size + 16);
+		it.decrypted.resize (size);
+	}
+	return packets;
+}
+
+void TestBatch ()
+{
+	auto packets = CreatePackets (50, 1000);
+	std::vector<AEADChaCha20Poly1305Message> msgs;
+	for (auto& it: packets)
+		msgs.push_back ({ it.plain.data (), it.plain.size (), it.ad, 32, it.key, it.nonce, it.encrypted.data (), it.encrypted.size (), false });
+	assert (AEADChaCha20Poly1305Batch (msgs, true) == packets.size ());
+	// same as one by one
+	uint8_t buf[1016];
+	for (auto& it: packets)
+	{
+		assert (AEADChaCha20Poly1305 (it.plain.data (), it.plain.size (), it.ad, 32, it.key, it.nonce, buf, 1016, true));
+		assert (!memcmp (buf, it.encrypted.data (), 1016));
+	}
+	// decrypt with one corrupted
+	packets[7].encrypted[100] ^= 1;
+	msgs.clear ();
+	for (auto& it: packets)
+		msgs.push_back ({ it.encrypted.data (), it.plain.size (), it.ad, 32, it.key, it.nonce, it.decrypted.data (), it.decrypted.size (), false });
+	assert (AEADChaCha20Poly1305Batch (msgs, false) == packets.size () - 1);
+	for (size_t i = 0; i < packets.size (); i++)
+	{
+		assert (msgs[i].result == (i != 7));
+		if (i != 7) assert (packets[i].decrypted == packets[i].plain);
+		assert (AEADChaCha20Poly1305 (packets[i].encrypted.data (), packets[i].plain.size (), packets[i].ad, 32,
+			packets[i].key, packets[i].nonce, buf, 1000, false) == (i != 7));
+	}
+	// encryption in place
+	auto p = packets[0].plain;
+	p.resize (1016);
+	AEADChaCha20Poly1305Message msg { p.data (), 1000, packets[0].ad, 32, packets[0].key, packets[0].nonce, p.data (), p.size (), false };
+	std::vector<AEADChaCha20Poly1305Message> one { msg };
+	assert (AEADChaCha20Poly1305Batch (one, true) == 1 && !memcmp (p.data (), packets[0].encrypted.data (), 100));
+}
+
+bool EncryptWithNewContext (const uint8_t * msg, size_t msgLen, const uint8_t * ad, size_t adLen, const uint8_t * key, const uint8_t * nonce, uint8_t * buf);
+
+void TestForged ()
+{
+	auto packets = CreatePackets (2, 1000);
+	for (auto& it: packets)
+		assert (EncryptWithNewContext (it.plain.data (), 1000, it.ad, 32, it.key, it.nonce, it.encrypted.data ()));
+	for (auto& it: packets)
+	{
+		it.encrypted[100] ^= 1; // ciphertext
+		it.encrypted[1000] ^= 1; // tag
+	}
+	uint8_t buf[1016];
+	// first message of new thread's context
+	bool forged = true;
+	std::thread t ([&packets, &forged]()
+		{
+			uint8_t out[1000];
+			forged = AEADChaCha20Poly1305 (packets[0].encrypted.data (), 1000, packets[0].ad, 32,
+				packets[0].key, packets[0].nonce, out, 1000, false);
+		});
+	t.join ();
+	assert (!forged);
+	// decryption right after encryption
+	assert (AEADChaCha20Poly1305 (packets[1].plain.data (), 1000, packets[1].ad, 32, packets[1].key, packets[1].nonce, buf, 1016, true));
+	assert (!AEADChaCha20Poly1305 (packets[1].encrypted.data (), 1000, packets[1].ad, 32, packets[1].key, packets[1].nonce, buf, 1000, false));
+	// same for batch
+	std::vector<AEADChaCha20Poly1305Message> msgs;
+	msgs.push_back ({ packets[0].plain.data (), 1000, packets[0].ad, 32, packets[0].key, packets[0].nonce, buf, 1016, false });
+	assert (AEADChaCha20Poly1305Batch (msgs, true) == 1);
+	msgs.clear ();
+	msgs.push_back ({ packets[0].encrypted.data (), 1000, packets[0].ad, 32, packets[0].key, packets[0].nonce, buf, 1000, false });
+	assert (AEADChaCha20Poly1305Batch (msgs, false) == 0 && !msgs[0].result);
+}
+
+// previous implementation, new EVP context and cipher lookup for every message
+bool EncryptWithNewContext (const uint8_t * msg, size_t msgLen, const uint8_t * ad, size_t adLen, const uint8_t * key, const uint8_t * nonce, uint8_t * buf)
+{
+	int outlen = 0;
+	EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new ();
+	EVP_EncryptInit_ex(ctx, EVP_chacha20_poly1305(), 0, 0, 0);
+	EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, 12, 0);
+	EVP_EncryptInit_ex(ctx, NULL, NULL, key, nonce);
+	EVP_EncryptUpdate(ctx, NULL, &outlen, ad, adLen);
+	EVP_EncryptUpdate(ctx, buf, &outlen, msg, msgLen);
+	EVP_EncryptFinal_ex(ctx, buf + outlen, &outlen);
+	EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, 16, buf + msgLen);
+	EVP_CIPHER_CTX_free (ctx);
+	return true;
+}
+
+void Benchmark ()
+{
+	const int numPackets = 2000, numRounds = 10;
+	for (size_t size: { 64, 1024, 1500 })
+	{
+		auto packets = CreatePackets (numPackets, size);
+		auto start = std::chrono::steady_clock::now ();
+		for (int r = 0; r < numRounds; r++)
+			for (auto& it: packets)
+				EncryptWithNewContext (it.plain.data (), size, it.ad, 32, it.key, it.nonce, it.encrypted.data ());
+		auto evpTime = std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count ();
+
+		start = std::chrono::steady_clock::now ();
+		for (int r = 0; r < numRounds; r++)
+			for (auto& it: packets)
+				AEADChaCha20Poly1305 (it.plain.data (), size, it.ad, 32, it.key, it.nonce, it.encrypted.data (), size + 16, true);
+		auto singleTime = std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count ();
+
+		std::vector<AEADChaCha20Poly1305Message> msgs;
+		for (auto& it: packets)
+			msgs.push_back ({ it.plain.data (), size, it.ad, 32, it.key, it.nonce, it.encrypted.data (), size + 16, false });
+		start = std::chrono::steady_clock::now ();
+		for (int r = 0; r < numRounds; r++)
+			AEADChaCha20Poly1305Batch (msgs, true);
+		auto batchTime = std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count ();
+
+		auto rate = [](int64_t us) { return us > 0 ? (int64_t)numPackets*numRounds*1000000/us : 0; };
+		std::cout << size << " bytes packets per second: new context " << rate (evpTime) << ", cached context "
+			<< rate (singleTime) << ", batch " << rate (batchTime) << std::endl;
+	}
+}
+
+int main ()
+{
+	TestBatch ();
+	TestForged ();
+	Benchmark ();
+	return 0;
+}
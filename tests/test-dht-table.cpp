@@ -0,0 +1,357 @@
+#include <cassert>
+#include <inttypes.h>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+
+#include "I2PEndian.h"
+#include "KadDHT.h"
+
+using namespace i2p::data;
+
+// Flat sorted array of hashes as alternative to DHTTable's trie, kept here for comparison only.
+// Built with -O2, trie lookups are faster up to 10k routers and flat table's are 10-15% faster at 50k,
+// but its insert is O(n). NetDb's floodfills table has a few thousand routers and stays on DHTTable.
+
+const size_t FLAT_TABLE_MAX_SCAN_SIZE = 8; // sort by distance rather than split further
+const size_t FLAT_TABLE_INDEX_BUCKET_SIZE = 4; // average number of keys per index entry
+const int FLAT_TABLE_MAX_INDEX_BITS = 16;
+
+class FlatTable
+{
+	// keys with common prefix are adjacent, subtrees are ranges found by binary search
+	typedef std::function<bool (const std::shared_ptr<RouterInfo>&)> Filter;
+
+	struct Entry
+	{
+		IdentHash key;
+		std::shared_ptr<RouterInfo> router;
+	};
+
+	public:
+
+		FlatTable (): m_IndexBits (0) { UpdateIndex (true); };
+
+		void Insert (const std::shared_ptr<RouterInfo>& r);
+		bool Remove (const IdentHash& h);
+		std::vector<std::shared_ptr<RouterInfo> > FindClosest (const IdentHash& h, size_t num, const Filter& filter = nullptr) const;
+		size_t GetSize () const { return m_Entries.size (); };
+
+	private:
+
+		uint32_t GetPrefix (const IdentHash& h) const;
+		void UpdateIndex (bool force = false);
+		size_t LowerBound (const IdentHash& h) const;
+		void FindClosest (const IdentHash& h, size_t num, const Filter& filter,
+			std::vector<std::shared_ptr<RouterInfo> >& routers) const;
+		void FindClosest (const IdentHash& h, size_t num, const Filter& filter, size_t first, size_t last,
+			std::vector<std::shared_ptr<RouterInfo> >& routers) const; // [first, last) with common prefix
+
+	private:
+
+		std::vector<Entry> m_Entries; // sorted by key
+		int m_IndexBits;
+		std::vector<uint32_t> m_Index; // first entry for each prefix of m_IndexBits bits, size + 1 entries
+};
+
+uint32_t FlatTable::GetPrefix (const IdentHash& h) const
+{
+	return m_IndexBits ? bufbe32toh (h) >> (32 - m_IndexBits) : 0;
+}
+
+void FlatTable::UpdateIndex (bool force)
+{
+	int bits = 0;
+	while (bits < FLAT_TABLE_MAX_INDEX_BITS && (FLAT_TABLE_INDEX_BUCKET_SIZE << (bits + 1)) <= m_Entries.size ())
+		bits++;
+	if (bits == m_IndexBits && !force) return;
+	m_IndexBits = bits;
+	size_t numPrefixes = (size_t)1 << bits;
+	m_Index.resize (numPrefixes + 1);
+	size_t ind = 0;
+	for (size_t p = 0; p < numPrefixes; p++)
+	{
+		while (ind < m_Entries.size () && GetPrefix (m_Entries[ind].key) < p) ind++;
+		m_Index[p] = ind;
+	}
+	m_Index[numPrefixes] = m_Entries.size ();
+}
+
+size_t FlatTable::LowerBound (const IdentHash& h) const
+{
+	auto prefix = GetPrefix (h);
+	size_t first = m_Index[prefix], count = m_Index[prefix + 1] - first;
+	while (count > 0)
+	{
+		size_t step = count >> 1;
+		if (m_Entries[first + step].key < h)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
+	}
+	return first;
+}
+
+void FlatTable::Insert (const std::shared_ptr<RouterInfo>& r)
+{
+	if (!r) return;
+	const auto& h = r->GetIdentHash ();
+	auto ind = LowerBound (h);
+	if (ind < m_Entries.size () && m_Entries[ind].key == h)
+		m_Entries[ind].router = r; // replace
+	else
+	{
+		m_Entries.insert (m_Entries.begin () + ind, Entry{ h, r });
+		for (size_t p = GetPrefix (h) + 1; p < m_Index.size (); p++) m_Index[p]++;
+		UpdateIndex ();
+	}
+}
+
+bool FlatTable::Remove (const IdentHash& h)
+{
+	auto ind = LowerBound (h);
+	if (ind >= m_Entries.size () || m_Entries[ind].key != h) return false;
+	m_Entries.erase (m_Entries.begin () + ind);
+	for (size_t p = GetPrefix (h) + 1; p < m_Index.size (); p++) m_Index[p]--;
+	UpdateIndex ();
+	return true;
+}
+
+std::vector<std::shared_ptr<RouterInfo> > FlatTable::FindClosest (const IdentHash& h, size_t num, const Filter& filter) const
+{
+	std::vector<std::shared_ptr<RouterInfo> > vec;
+	if (num > 0)
+		FindClosest (h, num, filter, vec);
+	return vec;
+}
+
+static int GetCommonPrefixLength (const IdentHash& h1, const IdentHash& h2)
+{
+	auto d = h1 ^ h2;
+	int i = 0;
+	while (i < 4 && !d.metric_ll[i]) i++;
+	if (i == 4) return 256;
+	int len = i*64;
+	const uint8_t * metric = d.metric + i*8;
+	while (!*metric) { metric++; len += 8; }
+	for (uint8_t mask = 0x80; !(*metric & mask); mask >>= 1) len++;
+	return len;
+}
+
+void FlatTable::FindClosest (const IdentHash& h, size_t num, const Filter& filter,
+	std::vector<std::shared_ptr<RouterInfo> >& routers) const
+{
+	// start from h's position and extend range by subtrees of decreasing common prefix length
+	// common prefix length with h doesn't increase with distance from h's position
+	// and new subtree is always on one side, all its keys are farther than current range
+	size_t n = m_Entries.size (), first = LowerBound (h), last = first;
+	if (last < n && m_Entries[last].key == h)
+	{
+		last++;
+		FindClosest (h, num, filter, first, last, routers);
+	}
+	while (routers.size () < num && (first > 0 || last < n))
+	{
+		int left = first > 0 ? GetCommonPrefixLength (h, m_Entries[first - 1].key) : -1;
+		int right = last < n ? GetCommonPrefixLength (h, m_Entries[last].key) : -1;
+		if (left > right)
+		{
+			// gallop to the left, then binary search
+			size_t lo = first - 1, step = 1;
+			while (lo >= step && GetCommonPrefixLength (h, m_Entries[lo - step].key) >= left)
+			{
+				lo -= step;
+				step <<= 1;
+			}
+			size_t hi = lo;
+			lo = lo >= step ? lo - step + 1 : 0;
+			while (lo < hi)
+			{
+				size_t mid = (lo + hi) >> 1;
+				if (GetCommonPrefixLength (h, m_Entries[mid].key) >= left) hi = mid; else lo = mid + 1;
+			}
+			FindClosest (h, num, filter, lo, first, routers);
+			first = lo;
+		}
+		else
+		{
+			// gallop to the right, then binary search
+			size_t hi = last, step = 1;
+			while (hi + step < n && GetCommonPrefixLength (h, m_Entries[hi + step].key) >= right)
+			{
+				hi += step;
+				step <<= 1;
+			}
+			size_t lo = hi;
+			hi = hi + step < n ? hi + step : n;
+			while (lo + 1 < hi)
+			{
+				size_t mid = (lo + hi) >> 1;
+				if (GetCommonPrefixLength (h, m_Entries[mid].key) >= right) lo = mid; else hi = mid;
+			}
+			FindClosest (h, num, filter, last, hi, routers);
+			last = hi;
+		}
+	}
+}
+
+void FlatTable::FindClosest (const IdentHash& h, size_t num, const Filter& filter, size_t first, size_t last,
+	std::vector<std::shared_ptr<RouterInfo> >& routers) const
+{
+	while (last - first > FLAT_TABLE_MAX_SCAN_SIZE)
+	{
+		// all keys in range have common prefix, find first bit where first and last keys differ
+		auto d = m_Entries[first].key ^ m_Entries[last - 1].key;
+		int i = 0;
+		while (!d.metric_ll[i]) i++;
+		int level = i*64;
+		const uint8_t * metric = d.metric + i*8;
+		while (!*metric) { metric++; level += 8; }
+		for (uint8_t mask = 0x80; !(*metric & mask); mask >>= 1) level++;
+		// keys without this bit go first
+		size_t lo = first + 1, hi = last - 1;
+		while (lo < hi)
+		{
+			size_t mid = (lo + hi) >> 1;
+			if (m_Entries[mid].key.GetBit (level)) hi = mid; else lo = mid + 1;
+		}
+		// our side first, other side if not enough
+		if (h.GetBit (level))
+		{
+			FindClosest (h, num, filter, lo, last, routers);
+			last = lo;
+		}
+		else
+		{
+			FindClosest (h, num, filter, first, lo, routers);
+			first = lo;
+		}
+		if (routers.size () >= num) return;
+	}
+	// small range, insertion sort by distance
+	XORMetric distances[FLAT_TABLE_MAX_SCAN_SIZE];
+	const std::shared_ptr<RouterInfo> * routers1[FLAT_TABLE_MAX_SCAN_SIZE];
+	size_t n = 0;
+	for (size_t i = first; i < last; i++)
+	{
+		auto d = h ^ m_Entries[i].key;
+		size_t j = n;
+		for (; j > 0 && d < distances[j - 1]; j--)
+		{
+			distances[j] = distances[j - 1];
+			routers1[j] = routers1[j - 1];
+		}
+		distances[j] = d;
+		routers1[j] = &m_Entries[i].router;
+		n++;
+	}
+	for (size_t i = 0; i < n && routers.size () < num; i++)
+	{
+		const auto& r = *routers1[i];
+		if (!filter || filter (r)) routers.push_back (r);
+	}
+}
+
+class TestRouterInfo: public RouterInfo
+{
+	public:
+
+		TestRouterInfo (std::mt19937& rng)
+		{
+			// random keys, null certificate
+			uint8_t buf[DEFAULT_IDENTITY_SIZE];
+			for (auto& b: buf) b = rng ();
+			memset (buf + DEFAULT_IDENTITY_SIZE - 3, 0, 3);
+			SetRouterIdentity (std::make_shared<IdentityEx>(buf, DEFAULT_IDENTITY_SIZE));
+		}
+};
+
+std::vector<std::shared_ptr<RouterInfo> > CreateRouters (std::mt19937& rng, size_t num)
+{
+	std::vector<std::shared_ptr<RouterInfo> > routers;
+	for (size_t i = 0; i < num; i++)
+		routers.push_back (std::make_shared<TestRouterInfo> (rng));
+	return routers;
+}
+
+void TestFlatTable ()
+{
+	std::mt19937 rng (1);
+	auto routers = CreateRouters (rng, 3000);
+	DHTTable table;
+	FlatTable flatTable;
+	for (auto& r: routers)
+	{
+		table.Insert (r);
+		flatTable.Insert (r);
+	}
+	flatTable.Insert (routers[0]); // replace
+	assert (table.GetSize () == flatTable.GetSize ());
+	for (size_t i = 0; i < routers.size (); i += 3)
+	{
+		assert (table.Remove (routers[i]->GetIdentHash ()));
+		assert (flatTable.Remove (routers[i]->GetIdentHash ()));
+	}
+	assert (!flatTable.Remove (routers[0]->GetIdentHash ()));
+	assert (table.GetSize () == flatTable.GetSize ());
+	auto filter = [](const std::shared_ptr<RouterInfo>& r)->bool { return r->GetIdentHash ()[31] & 1; };
+	for (int i = 0; i < 1000; i++)
+	{
+		IdentHash h;
+		h.Randomize ();
+		auto v = table.FindClosest (h, 8), v1 = flatTable.FindClosest (h, 8);
+		assert (v == v1);
+		v = table.FindClosest (h, 3, filter); v1 = flatTable.FindClosest (h, 3, filter);
+		assert (v == v1);
+		for (size_t j = 1; j < v1.size (); j++)
+			assert ((h ^ v1[j - 1]->GetIdentHash ()) < (h ^ v1[j]->GetIdentHash ()));
+	}
+}
+
+const int BENCHMARK_NUM_LOOKUPS = 100000;
+
+void Benchmark (size_t num)
+{
+	std::mt19937 rng (num);
+	auto routers = CreateRouters (rng, num);
+	std::vector<IdentHash> keys (BENCHMARK_NUM_LOOKUPS);
+	for (auto& it: keys) it.Randomize ();
+	auto filter = [](const std::shared_ptr<RouterInfo>& r)->bool { return r->GetIdentHash ()[31] & 0x0F; }; // few excluded
+	size_t numFound = 0, numFound1 = 0;
+
+	auto start = std::chrono::steady_clock::now ();
+	DHTTable table;
+	for (auto& r: routers) table.Insert (r);
+	auto insertTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now () - start).count ();
+	start = std::chrono::steady_clock::now ();
+	for (const auto& h: keys)
+		numFound += table.FindClosest (h, 3, filter).size ();
+	auto lookupTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now () - start).count ();
+
+	start = std::chrono::steady_clock::now ();
+	FlatTable flatTable;
+	for (auto& r: routers) flatTable.Insert (r);
+	auto flatInsertTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now () - start).count ();
+	start = std::chrono::steady_clock::now ();
+	for (const auto& h: keys)
+		numFound1 += flatTable.FindClosest (h, 3, filter).size ();
+	auto flatLookupTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now () - start).count ();
+
+	assert (numFound == numFound1);
+	std::cout << num << " routers: trie insert " << insertTime << "us, lookup " << lookupTime << "us; flat insert "
+		<< flatInsertTime << "us, lookup " << flatLookupTime << "us" << std::endl;
+}
+
+int main ()
+{
+	TestFlatTable ();
+	Benchmark (2000);
+	Benchmark (5000);
+	Benchmark (20000);
+	return 0;
+}
@@ -0,0 +1,36 @@
+#include <cassert>
+#include <vector>
+#include <set>
+#include <thread>
+#include <chrono>
+
+#include "Transports.h"
+
+using namespace i2p::transport;
+
+int main ()
+{
+	X25519KeysPairSupplier supplier (4, 100);
+	supplier.Start (2);
+	std::this_thread::sleep_for (std::chrono::milliseconds (100));
+	assert (supplier.GetQueueSize () == 4);
+	// burst of handshakes
+	std::set<std::string> publicKeys;
+	for (int i = 0; i < 200; i++)
+	{
+		auto keys = supplier.Acquire ();
+		assert (keys);
+		publicKeys.insert (std::string ((const char *)keys->GetPublicKey (), 32));
+	}
+	assert (publicKeys.size () == 200);
+	assert (supplier.GetNumAcquired () == 200 && supplier.GetNumStarved () > 0);
+	// queue size follows rate
+	std::this_thread::sleep_for (std::chrono::milliseconds (1500));
+	assert (supplier.GetQueueSize () == 100);
+	auto numStarved = supplier.GetNumStarved ();
+	for (int i = 0; i < 50; i++)
+		supplier.Acquire ();
+	assert (supplier.GetNumStarved () == numStarved);
+	supplier.Stop ();
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include <cassert>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+
+#include "Crypto.h"
+#include "Garlic.h"
+
+using namespace i2p::garlic;
+
+int main ()
+{
+	GarlicWorkers pool;
+	assert (!pool.IsRunning () && !pool.Post ([]() {}));
+	pool.Start (2);
+	assert (pool.IsRunning ());
+	// static key is shared by all workers
+	i2p::crypto::X25519Keys staticKeys;
+	staticKeys.GenerateKeys ();
+	const int numJobs = 200;
+	std::vector<std::shared_ptr<i2p::crypto::X25519Keys> > peers;
+	std::vector<std::vector<uint8_t> > expected;
+	for (int i = 0; i < numJobs; i++)
+	{
+		auto keys = std::make_shared<i2p::crypto::X25519Keys> ();
+		keys->GenerateKeys ();
+		std::vector<uint8_t> shared (32);
+		assert (keys->Agree (staticKeys.GetPublicKey (), shared.data ()));
+		peers.push_back (keys);
+		expected.push_back (shared);
+	}
+	std::atomic<int> numMatched (0), numDone (0);
+	std::mutex mutex;
+	std::condition_variable done;
+	int numPosted = 0;
+	for (int i = 0; i < numJobs; i++)
+		if (pool.Post ([&, i]()
+			{
+				uint8_t shared[32];
+				if (staticKeys.Agree (peers[i]->GetPublicKey (), shared) && !memcmp (shared, expected[i].data (), 32))
+					numMatched++;
+				std::unique_lock<std::mutex> l(mutex);
+				numDone++;
+				done.notify_one ();
+			}))
+			numPosted++;
+	assert (numPosted == numJobs);
+	{
+		std::unique_lock<std::mutex> l(mutex);
+		while (numDone < numPosted) done.wait (l);
+	}
+	assert (numMatched == numJobs);
+	pool.Stop ();
+	assert (!pool.IsRunning () && !pool.Post ([]() {}));
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include <cassert>
+#include <cstdio>
+#include <string.h>
+#include <fstream>
+#include <map>
+#include <random>
+
+#include "NetDbStore.h"
+
+using namespace i2p::data;
+
+const char STORE_PATH[] = "test-netdb-store.dat";
+
+std::shared_ptr<RouterInfo::Buffer> CreateRecord (std::mt19937& rng, const IdentHash& ident)
+{
+	size_t len = 100 + rng () % 1000;
+	uint8_t buf[1100];
+	for (size_t i = 0; i < len; i++) buf[i] = ident[i % 32] ^ i;
+	return std::make_shared<RouterInfo::Buffer> (buf, len);
+}
+
+void CheckStore (const NetDbStore& store, const std::map<IdentHash, std::shared_ptr<RouterInfo::Buffer> >& expected)
+{
+	assert (store.GetNumRecords () == expected.size ());
+	uint8_t buf[MAX_RI_BUFFER_SIZE];
+	for (const auto& it: expected)
+	{
+		size_t len = store.Get (it.first, buf, MAX_RI_BUFFER_SIZE);
+		assert (len == it.second->GetBufferLen ());
+		assert (!memcmp (buf, it.second->data (), len));
+	}
+	size_t numVisited = 0;
+	store.Visit ([&expected, &numVisited](const IdentHash& ident, const uint8_t * buf, size_t len)
+		{
+			auto it = expected.find (ident);
+			assert (it != expected.end () && it->second->GetBufferLen () == len);
+			assert (!memcmp (buf, it->second->data (), len));
+			numVisited++;
+		});
+	assert (numVisited == expected.size ());
+}
+
+int main ()
+{
+	std::remove (STORE_PATH);
+	std::mt19937 rng (1);
+	std::map<IdentHash, std::shared_ptr<RouterInfo::Buffer> > expected;
+	{
+		NetDbStore store (STORE_PATH);
+		assert (store.Open ());
+		assert (!store.GetNumRecords ());
+		for (int i = 0; i < 20; i++)
+		{
+			// add new, update some and remove some
+			NetDbStore::Updates update;
+			std::list<IdentHash> remove;
+			for (int j = 0; j < 100; j++)
+			{
+				IdentHash ident;
+				ident.Randomize ();
+				auto record = CreateRecord (rng, ident);
+				update.emplace_back (ident, record);
+				expected[ident] = record;
+			}
+			for (auto it = expected.begin (); it != expected.end ();)
+			{
+				auto r = rng () % 10;
+				if (!r)
+				{
+					remove.push_back (it->first);
+					it = expected.erase (it);
+					continue;
+				}
+				if (r == 1)
+				{
+					it->second = CreateRecord (rng, it->first);
+					update.emplace_back (it->first, it->second);
+				}
+				it++;
+			}
+			assert (store.Update (update, remove));
+			CheckStore (store, expected);
+		}
+		assert (store.GetNumDeletedBytes () > 0);
+	}
+	{
+		// reopen with records after index
+		NetDbStore store (STORE_PATH);
+		assert (store.Open ());
+		CheckStore (store, expected);
+		auto fileSize = store.GetFileSize ();
+		assert (store.Compact ());
+		assert (!store.GetNumDeletedBytes () && store.GetFileSize () < fileSize);
+		CheckStore (store, expected);
+	}
+	{
+		// reopen with index only, then append record and break it
+		NetDbStore store (STORE_PATH);
+		assert (store.Open ());
+		CheckStore (store, expected);
+		IdentHash ident;
+		ident.Randomize ();
+		NetDbStore::Updates update;
+		update.emplace_back (ident, CreateRecord (rng, ident));
+		assert (store.Update (update, {}));
+		assert (store.GetNumRecords () == expected.size () + 1);
+		store.Close ();
+		std::ofstream f (STORE_PATH, std::ofstream::binary | std::ofstream::out | std::ofstream::app);
+		f.write ((const char *)ident.data (), 32);
+		f.write ("\x01", 1);
+		f.close ();
+		assert (store.Open ());
+		expected[ident] = update.front ().second;
+		CheckStore (store, expected);
+	}
+	{
+		// malformed
+		std::ofstream f (STORE_PATH, std::ofstream::binary | std::ofstream::out | std::ofstream::trunc);
+		f.write ("garbage", 7);
+		f.close ();
+		NetDbStore store (STORE_PATH);
+		assert (store.Open () && !store.GetNumRecords ());
+	}
+	std::remove (STORE_PATH);
+	return 0;
+}
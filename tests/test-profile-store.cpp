@@ -0,0 +1,90 @@
+#include <cassert>
+#include <cstdio>
+#include <string.h>
+#include <map>
+#include <array>
+#include <random>
+
+#include "ProfileStore.h"
+
+using namespace i2p::data;
+
+const char STORE_PATH[] = "test-profile-store.dat";
+const size_t RECORD_SIZE = 48;
+typedef std::array<uint8_t, RECORD_SIZE> Record;
+
+void CheckStore (const ProfileStore& store, const std::map<IdentHash, Record>& expected)
+{
+	assert (store.GetNumRecords () == expected.size ());
+	Record record;
+	for (const auto& it: expected)
+	{
+		assert (store.Get (it.first, record.data ()));
+		assert (record == it.second);
+	}
+	IdentHash ident;
+	ident.Randomize ();
+	assert (!store.Get (ident, record.data ()));
+}
+
+int main ()
+{
+	std::remove (STORE_PATH);
+	std::mt19937 rng (1);
+	std::map<IdentHash, Record> expected;
+	{
+		ProfileStore store (STORE_PATH, RECORD_SIZE);
+		assert (store.Open ());
+		assert (!store.GetNumRecords () && store.GetNumSlots () == PROFILE_STORE_MIN_NUM_SLOTS);
+		for (int i = 0; i < 1000; i++)
+		{
+			IdentHash ident;
+			ident.Randomize ();
+			Record record;
+			for (auto& b: record) b = rng ();
+			record[0] = i % 2; // to remove
+			assert (store.Put (ident, record.data ()));
+			expected[ident] = record;
+		}
+		assert (store.GetNumSlots () >= 1000);
+		// update in place
+		for (auto& it: expected)
+		{
+			it.second[1]++;
+			assert (store.Put (it.first, it.second.data ()));
+		}
+		CheckStore (store, expected);
+		auto numSlots = store.GetNumSlots ();
+		assert (store.Remove ([](const IdentHash&, const uint8_t * record) { return record[0]; }) == 500);
+		for (auto it = expected.begin (); it != expected.end ();)
+			if (it->second[0]) it = expected.erase (it); else it++;
+		store.Remove (expected.begin ()->first);
+		expected.erase (expected.begin ());
+		CheckStore (store, expected);
+		// free slots are reused
+		for (int i = 0; i < 400; i++)
+		{
+			IdentHash ident;
+			ident.Randomize ();
+			Record record;
+			record.fill (i);
+			assert (store.Put (ident, record.data ()));
+			expected[ident] = record;
+		}
+		assert (store.GetNumSlots () == numSlots);
+		store.Flush ();
+	}
+	{
+		// reopen
+		ProfileStore store (STORE_PATH, RECORD_SIZE);
+		assert (store.Open ());
+		CheckStore (store, expected);
+	}
+	{
+		// different record size
+		ProfileStore store (STORE_PATH, RECORD_SIZE + 8);
+		assert (store.Open () && !store.GetNumRecords ());
+	}
+	std::remove (STORE_PATH);
+	return 0;
+}
@@ -0,0 +1,35 @@
+#include <cassert>
+#include <inttypes.h>
+
+#include "ECIESX25519AEADRatchetSession.h"
+
+using namespace i2p::garlic;
+
+int main ()
+{
+	ReceiveRatchetTagSet tagset (nullptr);
+	assert (tagset.GetLookAhead () == ECIESX25519_MIN_NUM_GENERATED_TAGS);
+	uint64_t ts = 1000;
+	tagset.UpdateLookAhead (ts);
+	assert (tagset.GetLookAhead () == ECIESX25519_MIN_NUM_GENERATED_TAGS);
+	// burst, look ahead grows immediately
+	for (int i = 0; i < 100; i++)
+		tagset.UpdateLookAhead (ts + 1);
+	assert (tagset.GetLookAhead () == ECIESX25519_MAX_NUM_GENERATED_TAGS);
+	// twice as many as messages during last interval
+	tagset.UpdateLookAhead (ts + ECIESX25519_LOOKAHEAD_UPDATE_INTERVAL + 1);
+	assert (tagset.GetLookAhead () == 2*101);
+	// slow
+	for (int i = 0; i < 5; i++)
+		tagset.UpdateLookAhead (ts + ECIESX25519_LOOKAHEAD_UPDATE_INTERVAL + 5);
+	assert (tagset.GetLookAhead () == 2*101);
+	tagset.UpdateLookAhead (ts + 2*ECIESX25519_LOOKAHEAD_UPDATE_INTERVAL + 1);
+	assert (tagset.GetLookAhead () == ECIESX25519_MIN_NUM_GENERATED_TAGS);
+	// idle
+	for (int i = 0; i < 20; i++)
+		tagset.UpdateLookAhead (ts + 2*ECIESX25519_LOOKAHEAD_UPDATE_INTERVAL + 2);
+	assert (tagset.GetLookAhead () == 2*ECIESX25519_MIN_NUM_GENERATED_TAGS);
+	tagset.UpdateLookAhead (ts + 10*ECIESX25519_LOOKAHEAD_UPDATE_INTERVAL);
+	assert (tagset.GetLookAhead () == ECIESX25519_MIN_NUM_GENERATED_TAGS);
+	return 0;
+}
@@ -0,0 +1,120 @@
+#include <cassert>
+#include <inttypes.h>
+#include <string.h>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <boost/filesystem.hpp>
+#include <openssl/rand.h>
+
+#include "RouterInfo.h"
+#include "Timestamp.h"
+#include "version.h"
+
+using namespace i2p::data;
+
+const int BENCHMARK_NUM_ROUTERS = 100;
+const int BENCHMARK_NUM_ROUNDS = 100;
+
+std::shared_ptr<RouterInfo::Buffer> CreateRouterInfo (bool published, bool floodfill)
+{
+	auto keys = PrivateKeys::CreateRandomKeys (SIGNING_KEY_TYPE_EDDSA_SHA512_ED25519, CRYPTO_KEY_TYPE_ECIES_X25519_AEAD);
+	uint8_t staticKey[32], iv[32];
+	RAND_bytes (staticKey, 32); staticKey[31] &= 0x7F; // x25519
+	RAND_bytes (iv, 32);
+	LocalRouterInfo routerInfo;
+	routerInfo.SetRouterIdentity (keys.GetPublic ());
+	if (published)
+	{
+		routerInfo.AddNTCP2Address (staticKey, iv, boost::asio::ip::address::from_string ("8.8.4.4"), 12345);
+		routerInfo.AddSSU2Address (staticKey, iv, boost::asio::ip::address::from_string ("8.8.4.4"), 12345);
+	}
+	else
+	{
+		routerInfo.AddNTCP2Address (staticKey, iv, 0, RouterInfo::AddressCaps::eV4);
+		routerInfo.AddSSU2Address (staticKey, iv, 0, RouterInfo::AddressCaps::eV4);
+		RouterInfo::Introducer introducer;
+		introducer.iTag = 1;
+		introducer.iH.Randomize ();
+		introducer.iExp = i2p::util::GetSecondsSinceEpoch () + 600;
+		routerInfo.AddSSU2Introducer (introducer, true);
+	}
+	routerInfo.UpdateCaps (floodfill ? RouterInfo::eReachable | RouterInfo::eFloodfill : RouterInfo::eReachable);
+	routerInfo.SetProperty ("netId", "2");
+	routerInfo.SetProperty ("router.version", "0.9.62");
+	routerInfo.CreateBuffer (keys);
+	return std::make_shared<RouterInfo::Buffer> (routerInfo.GetBuffer (), routerInfo.GetBufferLen ());
+}
+
+void TestParse ()
+{
+	auto buf = CreateRouterInfo (true, true);
+	RouterInfo ri (buf->data (), buf->GetBufferLen ());
+	assert (!ri.IsUnreachable ());
+	assert (ri.IsFloodfill () && ri.IsDeclaredFloodfill () && (ri.GetCaps () & RouterInfo::eReachable));
+	assert (ri.GetVersion () == MAKE_VERSION_NUMBER(0, 9, 62));
+	assert (ri.GetCompatibleTransports (false) == (RouterInfo::eNTCP2V4 | RouterInfo::eSSU2V4));
+	assert (ri.GetPublishedTransports () == (RouterInfo::eNTCP2V4 | RouterInfo::eSSU2V4));
+	auto ntcp2 = ri.GetNTCP2V4Address ();
+	assert (ntcp2 && ntcp2->published && ntcp2->port == 12345 && ntcp2->host.to_string () == "8.8.4.4");
+	auto ssu2 = ri.GetSSU2V4Address ();
+	assert (ssu2 && ssu2->published && ssu2->port == 12345);
+
+	buf = CreateRouterInfo (false, false);
+	RouterInfo ri1 (buf->data (), buf->GetBufferLen ());
+	assert (!ri1.IsUnreachable () && !ri1.IsFloodfill ());
+	assert (!ri1.GetPublishedTransports ());
+	assert (ri1.IsReachableBy (RouterInfo::eSSU2V4) && !ri1.IsReachableBy (RouterInfo::eNTCP2V4));
+	ssu2 = ri1.GetSSU2V4Address ();
+	assert (ssu2 && !ssu2->published && ssu2->ssu && ssu2->ssu->introducers.size () == 1);
+
+	// corrupted signature
+	buf->data ()[buf->GetBufferLen () - 1]++;
+	RouterInfo ri2 (buf->data (), buf->GetBufferLen ());
+	assert (ri2.IsUnreachable ());
+	// truncated
+	RouterInfo ri3 (buf->data (), buf->GetBufferLen () - 80, false);
+	assert (ri3.IsUnreachable ());
+}
+
+void Benchmark (const std::vector<std::shared_ptr<RouterInfo::Buffer> >& buffers, int numRounds)
+{
+	if (buffers.empty ()) return;
+	size_t numParsed = 0;
+	auto start = std::chrono::steady_clock::now ();
+	for (int i = 0; i < numRounds; i++)
+		for (const auto& it: buffers)
+		{
+			RouterInfo ri (it->data (), it->GetBufferLen (), false);
+			if (!ri.IsUnreachable ()) numParsed++;
+		}
+	auto time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now () - start).count ();
+	std::cout << buffers.size () << " RouterInfos, " << numRounds << " rounds: " << numParsed << " parsed in " << time << "us, "
+		<< (double)time/(buffers.size ()*numRounds) << "us per RouterInfo" << std::endl;
+}
+
+int main (int argc, char * argv[])
+{
+	TestParse ();
+	std::vector<std::shared_ptr<RouterInfo::Buffer> > buffers;
+	if (argc > 1)
+	{
+		// netDb directory snapshot
+		for (boost::filesystem::recursive_directory_iterator it (argv[1]), end; it != end; it++)
+		{
+			if (!boost::filesystem::is_regular_file (it->status ())) continue;
+			RouterInfo ri (it->path ().string ());
+			if (ri.GetBuffer ())
+				buffers.push_back (std::make_shared<RouterInfo::Buffer> (ri.GetBuffer (), ri.GetBufferLen ()));
+		}
+		Benchmark (buffers, 1);
+	}
+	else
+	{
+		for (int i = 0; i < BENCHMARK_NUM_ROUTERS; i++)
+			buffers.push_back (CreateRouterInfo (i % 2, !(i % 10)));
+		Benchmark (buffers, BENCHMARK_NUM_ROUNDS);
+	}
+	return 0;
+}
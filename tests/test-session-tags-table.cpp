@@ -0,0 +1,115 @@
+#include <cassert>
+#include <inttypes.h>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "SessionTagsTable.h"
+
+using namespace i2p::garlic;
+
+struct TestValue
+{
+	int index;
+	std::shared_ptr<int> tagset;
+};
+
+void TestInsertFindErase ()
+{
+	SessionTagsTable<TestValue> table;
+	std::unordered_map<uint64_t, int> expected;
+	std::mt19937_64 rng (1);
+	assert (!table.Insert (0, TestValue{0, nullptr}));
+	for (int round = 0; round < 20; round++)
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			uint64_t tag = rng () & 0xFFFF; // with collisions
+			bool inserted = table.Insert (tag, TestValue{i, nullptr});
+			assert (inserted == (tag && !expected.count (tag)));
+			if (inserted) expected[tag] = i;
+		}
+		for (int i = 0; i < 500; i++)
+		{
+			uint64_t tag = rng () & 0xFFFF;
+			assert (table.Erase (tag) == (expected.erase (tag) > 0));
+		}
+		assert (table.GetSize () == expected.size ());
+		for (auto& it: expected)
+		{
+			auto v = table.Find (it.first);
+			assert (v && v->index == it.second);
+		}
+	}
+	// remove odd indices
+	auto numErased = table.EraseIf ([](uint64_t, const TestValue& v) { return v.index & 1; });
+	size_t numOdd = 0;
+	for (auto it = expected.begin (); it != expected.end ();)
+		if (it->second & 1) { it = expected.erase (it); numOdd++; } else it++;
+	assert (numErased == numOdd && table.GetSize () == expected.size ());
+	for (auto& it: expected)
+		assert (table.Find (it.first) && table.Find (it.first)->index == it.second);
+	// remove all, table shrinks
+	table.EraseIf ([](uint64_t, const TestValue&) { return true; });
+	assert (table.IsEmpty () && table.GetCapacity () == 16);
+	table.Insert (1, TestValue{1, nullptr});
+	table.Clear ();
+	assert (table.IsEmpty () && !table.Find (1));
+}
+
+void Benchmark ()
+{
+	const int numTags = 100000, numRounds = 10;
+	std::mt19937_64 rng (2);
+	std::vector<uint64_t> tags (numTags);
+	for (auto& it: tags) it = rng ();
+	auto tagset = std::make_shared<int> (0);
+	int sum = 0;
+
+	SessionTagsTable<TestValue> table;
+	auto start = std::chrono::steady_clock::now ();
+	for (int r = 0; r < numRounds; r++)
+	{
+		for (auto& it: tags) table.Insert (it, TestValue{r, tagset});
+		for (auto& it: tags)
+		{
+			auto v = table.Find (it);
+			sum += v->index;
+			table.Erase (it);
+		}
+	}
+	auto tableTime = std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count ();
+	for (auto& it: tags) table.Insert (it, TestValue{0, tagset});
+	auto tableMemory = table.GetMemoryUsage ();
+
+	std::unordered_map<uint64_t, TestValue> map;
+	start = std::chrono::steady_clock::now ();
+	for (int r = 0; r < numRounds; r++)
+	{
+		for (auto& it: tags) map.emplace (it, TestValue{r, tagset});
+		for (auto& it: tags)
+		{
+			auto v = map.find (it);
+			sum += v->second.index;
+			map.erase (v);
+		}
+	}
+	auto mapTime = std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count ();
+	for (auto& it: tags) map.emplace (it, TestValue{0, tagset});
+	// node with key, value and next pointer, malloc overhead and bucket pointer
+	auto mapMemory = map.size ()*(sizeof (void *) + sizeof (uint64_t) + sizeof (TestValue) + 2*sizeof (void *)) + map.bucket_count ()*sizeof (void *);
+
+	std::cout << numTags << " tags, " << numRounds << " rounds of insert, find and erase: table " << tableTime << "us, "
+		<< tableMemory/numTags << " bytes per tag; unordered_map " << mapTime << "us, about "
+		<< mapMemory/numTags << " bytes per tag (" << sum << ")" << std::endl;
+}
+
+int main ()
+{
+	TestInsertFindErase ();
+	Benchmark ();
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#include "SSU2CongestionControl.h"
+
+using namespace i2p::transport;
+
+void TestAIMD ()
+{
+	auto cc = CreateSSU2CongestionControl (eSSU2CongestionControlAIMD);
+	assert (std::string (cc->GetName ()) == "aimd");
+	assert (cc->GetWindowSize () == SSU2_MIN_WINDOW_SIZE);
+	assert (!cc->GetPacingInterval ());
+	cc->OnPacketsAcked (10, 1000);
+	assert (cc->GetWindowSize () == SSU2_MIN_WINDOW_SIZE + 10);
+	cc->OnPacketsAcked (1000, 1100);
+	assert (cc->GetWindowSize () == SSU2_MAX_WINDOW_SIZE);
+	cc->OnPacketsLost (1, 1200);
+	assert (cc->GetWindowSize () == SSU2_MAX_WINDOW_SIZE/2);
+	for (int i = 0; i < 10; i++)
+		cc->OnPacketsLost (1, 1300);
+	assert (cc->GetWindowSize () == SSU2_MIN_WINDOW_SIZE);
+}
+
+void TestCubic ()
+{
+	SSU2CubicCongestionControl cc;
+	cc.OnRTTSample (100, 100, 1000);
+	assert (cc.GetPacingInterval () > 0);
+	// slow start
+	cc.OnPacketsAcked (100, 1100);
+	assert (cc.GetWindowSize () == SSU2_MIN_WINDOW_SIZE + 100);
+	size_t windowSize = cc.GetWindowSize ();
+	cc.OnPacketsLost (1, 1200);
+	assert (cc.GetWindowSize () == (size_t)(windowSize*SSU2_CUBIC_BETA));
+	cc.OnPacketsLost (1, 1250); // same RTT
+	assert (cc.GetWindowSize () == (size_t)(windowSize*SSU2_CUBIC_BETA));
+	// concave growth back to max window, then convex above it
+	uint64_t ts = 1300;
+	for (int i = 0; i < 100; i++, ts += 100)
+		cc.OnPacketsAcked (cc.GetWindowSize (), ts);
+	assert (cc.GetWindowSize () > windowSize);
+	assert (cc.GetWindowSize () <= SSU2_MAX_CONGESTION_WINDOW_SIZE);
+}
+
+void TestBBR ()
+{
+	// bottleneck 2 packets per millisecond, RTT 100 milliseconds
+	const double bandwidth = 2.0, rtt = 100;
+	SSU2BBRCongestionControl cc;
+	assert (cc.GetWindowSize () == SSU2_MIN_WINDOW_SIZE);
+	assert (!cc.GetPacingInterval ());
+	double credit = 0;
+	for (uint64_t ts = 1000; ts < 20000; ts++)
+	{
+		credit += std::min (bandwidth, cc.GetWindowSize ()/rtt);
+		cc.OnRTTSample (rtt, rtt, ts);
+		if (credit >= 1)
+		{
+			cc.OnPacketsAcked ((size_t)credit, ts);
+			credit -= (size_t)credit;
+		}
+	}
+	assert (std::fabs (cc.GetBandwidth () - bandwidth) < 0.2);
+	assert (cc.GetMinRTT () == rtt);
+	size_t windowSize = SSU2_BBR_CWND_GAIN*bandwidth*rtt;
+	assert (cc.GetWindowSize () > windowSize*0.9 && cc.GetWindowSize () < windowSize*1.1);
+	assert (cc.GetPacingInterval () > 0 && cc.GetPacingInterval () < 1000);
+	cc.OnPacketsLost (10, 20000); // not a signal
+	assert (cc.GetWindowSize () > windowSize*0.9);
+}
+
+int main ()
+{
+	SSU2CongestionControlType type;
+	assert (GetSSU2CongestionControlType ("cubic", type) && type == eSSU2CongestionControlCubic);
+	assert (GetSSU2CongestionControlType ("bbr", type) && type == eSSU2CongestionControlBBR);
+	assert (!GetSSU2CongestionControlType ("reno", type));
+	TestAIMD ();
+	TestCubic ();
+	TestBBR ();
+	return 0;
+}
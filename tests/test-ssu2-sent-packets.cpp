@@ -0,0 +1,209 @@
+#include <cassert>
+#include <inttypes.h>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <map>
+#include <set>
+#include <vector>
+#include <memory>
+
+#include "SSU2Session.h"
+
+using namespace i2p::transport;
+
+void TestSentPackets ()
+{
+	i2p::util::MemoryPool<SSU2SentPacket> pool;
+	SSU2SentPackets packets (pool);
+	std::map<uint32_t, SSU2SentPacket *> expected;
+	std::mt19937 rng (1);
+	uint32_t packetNum = 0;
+	for (int i = 0; i < 20000; i++)
+	{
+		if (rng () % 3)
+		{
+			packetNum += 1 + rng () % 4; // some packet nums are not stored, like acks
+			auto packet = packets.Acquire ();
+			packet->numResends = packetNum;
+			packets.Insert (packetNum, packet);
+			expected.emplace (packetNum, packet);
+		}
+		else if (!expected.empty ())
+		{
+			// ack random range
+			uint32_t first = expected.begin ()->first + rng () % 64, last = first + rng () % 16;
+			for (auto n = first; n <= last; n++)
+			{
+				auto it = expected.find (n);
+				assert ((it != expected.end ()) == (packets.Get (n) != nullptr));
+				if (it != expected.end ())
+				{
+					expected.erase (it);
+					packets.Remove (n);
+				}
+			}
+		}
+		assert (packets.GetSize () == expected.size ());
+		if (!expected.empty ())
+		{
+			assert (packets.GetFirstPacketNum () == expected.begin ()->first);
+			assert (packets.GetEndPacketNum () == expected.rbegin ()->first + 1);
+		}
+	}
+	for (auto& it: expected)
+	{
+		auto packet = packets.Get (it.first);
+		assert (packet == it.second);
+		assert ((uint32_t)packet->numResends == it.first);
+	}
+	auto first = packets.GetFirstPacketNum ();
+	auto packet = packets.Extract (first);
+	assert (packet && !packets.Get (first));
+	packets.Release (packet);
+	packets.Clear ();
+	assert (packets.IsEmpty ());
+}
+
+void TestOutOfSequencePackets ()
+{
+	SSU2OutOfSequencePackets packets;
+	std::set<uint32_t> expected;
+	std::mt19937 rng (2);
+	uint32_t receivePacketNum = 1000;
+	for (int i = 0; i < 20000; i++)
+	{
+		if (rng () % 4)
+		{
+			uint32_t packetNum = receivePacketNum + 2 + rng () % 700;
+			assert (packets.Insert (packetNum));
+			expected.insert (packetNum);
+		}
+		else
+		{
+			receivePacketNum += rng () % 200;
+			packets.EraseUntil (receivePacketNum);
+			expected.erase (expected.begin (), expected.upper_bound (receivePacketNum));
+		}
+		assert (packets.GetSize () == expected.size ());
+		if (!expected.empty ())
+		{
+			assert (packets.GetFirst () == *expected.begin ());
+			assert (packets.GetLast () == *expected.rbegin ());
+		}
+		if (!(i % 100))
+		{
+			auto it = packets.RBegin ();
+			for (auto it1 = expected.rbegin (); it1 != expected.rend (); it1++, it++)
+			{
+				assert (it != packets.REnd ());
+				assert (*it == *it1);
+			}
+			assert (it == packets.REnd ());
+		}
+	}
+	assert (!packets.Insert (receivePacketNum + 2*SSU2_MAX_NUM_OUT_OF_SEQUENCE_PACKETS));
+	packets.Clear ();
+	assert (packets.IsEmpty () && packets.RBegin () == packets.REnd ());
+}
+
+// typical window: send packets, ack them with small gaps and resend lost
+const int BENCHMARK_NUM_PACKETS = 1000000;
+
+void BenchmarkSentPackets ()
+{
+	i2p::util::MemoryPool<SSU2SentPacket> pool;
+	auto start = std::chrono::steady_clock::now ();
+	{
+		std::map<uint32_t, std::shared_ptr<SSU2SentPacket> > sentPackets;
+		uint32_t packetNum = 0;
+		for (int i = 0; i < BENCHMARK_NUM_PACKETS; i++)
+		{
+			sentPackets.emplace (packetNum++, pool.AcquireShared ());
+			if (sentPackets.size () >= 256)
+			{
+				// ack range, keep every 32th
+				auto first = sentPackets.begin ()->first;
+				for (auto n = first; n < first + 64; n++)
+					if (n % 32)
+					{
+						auto it = sentPackets.find (n);
+						if (it != sentPackets.end ()) sentPackets.erase (it);
+					}
+				if (sentPackets.begin ()->first < first + 64 && !(sentPackets.begin ()->first % 32))
+				{
+					// resend
+					auto packet = sentPackets.begin ()->second;
+					sentPackets.erase (sentPackets.begin ());
+					sentPackets.emplace (packetNum++, packet);
+				}
+			}
+		}
+	}
+	auto mapTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now () - start).count ();
+	start = std::chrono::steady_clock::now ();
+	{
+		SSU2SentPackets sentPackets (pool);
+		uint32_t packetNum = 0;
+		for (int i = 0; i < BENCHMARK_NUM_PACKETS; i++)
+		{
+			sentPackets.Insert (packetNum++, sentPackets.Acquire ());
+			if (sentPackets.GetSize () >= 256)
+			{
+				auto first = sentPackets.GetFirstPacketNum ();
+				for (auto n = first; n < first + 64; n++)
+					if (n % 32) sentPackets.Remove (n);
+				if (sentPackets.GetFirstPacketNum () < first + 64 && !(sentPackets.GetFirstPacketNum () % 32))
+				{
+					auto packet = sentPackets.Extract (sentPackets.GetFirstPacketNum ());
+					sentPackets.Insert (packetNum++, packet);
+				}
+			}
+		}
+	}
+	auto ringTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now () - start).count ();
+	std::cout << "Sent packets: map " << mapTime << "us, ring " << ringTime << "us" << std::endl;
+}
+
+void BenchmarkOutOfSequencePackets ()
+{
+	auto start = std::chrono::steady_clock::now ();
+	size_t numAcks = 0;
+	{
+		std::set<uint32_t> outOfSequencePackets;
+		for (uint32_t packetNum = 2; packetNum < BENCHMARK_NUM_PACKETS; packetNum++)
+		{
+			if (!(packetNum % 512))
+				outOfSequencePackets.erase (outOfSequencePackets.begin (), outOfSequencePackets.upper_bound (packetNum - 256));
+			if (packetNum % 17) outOfSequencePackets.insert (packetNum); // some lost
+			for (auto it = outOfSequencePackets.rbegin (); it != outOfSequencePackets.rend () && *it + 32 > packetNum; it++)
+				numAcks++;
+		}
+	}
+	auto setTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now () - start).count ();
+	start = std::chrono::steady_clock::now ();
+	size_t numAcks1 = 0;
+	{
+		SSU2OutOfSequencePackets outOfSequencePackets;
+		for (uint32_t packetNum = 2; packetNum < BENCHMARK_NUM_PACKETS; packetNum++)
+		{
+			if (!(packetNum % 512))
+				outOfSequencePackets.EraseUntil (packetNum - 256);
+			if (packetNum % 17) outOfSequencePackets.Insert (packetNum);
+			for (auto it = outOfSequencePackets.RBegin (); it != outOfSequencePackets.REnd () && *it + 32 > packetNum; it++)
+				numAcks1++;
+		}
+	}
+	auto bitmapTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now () - start).count ();
+	assert (numAcks == numAcks1);
+	std::cout << "Out of sequence packets: set " << setTime << "us, bitmap " << bitmapTime << "us" << std::endl;
+}
+
+int main ()
+{
+	TestSentPackets ();
+	TestOutOfSequencePackets ();
+	BenchmarkSentPackets ();
+	BenchmarkOutOfSequencePackets ();
+	return 0;
+}
@@ -0,0 +1,187 @@
+#include <cassert>
+#include <inttypes.h>
+#include <iostream>
+#include <deque>
+#include <vector>
+#include <random>
+
+#include "Gzip.h"
+#include "Streaming.h"
+
+using namespace i2p::stream;
+
+Packet * CreatePacket (uint32_t seqn, uint64_t sendTime = 0)
+{
+	auto packet = new Packet ();
+	htobe32buf (packet->buf + 8, seqn);
+	packet->sendTime = sendTime;
+	return packet;
+}
+
+void CreateAck (Packet& ack, uint32_t ackThrough, const std::vector<uint32_t>& nacks)
+{
+	htobe32buf (ack.buf + 12, ackThrough);
+	ack.buf[16] = nacks.size ();
+	for (size_t i = 0; i < nacks.size (); i++)
+		htobe32buf (ack.buf + 17 + 4*i, nacks[i]);
+}
+
+void TestPacketsRing ()
+{
+	PacketsRing ring;
+	assert (ring.IsEmpty () && !ring.Get (0));
+	// out of order, before first and far ahead
+	for (uint32_t seqn: { 10, 12, 5, 100, 11 })
+		assert (ring.Insert (CreatePacket (seqn)));
+	auto duplicate = CreatePacket (12);
+	assert (!ring.Insert (duplicate));
+	delete duplicate;
+	assert (ring.GetSize () == 5 && ring.GetFirstSeqn () == 5 && ring.GetEndSeqn () == 101);
+	assert (ring.Get (11)->GetSeqn () == 11 && !ring.Get (6) && !ring.Get (101));
+	delete ring.Extract (100);
+	assert (ring.GetEndSeqn () == 13);
+	delete ring.Extract (5);
+	assert (ring.GetFirstSeqn () == 10 && !ring.Extract (5));
+	for (uint32_t seqn = 10; seqn < 13; seqn++)
+		delete ring.Extract (seqn);
+	assert (ring.IsEmpty ());
+	ring.Clear ();
+}
+
+void TestScoreboard ()
+{
+	SentPacketsScoreboard sent;
+	for (uint32_t seqn = 0; seqn < 10; seqn++)
+		sent.Insert (CreatePacket (seqn, 1000 + seqn*10));
+	// 3 is NACKed three times, fast retransmit
+	Packet ack;
+	size_t numAcked = 0;
+	auto acked = [&numAcked](Packet * p) { numAcked++; delete p; };
+	CreateAck (ack, 4, { 3 });
+	assert (sent.ProcessAck (ack, acked) == 4 && !sent.GetNumLost ());
+	CreateAck (ack, 5, { 3 });
+	sent.ProcessAck (ack, acked);
+	CreateAck (ack, 6, { 3 });
+	sent.ProcessAck (ack, acked);
+	assert (numAcked == 6 && sent.GetNumLost () == 1 && sent.GetFirstLost ()->GetSeqn () == 3);
+	auto resent = sent.GetFirstLost ();
+	sent.ClearLost (resent);
+	resent->resent = true;
+	resent->sendTime = 1095;
+	assert (!sent.GetNumLost () && !sent.GetFirstLost ());
+	// acks generated before resent 3 arrived don't count
+	for (int i = 0; i < 3; i++)
+	{
+		CreateAck (ack, 6, { 3 });
+		sent.ProcessAck (ack, acked);
+	}
+	assert (!sent.GetNumLost () && !resent->numNACKs);
+	// 7 and 8 not acked, 9 delivered, RACK declares them lost after RTT and reordering window
+	CreateAck (ack, 9, { 3, 7, 8 });
+	sent.ProcessAck (ack, acked);
+	assert (sent.GetSize () == 3);
+	assert (!sent.DetectLosses (1070 + 100, 100)); // 3 is resent after 9, 7 is sent 100 ms ago
+	assert (sent.DetectLosses (1080 + 125, 100) == 2 && sent.GetNumLost () == 2);
+	CreateAck (ack, 9, {});
+	sent.ProcessAck (ack, acked);
+	assert (sent.IsEmpty () && !sent.GetNumLost ());
+	sent.Clear ();
+}
+
+// sender may not go further than window from first not acked packet, one packet per pacing interval
+int Simulate (double lossRate, bool fastRetransmit)
+{
+	const uint64_t delay = 300, duration = 120000, rto = 1000; // in milliseconds
+	const int rtt = 2*delay, window = 32;
+	const uint64_t pacing = rtt/window;
+	std::mt19937 rng (3);
+	std::bernoulli_distribution loss (lossRate);
+	std::deque<std::pair<uint64_t, uint32_t> > data; // arrival time, seqn
+	std::deque<std::pair<uint64_t, Packet> > acks;
+	SentPacketsScoreboard sent;
+	PacketsRing saved;
+	uint32_t nextSeqn = 0;
+	int32_t lastReceived = -1;
+	uint64_t nextSendTime = 0;
+	auto release = [](Packet * p) { delete p; };
+	for (uint64_t ts = 0; ts < duration; ts++)
+	{
+		// receiver
+		while (!data.empty () && data.front ().first <= ts)
+		{
+			uint32_t seqn = data.front ().second;
+			data.pop_front ();
+			if ((int32_t)seqn == lastReceived + 1)
+			{
+				lastReceived++;
+				while (auto p = saved.Extract (lastReceived + 1))
+				{
+					delete p;
+					lastReceived++;
+				}
+			}
+			else if ((int32_t)seqn > lastReceived)
+			{
+				auto p = CreatePacket (seqn);
+				if (!saved.Insert (p)) delete p;
+			}
+			std::vector<uint32_t> nacks;
+			uint32_t ackThrough = saved.IsEmpty () ? lastReceived : saved.GetEndSeqn () - 1;
+			for (uint32_t i = lastReceived + 1; i < ackThrough && nacks.size () < 255; i++)
+				if (!saved.Get (i)) nacks.push_back (i);
+			acks.emplace_back (ts + delay, Packet ());
+			CreateAck (acks.back ().second, ackThrough, nacks);
+			if (loss (rng)) acks.pop_back ();
+		}
+		// sender
+		while (!acks.empty () && acks.front ().first <= ts)
+		{
+			sent.ProcessAck (acks.front ().second, release);
+			acks.pop_front ();
+		}
+		if (fastRetransmit) sent.DetectLosses (ts, rtt);
+		if (ts < nextSendTime) continue;
+		Packet * packet = fastRetransmit ? sent.GetFirstLost () : nullptr;
+		for (auto seqn = sent.GetFirstSeqn (); !packet && seqn < sent.GetEndSeqn (); seqn++)
+		{
+			auto p = sent.Get (seqn);
+			if (p && ts >= p->sendTime + rto) packet = p;
+		}
+		if (packet)
+		{
+			sent.ClearLost (packet);
+			packet->resent = true;
+			packet->sendTime = ts;
+		}
+		else if (nextSeqn - (sent.IsEmpty () ? nextSeqn : sent.GetFirstSeqn ()) < (uint32_t)window)
+		{
+			packet = CreatePacket (nextSeqn++, ts);
+			sent.Insert (packet);
+		}
+		if (packet)
+		{
+			if (!loss (rng)) data.emplace_back (ts + delay, packet->GetSeqn ());
+			nextSendTime = ts + pacing;
+		}
+	}
+	while (!sent.IsEmpty ()) delete sent.Extract (sent.GetFirstSeqn ());
+	while (!saved.IsEmpty ()) delete saved.Extract (saved.GetFirstSeqn ());
+	return (lastReceived + 1)*1000/duration; // in order packets per second
+}
+
+int main ()
+{
+	TestPacketsRing ();
+	TestScoreboard ();
+	for (double lossRate: { 0.0, 0.01, 0.03 })
+	{
+		int rtoOnly = Simulate (lossRate, false), fast = Simulate (lossRate, true);
+		std::cout << "Loss " << lossRate*100 << "%, RTT 600ms, window 32: RTO only " << rtoOnly
+			<< " packets/s, NACK and RACK " << fast << " packets/s" << std::endl;
+		if (lossRate > 0)
+			assert (fast > rtoOnly);
+		else
+			assert (fast == rtoOnly);
+	}
+	return 0;
+}
@@ -0,0 +1,107 @@
+#include <cassert>
+#include <inttypes.h>
+#include <map>
+#include <set>
+#include <random>
+
+#include "TimerWheel.h"
+
+using namespace i2p::util;
+
+typedef TimerWheel<int, 64> TestWheel;
+
+void TestExpire ()
+{
+	TestWheel wheel;
+	std::map<int, uint64_t> timers;
+	std::map<int, TestWheel::Handle> handles;
+	std::mt19937 rng (1);
+	uint64_t ts = 1000000;
+	for (int i = 0; i < 1000; i++)
+	{
+		uint64_t expiration = ts + rng () % 200; // some are more than one round ahead
+		handles[i] = wheel.Add (expiration, i);
+		timers[i] = expiration;
+	}
+	assert (wheel.GetSize () == 1000);
+	for (int i = 0; i < 1000; i += 7)
+	{
+		wheel.Remove (handles[i]);
+		timers.erase (i);
+	}
+	assert (wheel.GetSize () == timers.size ());
+	std::set<int> expired;
+	for (uint64_t t = ts; t < ts + 200; t += 1 + rng () % 5)
+	{
+		wheel.Expire (t, [&](int element, uint64_t expiration)
+			{
+				assert (expiration <= t && timers[element] == expiration);
+				assert (expired.insert (element).second);
+			});
+		for (auto& it: timers)
+			assert ((it.second <= t) == (expired.count (it.first) > 0));
+	}
+	wheel.Expire (ts + 200, [&](int element, uint64_t) { expired.insert (element); });
+	assert (expired.size () == timers.size () && wheel.IsEmpty ());
+}
+
+void TestReschedule ()
+{
+	TestWheel wheel;
+	int numExpired = 0;
+	wheel.Add (10, 1);
+	for (uint64_t t = 0; t < 100; t++)
+		wheel.Expire (t, [&](int element, uint64_t expiration)
+			{
+				numExpired++;
+				if (numExpired < 5) wheel.Add (expiration + 10, element); // every 10 ticks
+			});
+	assert (numExpired == 5 && wheel.IsEmpty ());
+}
+
+void TestClockJumps ()
+{
+	TestWheel wheel;
+	size_t numExpired = 0;
+	auto callback = [&numExpired](int, uint64_t) { numExpired++; };
+	wheel.Expire (1000, callback);
+	wheel.Add (1010, 1);
+	wheel.Add (1500, 2);
+	// forward, both expire
+	assert (wheel.Expire (100000, callback) == 2 && wheel.IsEmpty ());
+	// small step back, not expired yet
+	wheel.Add (100010, 3);
+	assert (!wheel.Expire (99990, callback));
+	assert (wheel.Expire (100010, callback) == 1);
+	// far back, expire all
+	wheel.Add (100020, 4);
+	wheel.Add (100040, 5);
+	assert (wheel.Expire (1000, callback) == 2 && wheel.IsEmpty ());
+	assert (numExpired == 5);
+}
+
+void TestMaxStepBack ()
+{
+	TimerWheel<int, 64, 10> wheel;
+	size_t numExpired = 0;
+	auto callback = [&numExpired](int, uint64_t) { numExpired++; };
+	wheel.Expire (1000, callback);
+	// less than MaxStepBack, wait for expiration
+	wheel.Add (1005, 1);
+	assert (!wheel.Expire (995, callback) && wheel.GetSize () == 1);
+	assert (wheel.Expire (1005, callback) == 1);
+	// more than MaxStepBack but less than NumSlots, expire all
+	wheel.Add (1010, 2);
+	wheel.Add (1030, 3);
+	assert (wheel.Expire (980, callback) == 2 && wheel.IsEmpty ());
+	assert (numExpired == 3);
+}
+
+int main ()
+{
+	TestExpire ();
+	TestReschedule ();
+	TestClockJumps ();
+	TestMaxStepBack ();
+	return 0;
+}
@@ -0,0 +1,142 @@
+#include <cassert>
+#include <inttypes.h>
+#include <vector>
+#include <memory>
+
+#include "I2NPProtocol.h"
+#include "Transports.h"
+#include "TransportSendQueue.h"
+
+using namespace i2p;
+using namespace i2p::transport;
+
+std::shared_ptr<I2NPMessage> CreateMessage (I2NPMessageType type, bool isTransit, int * numDropped = nullptr)
+{
+	uint8_t buf[100] = {};
+	auto msg = CreateI2NPMessage (type, buf, 100);
+	msg->isTransit = isTransit;
+	if (numDropped) msg->onDrop = [numDropped]() { (*numDropped)++; };
+	return msg;
+}
+
+void TestPriorities ()
+{
+	TransportSendQueue queue;
+	uint64_t mts = 1000000;
+	auto transit = CreateMessage (eI2NPTunnelData, true);
+	auto local = CreateMessage (eI2NPTunnelData, false);
+	auto build = CreateMessage (eI2NPShortTunnelBuildReply, true);
+	auto store = CreateMessage (eI2NPDatabaseStore, false);
+	assert (GetTransportPriority (*transit) == eTransportPriorityTransit);
+	assert (GetTransportPriority (*local) == eTransportPriorityLocal);
+	assert (GetTransportPriority (*build) == eTransportPriorityControl);
+	queue.Put (transit, mts);
+	queue.Put (local, mts + 1);
+	queue.Put (build, mts + 2);
+	queue.Put (store, mts + 3);
+	assert (queue.GetSize () == 4 && queue.GetLag (mts + 10) == 10);
+	std::vector<std::shared_ptr<I2NPMessage> > expected { build, store, local, transit };
+	for (auto& it: expected)
+	{
+		assert (queue.GetFront (mts + 10) == it);
+		queue.PopFront (mts + 10);
+	}
+	assert (queue.IsEmpty () && !queue.GetFront (mts));
+}
+
+void TestCoDel ()
+{
+	TransportSendQueue queue;
+	int numDropped = 0, numControlDropped = 0;
+	uint64_t mts = 1000000;
+	// standing queue, one message per millisecond in and out, 100 ms delay
+	for (int i = 0; i < 100; i++)
+	{
+		queue.Put (CreateMessage (eI2NPTunnelData, true, &numDropped), mts);
+		queue.Put (CreateMessage (eI2NPDatabaseStore, false, &numControlDropped), mts);
+		mts += 1000;
+	}
+	size_t numSent = 0;
+	for (int i = 0; i < 2000; i++)
+	{
+		queue.Put (CreateMessage (eI2NPTunnelData, true, &numDropped), mts);
+		if (queue.GetFront (mts))
+		{
+			queue.PopFront (mts);
+			numSent++;
+		}
+		mts += 1000;
+	}
+	assert (numDropped > 10 && !numControlDropped);
+	assert (numSent + numDropped + queue.GetSize () == 2200);
+	// 200 ms standing queue reduced by drops
+	assert (queue.GetLag (mts) < 200000 - 10000);
+	// drain, no more arrivals
+	while (queue.GetFront (mts))
+		queue.PopFront (mts);
+	assert (queue.IsEmpty ());
+	// no drops below target
+	numDropped = 0;
+	for (int i = 0; i < 100; i++)
+	{
+		for (int j = 0; j < 10; j++)
+			queue.Put (CreateMessage (eI2NPTunnelData, false, &numDropped), mts);
+		mts += 1000;
+		while (queue.GetFront (mts))
+			queue.PopFront (mts);
+	}
+	assert (!numDropped);
+	// all remaining messages are dropped
+	for (int i = 0; i < 10; i++)
+		queue.Put (CreateMessage (eI2NPTunnelData, true, &numDropped), mts);
+	queue.DropAll ();
+	assert (queue.IsEmpty () && numDropped == 10);
+}
+
+uint64_t GetNumDelaySamples (TransportPriority priority)
+{
+	uint64_t num = 0;
+	auto& histogram = transports.GetQueueDelayHistogram (priority);
+	for (int i = 0; i < QUEUE_DELAY_HISTOGRAM_NUM_BUCKETS; i++)
+		num += histogram.GetCount (i);
+	return num;
+}
+
+void TestDropFront ()
+{
+	TransportSendQueue queue;
+	int numDropped = 0;
+	uint64_t mts = 1000000;
+	queue.Put (CreateMessage (eI2NPTunnelData, false, &numDropped), mts);
+	queue.Put (CreateMessage (eI2NPTunnelData, false, &numDropped), mts);
+	auto numSamples = GetNumDelaySamples (eTransportPriorityLocal);
+	// expired, not sent
+	assert (queue.GetFront (mts + 1000));
+	queue.DropFront ();
+	assert (numDropped == 1 && queue.GetSize () == 1);
+	assert (GetNumDelaySamples (eTransportPriorityLocal) == numSamples);
+	// sent
+	assert (queue.GetFront (mts + 1000));
+	queue.PopFront (mts + 1000);
+	assert (numDropped == 1 && queue.IsEmpty ());
+	assert (GetNumDelaySamples (eTransportPriorityLocal) == numSamples + 1);
+}
+
+void TestGetAll ()
+{
+	TransportSendQueue queue;
+	for (int i = 0; i < 10; i++)
+		queue.Put (CreateMessage (i & 1 ? eI2NPTunnelData : eI2NPDatabaseLookup, i & 2), 1000);
+	std::vector<std::shared_ptr<I2NPMessage> > msgs;
+	queue.GetAll (msgs);
+	assert (msgs.size () == 10 && queue.IsEmpty ());
+}
+
+int main ()
+{
+	TestPriorities ();
+	TestCoDel ();
+	TestDropFront ();
+	TestGetAll ();
+	return 0;
+}
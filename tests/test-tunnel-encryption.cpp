@@ -0,0 +1,71 @@
+#include <cassert>
+#include <inttypes.h>
+#include <string.h>
+#include <vector>
+#include <openssl/rand.h>
+
+#include "CPU.h"
+#include "Crypto.h"
+
+const size_t TUNNEL_MSG_SIZE = 1024; // 16 IV + 1008 data
+
+void TestBatchEncryption (bool aesni)
+{
+	i2p::cpu::aesni = aesni;
+	i2p::crypto::AESKey layerKey, ivKey;
+	RAND_bytes (layerKey, 32);
+	RAND_bytes (ivKey, 32);
+	i2p::crypto::TunnelEncryption single, batch;
+	single.SetKeys (layerKey, ivKey);
+	batch.SetKeys (layerKey, ivKey);
+
+	for (size_t num = 1; num <= 9; num++)
+	{
+		std::vector<uint8_t> in (num*TUNNEL_MSG_SIZE), out (num*TUNNEL_MSG_SIZE), inplace (num*TUNNEL_MSG_SIZE), expected (num*TUNNEL_MSG_SIZE);
+		RAND_bytes (in.data (), in.size ());
+		inplace = in;
+		std::vector<const uint8_t *> ins (num);
+		std::vector<uint8_t *> outs (num), inplaces (num);
+		for (size_t i = 0; i < num; i++)
+		{
+			single.Encrypt (in.data () + i*TUNNEL_MSG_SIZE, expected.data () + i*TUNNEL_MSG_SIZE);
+			ins[i] = in.data () + i*TUNNEL_MSG_SIZE;
+			outs[i] = out.data () + i*TUNNEL_MSG_SIZE;
+			inplaces[i] = inplace.data () + i*TUNNEL_MSG_SIZE;
+		}
+		batch.Encrypt (ins.data (), outs.data (), num);
+		assert (out == expected);
+		batch.Encrypt (inplaces.data (), inplaces.data (), num);
+		assert (inplace == expected);
+	}
+
+	// decryption restores plain text
+	std::vector<uint8_t> in (4*TUNNEL_MSG_SIZE), out (4*TUNNEL_MSG_SIZE), decrypted (TUNNEL_MSG_SIZE);
+	RAND_bytes (in.data (), in.size ());
+	const uint8_t * ins[4];
+	uint8_t * outs[4];
+	for (int i = 0; i < 4; i++)
+	{
+		ins[i] = in.data () + i*TUNNEL_MSG_SIZE;
+		outs[i] = out.data () + i*TUNNEL_MSG_SIZE;
+	}
+	batch.Encrypt (ins, outs, 4);
+	i2p::crypto::TunnelDecryption decryption;
+	decryption.SetKeys (layerKey, ivKey);
+	for (int i = 0; i < 4; i++)
+	{
+		decryption.Decrypt (outs[i], decrypted.data ());
+		assert (!memcmp (decrypted.data (), ins[i], TUNNEL_MSG_SIZE));
+	}
+}
+
+int main ()
+{
+	bool aesni = i2p::cpu::aesni;
+	TestBatchEncryption (false);
+#if SUPPORTS_AES
+	i2p::cpu::Detect (true, false);
+	if (i2p::cpu::aesni) TestBatchEncryption (true);
+#endif
+	i2p::cpu::aesni = aesni;
+}